@@ -8,18 +8,17 @@
 
 #include "config.h"
 #include "activity.h"
+#include "app-list-model.h"
 #include "shell.h"
-#include "util.h"
 #include "app-grid-button.h"
 
-#include <gio/gdesktopappinfo.h>
-
 /**
  * SECTION:phosh-activity
  * @short_description: An app in the faovorites overview
  * @Title: PhoshActivity
  *
  * The #PhoshActivity is used to select a running application in the overview.
+ * If available it shows a thumbnail of the application's window.
  */
 
 // Icons actually sized according to the pixel-size set in the template
@@ -47,13 +46,15 @@ typedef struct
   GtkWidget *app_name;
   GtkWidget *box;
   GtkWidget *btn_close;
+  GtkWidget *thumbnail;
 
   int win_width;
   int win_height;
 
   char *app_id;
   char *title;
-  GDesktopAppInfo *info;
+  GAppInfo *info;
+  cairo_surface_t *surface;
 } PhoshActivityPrivate;
 
 
@@ -146,30 +147,48 @@ on_btn_close_clicked (PhoshActivity *self, GtkButton *button)
 }
 
 
+static gboolean
+on_thumbnail_draw (PhoshActivity *self, cairo_t *cr, GtkWidget *widget)
+{
+  PhoshActivityPrivate *priv = phosh_activity_get_instance_private (self);
+  int width, height, surface_width, surface_height;
+  double scale;
+
+  if (priv->surface == NULL)
+    return GDK_EVENT_PROPAGATE;
+
+  width = gtk_widget_get_allocated_width (widget);
+  height = gtk_widget_get_allocated_height (widget);
+  surface_width = cairo_image_surface_get_width (priv->surface);
+  surface_height = cairo_image_surface_get_height (priv->surface);
+
+  /* Fit the thumbnail into the activity keeping the aspect ratio */
+  scale = MIN ((double) width / surface_width, (double) height / surface_height);
+  cairo_translate (cr,
+                   (width - surface_width * scale) / 2,
+                   (height - surface_height * scale) / 2);
+  cairo_scale (cr, scale, scale);
+  cairo_set_source_surface (cr, priv->surface, 0, 0);
+  cairo_paint (cr);
+
+  return GDK_EVENT_PROPAGATE;
+}
+
+
 static void
 phosh_activity_constructed (GObject *object)
 {
   PhoshActivity *self = PHOSH_ACTIVITY (object);
   PhoshActivityPrivate *priv = phosh_activity_get_instance_private (self);
-  g_autofree gchar *desktop_id = NULL;
-
-  desktop_id = g_strdup_printf ("%s.desktop", priv->app_id);
-  g_return_if_fail (desktop_id);
-  priv->info = g_desktop_app_info_new (desktop_id);
-
-  if (!priv->info) {
-    g_autofree gchar *name = phosh_fix_app_id (priv->app_id);
-    g_return_if_fail (name);
-    g_free (desktop_id);
-    desktop_id = g_strdup_printf ("%s.desktop", name);
-    g_return_if_fail (desktop_id);
-    g_debug ("%s has broken app_id, should be %s", priv->app_id, desktop_id);
-    priv->info = g_desktop_app_info_new (desktop_id);
+
+  if (priv->app_id) {
+    priv->info = phosh_app_list_model_lookup_app_id (phosh_app_list_model_get_default (),
+                                                     priv->app_id);
   }
 
   if (priv->info) {
     gtk_image_set_from_gicon (GTK_IMAGE (priv->icon),
-                              g_app_info_get_icon (G_APP_INFO (priv->info)),
+                              g_app_info_get_icon (priv->info),
                               ACTIVITY_ICON_SIZE);
   } else {
     gtk_image_set_from_icon_name (GTK_IMAGE (priv->icon),
@@ -181,6 +200,10 @@ phosh_activity_constructed (GObject *object)
                             "clicked",
                             (GCallback) on_btn_close_clicked,
                             self);
+  g_signal_connect_swapped (priv->thumbnail,
+                            "draw",
+                            (GCallback) on_thumbnail_draw,
+                            self);
 
   G_OBJECT_CLASS (phosh_activity_parent_class)->constructed (object);
 }
@@ -193,6 +216,7 @@ phosh_activity_dispose (GObject *object)
   PhoshActivityPrivate *priv = phosh_activity_get_instance_private (self);
 
   g_clear_object (&priv->info);
+  g_clear_pointer (&priv->surface, cairo_surface_destroy);
 
   G_OBJECT_CLASS (phosh_activity_parent_class)->dispose (object);
 }
@@ -352,6 +376,7 @@ phosh_activity_class_init (PhoshActivityClass *klass)
   gtk_widget_class_bind_template_child_private (widget_class, PhoshActivity, icon);
   gtk_widget_class_bind_template_child_private (widget_class, PhoshActivity, box);
   gtk_widget_class_bind_template_child_private (widget_class, PhoshActivity, btn_close);
+  gtk_widget_class_bind_template_child_private (widget_class, PhoshActivity, thumbnail);
 
   gtk_widget_class_set_css_name (widget_class, "phosh-activity");
 }
@@ -418,3 +443,32 @@ phosh_activity_get_title (PhoshActivity *self)
 
   return priv->title;
 }
+
+/**
+ * phosh_activity_set_thumbnail:
+ * @self: The #PhoshActivity
+ * @surface: (nullable): A #cairo_surface_t with the window's contents
+ *
+ * Sets the thumbnail to show, %NULL removes it. @surface must be an
+ * image surface. The activity keeps a reference until it's replaced.
+ * Setting the current surface again redraws it.
+ */
+void
+phosh_activity_set_thumbnail (PhoshActivity *self, cairo_surface_t *surface)
+{
+  PhoshActivityPrivate *priv;
+
+  g_return_if_fail (PHOSH_IS_ACTIVITY (self));
+  g_return_if_fail (surface == NULL ||
+                    cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE);
+  priv = phosh_activity_get_instance_private (self);
+
+  /* The thumbnailer updates surfaces in place */
+  if (priv->surface != surface) {
+    g_clear_pointer (&priv->surface, cairo_surface_destroy);
+    if (surface)
+      priv->surface = cairo_surface_reference (surface);
+  }
+
+  gtk_widget_queue_draw (priv->thumbnail);
+}
@@ -17,3 +17,5 @@ const char *phosh_activity_get_app_id (PhoshActivity   *self);
 const char *phosh_activity_get_title  (PhoshActivity   *self);
 void        phosh_activity_set_title  (PhoshActivity   *self,
                                        const char      *title);
+void        phosh_activity_set_thumbnail (PhoshActivity   *self,
+                                          cairo_surface_t *surface);
@@ -400,24 +400,11 @@ phosh_app_grid_button_new_favorite (GAppInfo *info)
 
 
 static void
-favorites_changed (GListModel         *list,
-                   guint               position,
-                   guint               removed,
-                   guint               added,
-                   PhoshAppGridButton *self)
+update_favorite (PhoshAppGridButton *self, gboolean favorite)
 {
-  PhoshAppGridButtonPrivate *priv;
-  gboolean favorite = FALSE;
+  PhoshAppGridButtonPrivate *priv = phosh_app_grid_button_get_instance_private (self);
   GAction *act;
 
-  g_return_if_fail (PHOSH_IS_APP_GRID_BUTTON (self));
-  g_return_if_fail (PHOSH_IS_FAVORITE_LIST_MODEL (list));
-
-  priv = phosh_app_grid_button_get_instance_private (self);
-
-  favorite = phosh_favorite_list_model_app_is_favorite (PHOSH_FAVORITE_LIST_MODEL (list),
-                                                           priv->info);
-
   if (priv->is_favorite == favorite) {
     return;
   }
@@ -433,6 +420,19 @@ favorites_changed (GListModel         *list,
 }
 
 
+static void
+favorite_changed (PhoshFavoriteListModel *list,
+                  const char             *app_id,
+                  gboolean                is_favorite,
+                  PhoshAppGridButton     *self)
+{
+  g_return_if_fail (PHOSH_IS_APP_GRID_BUTTON (self));
+  g_return_if_fail (PHOSH_IS_FAVORITE_LIST_MODEL (list));
+
+  update_favorite (self, is_favorite);
+}
+
+
 void
 phosh_app_grid_button_set_app_info (PhoshAppGridButton *self,
                                     GAppInfo *info)
@@ -464,13 +464,20 @@ phosh_app_grid_button_set_app_info (PhoshAppGridButton *self,
   }
 
   if (info) {
+    const char *app_id = g_app_info_get_id (info);
+
     priv->info = g_object_ref (info);
 
-    priv->favorite_changed_watcher = g_signal_connect (list,
-                                                        "items-changed",
-                                                        G_CALLBACK (favorites_changed),
-                                                        self);
-    favorites_changed (G_LIST_MODEL (list), 0, 0, 0, self);
+    // Only get told about changes to our app
+    if (app_id) {
+      g_autofree gchar *signal = g_strdup_printf ("favorite-changed::%s", app_id);
+
+      priv->favorite_changed_watcher = g_signal_connect (list,
+                                                          signal,
+                                                          G_CALLBACK (favorite_changed),
+                                                          self);
+    }
+    update_favorite (self, phosh_favorite_list_model_app_is_favorite (list, priv->info));
 
     name = g_app_info_get_name (G_APP_INFO (priv->info));
     gtk_label_set_label (GTK_LABEL (priv->label), name);
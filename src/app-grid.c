@@ -19,6 +19,7 @@
 typedef struct _PhoshAppGridPrivate PhoshAppGridPrivate;
 struct _PhoshAppGridPrivate {
   GtkFilterListModel *model;
+  GtkSortListModel *ranked;
 
   GtkWidget *search;
   GtkWidget *apps;
@@ -27,6 +28,8 @@ struct _PhoshAppGridPrivate {
   GtkWidget *scrolled_window;
 
   gchar *search_string;
+  /* GAppInfo → score for the current search, 0 if it doesn't match */
+  GHashTable *scores;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (PhoshAppGrid, phosh_app_grid, GTK_TYPE_BOX)
@@ -46,31 +49,56 @@ app_launched_cb (GtkWidget    *widget,
 }
 
 
+static guint
+get_score (PhoshAppGrid *self, GAppInfo *info)
+{
+  PhoshAppGridPrivate *priv = phosh_app_grid_get_instance_private (self);
+
+  return GPOINTER_TO_UINT (g_hash_table_lookup (priv->scores, info));
+}
+
+
 static gint
 sort_apps (gconstpointer a,
            gconstpointer b,
            gpointer      data)
 {
-  GAppInfo *info1 = G_APP_INFO (a);
-  GAppInfo *info2 = G_APP_INFO (b);
+  PhoshAppGrid *self = PHOSH_APP_GRID (data);
+  guint score1, score2;
 
-  g_autofree gchar *s1 = g_utf8_casefold (g_app_info_get_name (info1), -1);
-  g_autofree gchar *s2 = g_utf8_casefold (g_app_info_get_name (info2), -1);
+  /* Best match first, when not searching all scores are 0 and the
+     collation key of the name determines the order */
+  score1 = get_score (self, G_APP_INFO (a));
+  score2 = get_score (self, G_APP_INFO (b));
+  if (score1 != score2)
+    return score1 > score2 ? -1 : 1;
 
-  return g_strcmp0 (s1, s2);
+  return 0;
 }
 
-static const gchar *(*app_attr[]) (GAppInfo *info) = {
-  g_app_info_get_display_name,
-  g_app_info_get_name,
-  g_app_info_get_description,
-  g_app_info_get_executable,
-};
 
-static const gchar *(*desktop_attr[]) (GDesktopAppInfo *info) = {
-  g_desktop_app_info_get_generic_name,
-  g_desktop_app_info_get_categories,
-};
+static guint
+score_app (PhoshAppGrid *self, GAppInfo *info)
+{
+  PhoshAppGridPrivate *priv = phosh_app_grid_get_instance_private (self);
+  const PhoshAppSearchIndex *index;
+
+  index = phosh_app_list_model_get_search_index (phosh_app_list_model_get_default (), info);
+  if (G_UNLIKELY (index == NULL))
+    return 0;
+
+  return phosh_app_search_index_score (index, priv->search_string);
+}
+
+
+static gchar *
+sort_key (gpointer item,
+          gpointer data)
+{
+  const char *name = g_app_info_get_name (G_APP_INFO (item));
+
+  return g_utf8_collate_key (name ?: "", -1);
+}
 
 static gboolean
 search_apps (gpointer item, gpointer data)
@@ -79,7 +107,7 @@ search_apps (gpointer item, gpointer data)
   PhoshAppGridPrivate *priv = phosh_app_grid_get_instance_private (self);
   GAppInfo *info = item;
   const char *search = NULL;
-  const char *str = NULL;
+  gpointer score;
 
   g_return_val_if_fail (priv != NULL, TRUE);
   g_return_val_if_fail (priv->search != NULL, TRUE);
@@ -94,52 +122,36 @@ search_apps (gpointer item, gpointer data)
     return TRUE;
   }
 
-  for (int i = 0; i < G_N_ELEMENTS (app_attr); i++) {
-    g_autofree gchar *folded = NULL;
-
-    str = app_attr[i] (info);
-
-    if (!str || *str == '\0')
-      continue;
-
-    folded = g_utf8_casefold (str, -1);
-
-    if (strstr (folded, search))
-      return TRUE;
+  /* Apps added to the model since the search started aren't scored yet */
+  if (!g_hash_table_lookup_extended (priv->scores, info, NULL, &score)) {
+    score = GUINT_TO_POINTER (score_app (self, info));
+    g_hash_table_insert (priv->scores, g_object_ref (info), score);
   }
 
-  if (G_IS_DESKTOP_APP_INFO (info)) {
-    const char * const *kwds;
-
-    for (int i = 0; i < G_N_ELEMENTS (desktop_attr); i++) {
-      g_autofree gchar *folded = NULL;
-
-      str = desktop_attr[i] (G_DESKTOP_APP_INFO (info));
-
-      if (!str || *str == '\0')
-        continue;
+  return GPOINTER_TO_UINT (score) > 0;
+}
 
-      folded = g_utf8_casefold (str, -1);
 
-      if (strstr (folded, search))
-        return TRUE;
-    }
-
-    kwds = g_desktop_app_info_get_keywords (G_DESKTOP_APP_INFO (info));
+/* Drop scores of apps that went away so we don't keep them alive */
+static void
+apps_changed (GListModel   *list,
+              guint         position,
+              guint         removed,
+              guint         added,
+              PhoshAppGrid *self)
+{
+  PhoshAppGridPrivate *priv = phosh_app_grid_get_instance_private (self);
+  GHashTableIter iter;
+  gpointer info;
 
-    if (kwds) {
-      int i = 0;
+  if (removed == 0)
+    return;
 
-      while ((str = kwds[i])) {
-        g_autofree gchar *folded = g_utf8_casefold (str, -1);
-        if (strstr (folded, search))
-          return TRUE;
-        i++;
-      }
-    }
+  g_hash_table_iter_init (&iter, priv->scores);
+  while (g_hash_table_iter_next (&iter, &info, NULL)) {
+    if (phosh_app_list_model_get_search_index (PHOSH_APP_LIST_MODEL (list), info) == NULL)
+      g_hash_table_iter_remove (&iter);
   }
-
-  return FALSE;
 }
 
 
@@ -191,11 +203,12 @@ static void
 phosh_app_grid_init (PhoshAppGrid *self)
 {
   PhoshAppGridPrivate *priv = phosh_app_grid_get_instance_private (self);
-  GtkSortListModel *sorted;
   PhoshFavoriteListModel *favorites;
 
   gtk_widget_init_template (GTK_WIDGET (self));
 
+  priv->scores = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+
   favorites = phosh_favorite_list_model_get_default ();
 
   gtk_flow_box_bind_model (GTK_FLOW_BOX (priv->favs),
@@ -206,17 +219,23 @@ phosh_app_grid_init (PhoshAppGrid *self)
                     G_CALLBACK (favorites_changed),
                     self);
 
-  /* fill the grid with apps */
-  sorted = gtk_sort_list_model_new (G_LIST_MODEL (phosh_app_list_model_get_default ()),
-                                    sort_apps,
-                                    NULL,
-                                    NULL);
-  priv->model = gtk_filter_list_model_new (G_LIST_MODEL (sorted),
+  /* fill the grid with apps, filter first so we only rank matches */
+  priv->model = gtk_filter_list_model_new (G_LIST_MODEL (phosh_app_list_model_get_default ()),
                                            search_apps,
                                            self,
                                            NULL);
+  priv->ranked = gtk_sort_list_model_new (G_LIST_MODEL (priv->model),
+                                          sort_apps,
+                                          self,
+                                          NULL);
+  gtk_sort_list_model_set_key_func (priv->ranked, sort_key, NULL, NULL);
+  g_signal_connect_object (phosh_app_list_model_get_default (),
+                           "items-changed",
+                           G_CALLBACK (apps_changed),
+                           self,
+                           0);
   gtk_flow_box_bind_model (GTK_FLOW_BOX (priv->apps),
-                           G_LIST_MODEL (priv->model),
+                           G_LIST_MODEL (priv->ranked),
                            create_launcher, self, NULL);
 }
 
@@ -227,8 +246,10 @@ phosh_app_grid_finalize (GObject *object)
   PhoshAppGrid *self = PHOSH_APP_GRID (object);
   PhoshAppGridPrivate *priv = phosh_app_grid_get_instance_private (self);
 
+  g_clear_object (&priv->ranked);
   g_clear_object (&priv->model);
   g_clear_pointer (&priv->search_string, g_free);
+  g_clear_pointer (&priv->scores, g_hash_table_destroy);
 
   G_OBJECT_CLASS (phosh_app_grid_parent_class)->finalize (object);
 }
@@ -245,11 +266,17 @@ phosh_app_grid_key_press_event (GtkWidget   *widget,
 }
 
 static void
-do_search (PhoshAppGrid *self)
+do_search (PhoshAppGrid *self, const char *search)
 {
   PhoshAppGridPrivate *priv = phosh_app_grid_get_instance_private (self);
+  g_autofree gchar *old_search = g_steal_pointer (&priv->search_string);
+  g_autoptr (GHashTable) scores = NULL;
+  GtkFilterChange change = GTK_FILTER_CHANGE_DIFFERENT;
   GtkAdjustment *adjustment;
 
+  if (search && *search != '\0')
+    priv->search_string = g_utf8_casefold (search, -1);
+
   if (priv->search_string && *priv->search_string != '\0') {
     gtk_revealer_set_reveal_child (GTK_REVEALER (priv->favs_revealer), FALSE);
     gtk_style_context_add_class (gtk_widget_get_style_context (priv->apps),
@@ -262,22 +289,56 @@ do_search (PhoshAppGrid *self)
                                     ACTIVE_SEARCH_CLASS);
   }
 
-  gtk_filter_list_model_refilter (priv->model);
+  if (g_strcmp0 (old_search, priv->search_string) == 0)
+    return;
+
+  /* Score everything up front so the models only ever see scores
+     matching the current search */
+  scores = g_steal_pointer (&priv->scores);
+  priv->scores = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+
+  if (priv->search_string == NULL) {
+    /* Nothing to score */
+  } else if (old_search && g_str_has_prefix (priv->search_string, old_search)) {
+    /* The search got more specific, only previous matches can match */
+    GHashTableIter iter;
+    gpointer info, score;
+
+    g_hash_table_iter_init (&iter, scores);
+    while (g_hash_table_iter_next (&iter, &info, &score)) {
+      if (GPOINTER_TO_UINT (score) == 0)
+        continue;
+      score = GUINT_TO_POINTER (score_app (self, info));
+      g_hash_table_insert (priv->scores, g_object_ref (info), score);
+    }
+    change = GTK_FILTER_CHANGE_MORE_STRICT;
+  } else {
+    GListModel *list = G_LIST_MODEL (phosh_app_list_model_get_default ());
+
+    for (guint i = 0; i < g_list_model_get_n_items (list); i++) {
+      GAppInfo *info = g_list_model_get_item (list, i);
+      guint score = score_app (self, info);
+
+      /* The table holds the reference */
+      g_hash_table_insert (priv->scores, info, GUINT_TO_POINTER (score));
+    }
+
+    /* The search got less specific, previous matches still match */
+    if (old_search && g_str_has_prefix (old_search, priv->search_string))
+      change = GTK_FILTER_CHANGE_LESS_STRICT;
+  }
+
+  gtk_filter_list_model_refilter_with_hint (priv->model, change);
+
+  /* Scores of the remaining matches changed, move them into place */
+  gtk_sort_list_model_resort (priv->ranked);
 }
 
 static void
 search_changed (GtkSearchEntry *entry,
                 PhoshAppGrid   *self)
 {
-  PhoshAppGridPrivate *priv = phosh_app_grid_get_instance_private (self);
-  const char *search = gtk_entry_get_text (GTK_ENTRY (entry));
-
-  g_clear_pointer (&priv->search_string, g_free);
-
-  if (search && *search != '\0')
-      priv->search_string = g_utf8_casefold (search, -1);
-
-  do_search (self);
+  do_search (self, gtk_entry_get_text (GTK_ENTRY (entry)));
 }
 
 static void
@@ -285,14 +346,7 @@ search_preedit_changed (GtkSearchEntry *entry,
                         const gchar    *preedit,
                         PhoshAppGrid   *self)
 {
-  PhoshAppGridPrivate *priv = phosh_app_grid_get_instance_private (self);
-
-  g_clear_pointer (&priv->search_string, g_free);
-
-  if (preedit && *preedit != '\0')
-      priv->search_string = g_utf8_casefold (preedit, -1);
-
-  do_search (self);
+  do_search (self, preedit);
 }
 
 static void
@@ -310,6 +364,7 @@ search_activated (GtkSearchEntry *entry,
     return;
   }
 
+  // Results are ranked, launch the best match
   child = gtk_flow_box_get_child_at_index (GTK_FLOW_BOX (priv->apps), 0);
 
   // No results
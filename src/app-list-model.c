@@ -10,17 +10,34 @@
  */
 
 #include "app-list-model.h"
+#include "util.h"
 
 #include <gio/gio.h>
+#include <string.h>
 
 
+/*
+ * All searchable fields of an app casefolded and NUL separated in
+ * one allocation so matching doesn't need to allocate.
+ */
+struct _PhoshAppSearchIndex {
+  guint offsets[PHOSH_APP_SEARCH_FIELD_LAST];
+  gchar data[];
+};
+
 typedef struct _PhoshAppListModelPrivate PhoshAppListModelPrivate;
 struct _PhoshAppListModelPrivate {
   GAppInfoMonitor *monitor;
 
   GSequence *items;
+  /* GAppInfo → PhoshAppSearchIndex for all items */
+  GHashTable *search_index;
+  /* desktop id → GAppInfo for all items */
+  GHashTable *by_id;
+  /* app id → GAppInfo (or %NULL if unknown) of resolved app ids */
+  GHashTable *app_ids;
 
-  gulong debounce;
+  guint debounce;
 
   /* cache */
   struct {
@@ -37,14 +54,29 @@ G_DEFINE_TYPE_WITH_CODE (PhoshAppListModel, phosh_app_list_model, G_TYPE_OBJECT,
                          G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, list_iface_init))
 
 static void
-phosh_app_list_model_finalize (GObject *object)
+phosh_app_list_model_dispose (GObject *object)
 {
   PhoshAppListModel *self = PHOSH_APP_LIST_MODEL (object);
   PhoshAppListModelPrivate *priv = phosh_app_list_model_get_instance_private (self);
 
+  g_clear_handle_id (&priv->debounce, g_source_remove);
+  if (priv->monitor)
+    g_signal_handlers_disconnect_by_data (priv->monitor, self);
   g_clear_object (&priv->monitor);
 
+  G_OBJECT_CLASS (phosh_app_list_model_parent_class)->dispose (object);
+}
+
+static void
+phosh_app_list_model_finalize (GObject *object)
+{
+  PhoshAppListModel *self = PHOSH_APP_LIST_MODEL (object);
+  PhoshAppListModelPrivate *priv = phosh_app_list_model_get_instance_private (self);
+
   g_sequence_free (priv->items);
+  g_hash_table_destroy (priv->search_index);
+  g_hash_table_destroy (priv->by_id);
+  g_hash_table_destroy (priv->app_ids);
 
   G_OBJECT_CLASS (phosh_app_list_model_parent_class)->finalize (object);
 }
@@ -54,6 +86,7 @@ phosh_app_list_model_class_init (PhoshAppListModelClass *klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
+  gobject_class->dispose = phosh_app_list_model_dispose;
   gobject_class->finalize = phosh_app_list_model_finalize;
 }
 
@@ -111,40 +144,263 @@ list_iface_init (GListModelInterface *iface)
   iface->get_n_items = list_get_n_items;
 }
 
+static gchar *
+fold_keywords (GAppInfo *info)
+{
+  const char * const *kwds;
+  GString *str;
+
+  if (!G_IS_DESKTOP_APP_INFO (info))
+    return NULL;
+
+  kwds = g_desktop_app_info_get_keywords (G_DESKTOP_APP_INFO (info));
+  if (kwds == NULL || kwds[0] == NULL)
+    return NULL;
+
+  /* Newline separated so a search term can't match across keywords */
+  str = g_string_new (NULL);
+  for (int i = 0; kwds[i]; i++) {
+    g_autofree gchar *folded = g_utf8_casefold (kwds[i], -1);
+
+    if (i > 0)
+      g_string_append_c (str, '\n');
+    g_string_append (str, folded);
+  }
+
+  return g_string_free (str, FALSE);
+}
+
+static PhoshAppSearchIndex *
+search_index_new (GAppInfo *info)
+{
+  PhoshAppSearchIndex *index;
+  const gchar *fields[PHOSH_APP_SEARCH_FIELD_LAST] = { NULL, };
+  g_autofree gchar *keywords = NULL;
+  gsize lens[PHOSH_APP_SEARCH_FIELD_LAST];
+  gchar *folded[PHOSH_APP_SEARCH_FIELD_LAST] = { NULL, };
+  gsize size = 0;
+  guint offset = 0;
+
+  fields[PHOSH_APP_SEARCH_FIELD_NAME] = g_app_info_get_name (info);
+  fields[PHOSH_APP_SEARCH_FIELD_DISPLAY_NAME] = g_app_info_get_display_name (info);
+  fields[PHOSH_APP_SEARCH_FIELD_EXECUTABLE] = g_app_info_get_executable (info);
+  fields[PHOSH_APP_SEARCH_FIELD_DESCRIPTION] = g_app_info_get_description (info);
+  if (G_IS_DESKTOP_APP_INFO (info)) {
+    GDesktopAppInfo *dinfo = G_DESKTOP_APP_INFO (info);
+
+    fields[PHOSH_APP_SEARCH_FIELD_GENERIC_NAME] = g_desktop_app_info_get_generic_name (dinfo);
+    fields[PHOSH_APP_SEARCH_FIELD_CATEGORIES] = g_desktop_app_info_get_categories (dinfo);
+  }
+
+  for (int i = 0; i < PHOSH_APP_SEARCH_FIELD_LAST; i++) {
+    if (i == PHOSH_APP_SEARCH_FIELD_KEYWORDS)
+      continue;
+    if (fields[i] && *fields[i] != '\0')
+      folded[i] = g_utf8_casefold (fields[i], -1);
+  }
+  folded[PHOSH_APP_SEARCH_FIELD_KEYWORDS] = fold_keywords (info);
+
+  for (int i = 0; i < PHOSH_APP_SEARCH_FIELD_LAST; i++) {
+    lens[i] = folded[i] ? strlen (folded[i]) : 0;
+    size += lens[i] + 1;
+  }
+
+  index = g_malloc (sizeof (PhoshAppSearchIndex) + size);
+  for (int i = 0; i < PHOSH_APP_SEARCH_FIELD_LAST; i++) {
+    index->offsets[i] = offset;
+    if (lens[i])
+      memcpy (index->data + offset, folded[i], lens[i]);
+    index->data[offset + lens[i]] = '\0';
+    offset += lens[i] + 1;
+    g_free (folded[i]);
+  }
+
+  return index;
+}
+
+static void
+add_search_index (PhoshAppListModel *self, GAppInfo *info)
+{
+  PhoshAppListModelPrivate *priv = phosh_app_list_model_get_instance_private (self);
+
+  g_hash_table_insert (priv->search_index, g_object_ref (info), search_index_new (info));
+  g_hash_table_replace (priv->by_id, g_strdup (g_app_info_get_id (info)), g_object_ref (info));
+}
+
+static void
+clear_app_info (gpointer data)
+{
+  if (data)
+    g_object_unref (data);
+}
+
+static gboolean
+app_info_unchanged (GAppInfo *old_info, GAppInfo *new_info)
+{
+  GIcon *old_icon, *new_icon;
+
+  if (!g_app_info_equal (old_info, new_info))
+    return FALSE;
+
+  if (g_strcmp0 (g_app_info_get_name (old_info), g_app_info_get_name (new_info)) ||
+      g_strcmp0 (g_app_info_get_display_name (old_info), g_app_info_get_display_name (new_info)) ||
+      g_strcmp0 (g_app_info_get_description (old_info), g_app_info_get_description (new_info)) ||
+      g_strcmp0 (g_app_info_get_commandline (old_info), g_app_info_get_commandline (new_info)))
+    return FALSE;
+
+  old_icon = g_app_info_get_icon (old_info);
+  new_icon = g_app_info_get_icon (new_info);
+  if (old_icon != new_icon && (old_icon == NULL || new_icon == NULL ||
+                               !g_icon_equal (old_icon, new_icon)))
+    return FALSE;
+
+  if (G_IS_DESKTOP_APP_INFO (old_info) && G_IS_DESKTOP_APP_INFO (new_info)) {
+    GDesktopAppInfo *old_dinfo = G_DESKTOP_APP_INFO (old_info);
+    GDesktopAppInfo *new_dinfo = G_DESKTOP_APP_INFO (new_info);
+    const char * const *old_kwds, * const *new_kwds;
+
+    if (g_strcmp0 (g_desktop_app_info_get_filename (old_dinfo),
+                   g_desktop_app_info_get_filename (new_dinfo)) ||
+        g_strcmp0 (g_desktop_app_info_get_generic_name (old_dinfo),
+                   g_desktop_app_info_get_generic_name (new_dinfo)) ||
+        g_strcmp0 (g_desktop_app_info_get_categories (old_dinfo),
+                   g_desktop_app_info_get_categories (new_dinfo)))
+      return FALSE;
+
+    old_kwds = g_desktop_app_info_get_keywords (old_dinfo);
+    new_kwds = g_desktop_app_info_get_keywords (new_dinfo);
+    if (old_kwds != new_kwds) {
+      guint i;
+
+      if (old_kwds == NULL || new_kwds == NULL)
+        return FALSE;
+
+      /* g_strv_equal () needs glib 2.60 */
+      for (i = 0; old_kwds[i] && new_kwds[i]; i++) {
+        if (g_strcmp0 (old_kwds[i], new_kwds[i]))
+          return FALSE;
+      }
+      if (old_kwds[i] || new_kwds[i])
+        return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static void
+note_change (guint *first,
+             guint *end,
+             guint  position,
+             guint  n_new)
+{
+  if (*first == G_MAXUINT)
+    *first = position;
+  *end = position + n_new;
+}
+
 static gboolean
 items_changed (gpointer data)
 {
   PhoshAppListModel *self = PHOSH_APP_LIST_MODEL (data);
   PhoshAppListModelPrivate *priv = phosh_app_list_model_get_instance_private (self);
+  g_autoptr (GHashTable) by_id = NULL;
+  GSequenceIter *iter;
   GList *new_apps;
-  int removed;
-  int added = 0;
+  guint position = 0, removed = 0, added = 0;
+  /* Span of changed items in the updated sequence */
+  guint first = G_MAXUINT, end = 0;
 
   new_apps = g_app_info_get_all ();
 
-  removed = g_sequence_get_length (priv->items);
+  /* Desktop ID → new GAppInfo for all apps we want to show */
+  by_id = g_hash_table_new (g_str_hash, g_str_equal);
+  for (GList *l = new_apps; l; l = l->next) {
+    GAppInfo *info = G_APP_INFO (l->data);
+    const char *id = g_app_info_get_id (info);
 
-  g_sequence_remove_range (g_sequence_get_begin_iter (priv->items),
-                           g_sequence_get_end_iter (priv->items));
+    if (id == NULL || !g_app_info_should_show (info))
+      continue;
 
-  while ((new_apps = g_list_next (new_apps))) {
-    if (!g_app_info_should_show (G_APP_INFO (new_apps->data))) {
+    g_hash_table_insert (by_id, (gpointer) id, info);
+  }
+
+  /* The GSequence gets modified below, drop the lookup cache */
+  priv->last.is_valid = FALSE;
+  priv->last.iter = NULL;
+  priv->last.position = 0;
+
+  /* Walk the current items: keep unchanged ones, replace changed ones in
+   * place and drop vanished ones. Listeners only hear about it once the
+   * sequence is fully updated so the changes are merged into a single
+   * items-changed emission. */
+  iter = g_sequence_get_begin_iter (priv->items);
+  while (!g_sequence_iter_is_end (iter)) {
+    GAppInfo *info = g_sequence_get (iter);
+    const char *id = g_app_info_get_id (info);
+    GAppInfo *new_info = id ? g_hash_table_lookup (by_id, id) : NULL;
+
+    if (new_info && app_info_unchanged (info, new_info)) {
+      g_hash_table_remove (by_id, id);
+      iter = g_sequence_iter_next (iter);
+      position++;
       continue;
     }
-    g_sequence_append (priv->items, g_object_ref (new_apps->data));
+
+    g_hash_table_remove (priv->search_index, info);
+    if (id)
+      g_hash_table_remove (priv->by_id, id);
+    if (new_info) {
+      /* Desktop file changed, swap in the new info */
+      g_hash_table_remove (by_id, id);
+      add_search_index (self, new_info);
+      g_sequence_set (iter, g_object_ref (new_info));
+      note_change (&first, &end, position, 1);
+      iter = g_sequence_iter_next (iter);
+      position++;
+      removed++;
+      added++;
+    } else {
+      GSequenceIter *next = g_sequence_iter_next (iter);
+
+      g_sequence_remove (iter);
+      note_change (&first, &end, position, 0);
+      iter = next;
+      removed++;
+    }
+  }
+
+  /* Whatever is left in the lookup table is new, append it in the order
+   * gio handed it to us */
+  for (GList *l = new_apps; l; l = l->next) {
+    GAppInfo *info = G_APP_INFO (l->data);
+    const char *id = g_app_info_get_id (info);
+
+    if (id == NULL || g_hash_table_lookup (by_id, id) != info)
+      continue;
+
+    add_search_index (self, info);
+    g_sequence_append (priv->items, g_object_ref (info));
+    note_change (&first, &end, position, 1);
+    position++;
     added++;
   }
 
   g_list_free_full (new_apps, g_object_unref);
 
-  priv->last.is_valid = FALSE;
-  priv->last.iter = NULL;
-  priv->last.position = 0;
-
-  g_list_model_items_changed (G_LIST_MODEL (self), 0, removed, added);
+  /* Resolve app ids against the new items from now on */
+  g_hash_table_remove_all (priv->app_ids);
 
   priv->debounce = 0;
 
+  /* Unchanged items between the changes are reported as replaced */
+  if (removed || added) {
+    guint n_added = end - first;
+
+    g_list_model_items_changed (G_LIST_MODEL (self), first,
+                                n_added - added + removed, n_added);
+  }
+
   return G_SOURCE_REMOVE;
 }
 
@@ -155,6 +411,9 @@ on_monitor_changed_cb (GAppInfoMonitor *monitor,
   PhoshAppListModel *self = PHOSH_APP_LIST_MODEL (data);
   PhoshAppListModelPrivate *priv = phosh_app_list_model_get_instance_private (self);
 
+  /* Don't hand out stale app infos until the model catches up */
+  g_hash_table_remove_all (priv->app_ids);
+
   if (priv->debounce != 0) {
     g_source_remove (priv->debounce);
   }
@@ -172,6 +431,12 @@ phosh_app_list_model_init (PhoshAppListModel *self)
   priv->last.is_valid = FALSE;
 
   priv->items = g_sequence_new ((GDestroyNotify) g_object_unref);
+  priv->search_index = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                              g_object_unref, g_free);
+  priv->by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                       g_free, g_object_unref);
+  priv->app_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, clear_app_info);
   priv->monitor = g_app_info_monitor_get ();
   g_signal_connect (priv->monitor, "changed", G_CALLBACK (on_monitor_changed_cb), self);
 
@@ -195,3 +460,217 @@ phosh_app_list_model_get_default (void)
 
   return instance;
 }
+
+/**
+ * phosh_app_list_model_get_search_index:
+ * @self: The #PhoshAppListModel
+ * @info: A #GAppInfo that is an item of @self
+ *
+ * Gets the search index of an app. The index is built once when
+ * the app is added to the model.
+ *
+ * Returns: (transfer none) (nullable): The search index or %NULL if
+ *  @info isn't part of @self.
+ */
+const PhoshAppSearchIndex *
+phosh_app_list_model_get_search_index (PhoshAppListModel *self,
+                                       GAppInfo          *info)
+{
+  PhoshAppListModelPrivate *priv;
+
+  g_return_val_if_fail (PHOSH_IS_APP_LIST_MODEL (self), NULL);
+  g_return_val_if_fail (G_IS_APP_INFO (info), NULL);
+  priv = phosh_app_list_model_get_instance_private (self);
+
+  return g_hash_table_lookup (priv->search_index, info);
+}
+
+static GAppInfo *
+lookup_desktop_id (PhoshAppListModel *self, const gchar *desktop_id)
+{
+  PhoshAppListModelPrivate *priv = phosh_app_list_model_get_instance_private (self);
+  GAppInfo *info;
+
+  /* Items might be stale while an update is pending */
+  info = priv->debounce ? NULL : g_hash_table_lookup (priv->by_id, desktop_id);
+  if (info)
+    return g_object_ref (info);
+
+  /* Not loaded yet, changed or not shown in the app grid (e.g. NoDisplay) */
+  return (GAppInfo *) g_desktop_app_info_new (desktop_id);
+}
+
+/**
+ * phosh_app_list_model_lookup_app_id:
+ * @self: The #PhoshAppListModel
+ * @app_id: An app id like a window's app_id or a desktop file id
+ *
+ * Resolves @app_id to the app it belongs to. A ".desktop" suffix is
+ * optional. Broken app ids are fixed up via phosh_fix_app_id().  The
+ * app infos of @self are reused so usually no desktop file needs to be
+ * parsed. Results are cached until the installed apps change.
+ *
+ * Returns: (transfer full) (nullable): The #GAppInfo or %NULL if no
+ *   app matches @app_id
+ */
+GAppInfo *
+phosh_app_list_model_lookup_app_id (PhoshAppListModel *self,
+                                    const gchar       *app_id)
+{
+  PhoshAppListModelPrivate *priv;
+  g_autofree gchar *desktop_id = NULL;
+  GAppInfo *info = NULL;
+
+  g_return_val_if_fail (PHOSH_IS_APP_LIST_MODEL (self), NULL);
+  g_return_val_if_fail (app_id, NULL);
+  priv = phosh_app_list_model_get_instance_private (self);
+
+  if (*app_id == '\0')
+    return NULL;
+
+  if (g_hash_table_lookup_extended (priv->app_ids, app_id, NULL, (gpointer *) &info))
+    return info ? g_object_ref (info) : NULL;
+
+  if (g_str_has_suffix (app_id, ".desktop"))
+    desktop_id = g_strdup (app_id);
+  else
+    desktop_id = g_strdup_printf ("%s.desktop", app_id);
+
+  info = lookup_desktop_id (self, desktop_id);
+  if (info == NULL) {
+    g_autofree gchar *name = phosh_fix_app_id (app_id);
+
+    if (g_strcmp0 (name, app_id)) {
+      g_free (desktop_id);
+      desktop_id = g_strdup_printf ("%s.desktop", name);
+      g_debug ("%s has broken app_id, should be %s", app_id, desktop_id);
+      info = lookup_desktop_id (self, desktop_id);
+    }
+  }
+
+  g_hash_table_insert (priv->app_ids, g_strdup (app_id), info ? g_object_ref (info) : NULL);
+
+  return info;
+}
+
+/**
+ * phosh_app_search_index_get_field:
+ * @index: A #PhoshAppSearchIndex
+ * @field: The field to get
+ *
+ * Returns: (transfer none): The casefolded @field, the empty string
+ *  if the app doesn't have that field. Multiple keywords are
+ *  separated by newlines.
+ */
+const gchar *
+phosh_app_search_index_get_field (const PhoshAppSearchIndex *index,
+                                  PhoshAppSearchField        field)
+{
+  g_return_val_if_fail (index, NULL);
+  g_return_val_if_fail (field < PHOSH_APP_SEARCH_FIELD_LAST, NULL);
+
+  return index->data + index->offsets[field];
+}
+
+/**
+ * phosh_app_search_index_match:
+ * @index: A #PhoshAppSearchIndex
+ * @search: The casefolded search term
+ *
+ * Returns: %TRUE if @search is contained in any field of @index
+ */
+gboolean
+phosh_app_search_index_match (const PhoshAppSearchIndex *index,
+                              const gchar               *search)
+{
+  g_return_val_if_fail (index, FALSE);
+  g_return_val_if_fail (search, FALSE);
+
+  for (int i = 0; i < PHOSH_APP_SEARCH_FIELD_LAST; i++) {
+    const gchar *field = index->data + index->offsets[i];
+
+    if (*field != '\0' && strstr (field, search))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+static gboolean
+is_word_start (const gchar *field, const gchar *pos)
+{
+  gunichar c;
+
+  if (pos == field)
+    return TRUE;
+
+  c = g_utf8_get_char (g_utf8_prev_char (pos));
+  return !g_unichar_isalnum (c);
+}
+
+/* Score of a match at the start of a field, at a word boundary or anywhere */
+static const struct {
+  PhoshAppSearchField field;
+  guint               prefix;
+  guint               word;
+  guint               substring;
+} field_scores[] = {
+  { PHOSH_APP_SEARCH_FIELD_NAME,         100, 80, 60 },
+  { PHOSH_APP_SEARCH_FIELD_DISPLAY_NAME, 100, 80, 60 },
+  { PHOSH_APP_SEARCH_FIELD_KEYWORDS,      50, 50, 40 },
+  { PHOSH_APP_SEARCH_FIELD_GENERIC_NAME,  35, 35, 30 },
+  { PHOSH_APP_SEARCH_FIELD_CATEGORIES,    25, 25, 20 },
+  { PHOSH_APP_SEARCH_FIELD_EXECUTABLE,    25, 25, 20 },
+  { PHOSH_APP_SEARCH_FIELD_DESCRIPTION,   10, 10,  5 },
+};
+
+/**
+ * phosh_app_search_index_score:
+ * @index: A #PhoshAppSearchIndex
+ * @search: The casefolded search term
+ *
+ * Scores how well @search matches an app. A prefix match on the
+ * name ranks highest followed by a match at a word boundary in the
+ * name, a keyword match and finally a match in the description.
+ *
+ * Returns: The score or `0` if @search doesn't match at all.
+ */
+guint
+phosh_app_search_index_score (const PhoshAppSearchIndex *index,
+                              const gchar               *search)
+{
+  guint score = 0;
+
+  g_return_val_if_fail (index, 0);
+  g_return_val_if_fail (search, 0);
+
+  for (int i = 0; i < G_N_ELEMENTS (field_scores); i++) {
+    const gchar *field = index->data + index->offsets[field_scores[i].field];
+    const gchar *match;
+    guint field_score;
+
+    /* Fields are ordered by their best score */
+    if (score >= field_scores[i].prefix)
+      break;
+
+    if (*field == '\0' || (match = strstr (field, search)) == NULL)
+      continue;
+
+    if (match == field) {
+      field_score = field_scores[i].prefix;
+    } else {
+      field_score = field_scores[i].substring;
+      for (; match; match = strstr (match + 1, search)) {
+        if (is_word_start (field, match)) {
+          field_score = field_scores[i].word;
+          break;
+        }
+      }
+    }
+
+    score = MAX (score, field_score);
+  }
+
+  return score;
+}
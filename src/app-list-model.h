@@ -19,6 +19,35 @@ struct _PhoshAppListModelClass
   GObjectClass parent_class;
 };
 
-PhoshAppListModel *phosh_app_list_model_get_default (void);
+/**
+ * PhoshAppSearchField:
+ *
+ * The casefolded fields of an app's #PhoshAppSearchIndex
+ */
+typedef enum {
+  PHOSH_APP_SEARCH_FIELD_NAME,
+  PHOSH_APP_SEARCH_FIELD_DISPLAY_NAME,
+  PHOSH_APP_SEARCH_FIELD_GENERIC_NAME,
+  PHOSH_APP_SEARCH_FIELD_KEYWORDS,
+  PHOSH_APP_SEARCH_FIELD_CATEGORIES,
+  PHOSH_APP_SEARCH_FIELD_EXECUTABLE,
+  PHOSH_APP_SEARCH_FIELD_DESCRIPTION,
+  PHOSH_APP_SEARCH_FIELD_LAST,
+} PhoshAppSearchField;
+
+typedef struct _PhoshAppSearchIndex PhoshAppSearchIndex;
+
+PhoshAppListModel         *phosh_app_list_model_get_default      (void);
+GAppInfo                  *phosh_app_list_model_lookup_app_id    (PhoshAppListModel *self,
+                                                                  const gchar       *app_id);
+const PhoshAppSearchIndex *phosh_app_list_model_get_search_index (PhoshAppListModel *self,
+                                                                  GAppInfo          *info);
+
+const gchar               *phosh_app_search_index_get_field      (const PhoshAppSearchIndex *index,
+                                                                  PhoshAppSearchField        field);
+gboolean                   phosh_app_search_index_match          (const PhoshAppSearchIndex *index,
+                                                                  const gchar               *search);
+guint                      phosh_app_search_index_score          (const PhoshAppSearchIndex *index,
+                                                                  const gchar               *search);
 
 G_END_DECLS
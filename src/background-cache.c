@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#define G_LOG_DOMAIN "phosh-background-cache"
+
+#include "background-cache.h"
+
+#include <glib/gstdio.h>
+
+#include <errno.h>
+
+/**
+ * SECTION:phosh-background-cache
+ * @short_description: A size limited cache for decoded background images
+ * @Title: PhoshBackgroundCache
+ *
+ * Keeps decoded background images and their scaled variants around so
+ * multiple outputs and rotations don't need to decode the same file
+ * again. Least recently used entries are dropped once the cache exceeds
+ * its size limit. The cache can be used from multiple threads.
+ */
+
+typedef struct _CacheEntry {
+  gchar     *key;
+  GdkPixbuf *pixbuf;
+  gsize      size;
+  GList      link;
+} CacheEntry;
+
+struct _PhoshBackgroundCache {
+  GObject     parent;
+
+  GMutex      lock;
+  GHashTable *entries;  /* key → CacheEntry */
+  GQueue      lru;      /* most recently used first */
+  gsize       size;
+  gsize       max_bytes;
+
+  /* Serializes decoding so concurrent lookups decode a file only once */
+  GMutex      decode_lock;
+};
+
+G_DEFINE_TYPE (PhoshBackgroundCache, phosh_background_cache, G_TYPE_OBJECT);
+
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+  g_free (entry->key);
+  g_object_unref (entry->pixbuf);
+  g_free (entry);
+}
+
+
+static gsize
+pixbuf_size (GdkPixbuf *pixbuf)
+{
+  return (gsize) gdk_pixbuf_get_rowstride (pixbuf) * gdk_pixbuf_get_height (pixbuf);
+}
+
+
+/* Must be called with the lock held */
+static void
+evict (PhoshBackgroundCache *self)
+{
+  while (self->size > self->max_bytes && self->lru.tail) {
+    CacheEntry *entry = self->lru.tail->data;
+
+    g_debug ("Evicting %s (%" G_GSIZE_FORMAT " bytes)", entry->key, entry->size);
+    g_queue_unlink (&self->lru, &entry->link);
+    self->size -= entry->size;
+    g_hash_table_remove (self->entries, entry->key);
+  }
+}
+
+
+static void
+phosh_background_cache_finalize (GObject *object)
+{
+  PhoshBackgroundCache *self = PHOSH_BACKGROUND_CACHE (object);
+
+  g_hash_table_destroy (self->entries);
+  g_mutex_clear (&self->lock);
+  g_mutex_clear (&self->decode_lock);
+
+  G_OBJECT_CLASS (phosh_background_cache_parent_class)->finalize (object);
+}
+
+
+static void
+phosh_background_cache_class_init (PhoshBackgroundCacheClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = phosh_background_cache_finalize;
+}
+
+
+static void
+phosh_background_cache_init (PhoshBackgroundCache *self)
+{
+  g_mutex_init (&self->lock);
+  g_mutex_init (&self->decode_lock);
+  g_queue_init (&self->lru);
+  self->entries = g_hash_table_new_full (g_str_hash,
+                                         g_str_equal,
+                                         NULL,
+                                         (GDestroyNotify) cache_entry_free);
+}
+
+
+/**
+ * phosh_background_cache_new:
+ * @max_bytes: The maximum amount of pixel data to keep around
+ *
+ * Returns: A new #PhoshBackgroundCache
+ */
+PhoshBackgroundCache *
+phosh_background_cache_new (gsize max_bytes)
+{
+  PhoshBackgroundCache *self = g_object_new (PHOSH_TYPE_BACKGROUND_CACHE, NULL);
+
+  self->max_bytes = max_bytes;
+  return self;
+}
+
+
+/**
+ * phosh_background_cache_lookup:
+ * @self: The #PhoshBackgroundCache
+ * @key: The key to look up
+ *
+ * Returns: (transfer full) (nullable): The cached pixbuf or %NULL
+ */
+GdkPixbuf *
+phosh_background_cache_lookup (PhoshBackgroundCache *self, const gchar *key)
+{
+  CacheEntry *entry;
+  GdkPixbuf *pixbuf = NULL;
+
+  g_return_val_if_fail (PHOSH_IS_BACKGROUND_CACHE (self), NULL);
+  g_return_val_if_fail (key, NULL);
+
+  g_mutex_lock (&self->lock);
+  entry = g_hash_table_lookup (self->entries, key);
+  if (entry) {
+    g_queue_unlink (&self->lru, &entry->link);
+    g_queue_push_head_link (&self->lru, &entry->link);
+    pixbuf = g_object_ref (entry->pixbuf);
+  }
+  g_mutex_unlock (&self->lock);
+
+  return pixbuf;
+}
+
+
+/**
+ * phosh_background_cache_insert:
+ * @self: The #PhoshBackgroundCache
+ * @key: The key to store @pixbuf under
+ * @pixbuf: The pixbuf to cache
+ *
+ * Adds @pixbuf to the cache replacing any previous entry for @key.
+ * Pixbufs larger than the cache itself are not stored.
+ */
+void
+phosh_background_cache_insert (PhoshBackgroundCache *self,
+                               const gchar          *key,
+                               GdkPixbuf            *pixbuf)
+{
+  CacheEntry *entry, *old;
+  gsize size;
+
+  g_return_if_fail (PHOSH_IS_BACKGROUND_CACHE (self));
+  g_return_if_fail (key);
+  g_return_if_fail (GDK_IS_PIXBUF (pixbuf));
+
+  size = pixbuf_size (pixbuf);
+  if (size > self->max_bytes) {
+    g_debug ("Not caching %s, %" G_GSIZE_FORMAT " bytes exceeds limit", key, size);
+    return;
+  }
+
+  entry = g_new0 (CacheEntry, 1);
+  entry->key = g_strdup (key);
+  entry->pixbuf = g_object_ref (pixbuf);
+  entry->size = size;
+  entry->link.data = entry;
+
+  g_mutex_lock (&self->lock);
+  old = g_hash_table_lookup (self->entries, key);
+  if (old) {
+    g_queue_unlink (&self->lru, &old->link);
+    self->size -= old->size;
+  }
+  g_hash_table_replace (self->entries, entry->key, entry);
+  g_queue_push_head_link (&self->lru, &entry->link);
+  self->size += size;
+  evict (self);
+  g_mutex_unlock (&self->lock);
+}
+
+
+/**
+ * phosh_background_cache_get_image:
+ * @self: The #PhoshBackgroundCache
+ * @path: The image file to load
+ * @width: The width to decode the image at or -1 for the image's width
+ * @height: The height to decode the image at or -1 for the image's height
+ * @mtime: (out) (optional): The modification time of @path
+ * @error: Return location for error
+ *
+ * Gets the decoded image at @path. The file is only decoded if it isn't
+ * cached yet at that size or was modified since it was cached. Use
+ * @mtime to build cache keys for derived images.
+ *
+ * When @width and @height are given the image is scaled while decoding
+ * so large files don't need to be decoded at full resolution.
+ *
+ * Returns: (transfer full) (nullable): The decoded image
+ */
+GdkPixbuf *
+phosh_background_cache_get_image (PhoshBackgroundCache *self,
+                                  const gchar          *path,
+                                  gint                  width,
+                                  gint                  height,
+                                  gint64               *mtime,
+                                  GError              **error)
+{
+  g_autofree gchar *key = NULL;
+  GdkPixbuf *image;
+  GStatBuf st;
+
+  g_return_val_if_fail (PHOSH_IS_BACKGROUND_CACHE (self), NULL);
+  g_return_val_if_fail (path, NULL);
+
+  if (g_stat (path, &st) != 0) {
+    int saved_errno = errno;
+
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved_errno),
+                 "Failed to stat %s: %s", path, g_strerror (saved_errno));
+    return NULL;
+  }
+
+  if (mtime)
+    *mtime = st.st_mtime;
+
+  key = g_strdup_printf ("image:%s:%" G_GINT64_FORMAT ":%dx%d",
+                         path, (gint64) st.st_mtime, width, height);
+
+  g_mutex_lock (&self->decode_lock);
+  image = phosh_background_cache_lookup (self, key);
+  if (image == NULL) {
+    g_debug ("Decoding %s at %dx%d", path, width, height);
+    /* Scales in the loader, JPEGs get DCT scaled */
+    image = gdk_pixbuf_new_from_file_at_scale (path, width, height, TRUE, error);
+    if (image)
+      phosh_background_cache_insert (self, key, image);
+  }
+  g_mutex_unlock (&self->decode_lock);
+
+  return image;
+}
+
+
+/**
+ * phosh_background_cache_get_size:
+ * @self: The #PhoshBackgroundCache
+ *
+ * Returns: The amount of pixel data currently cached in bytes
+ */
+gsize
+phosh_background_cache_get_size (PhoshBackgroundCache *self)
+{
+  gsize size;
+
+  g_return_val_if_fail (PHOSH_IS_BACKGROUND_CACHE (self), 0);
+
+  g_mutex_lock (&self->lock);
+  size = self->size;
+  g_mutex_unlock (&self->lock);
+
+  return size;
+}
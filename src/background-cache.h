@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define PHOSH_TYPE_BACKGROUND_CACHE (phosh_background_cache_get_type())
+
+G_DECLARE_FINAL_TYPE (PhoshBackgroundCache,
+                      phosh_background_cache,
+                      PHOSH,
+                      BACKGROUND_CACHE,
+                      GObject)
+
+PhoshBackgroundCache *phosh_background_cache_new          (gsize                 max_bytes);
+GdkPixbuf            *phosh_background_cache_get_image    (PhoshBackgroundCache *self,
+                                                           const gchar          *path,
+                                                           gint                  width,
+                                                           gint                  height,
+                                                           gint64               *mtime,
+                                                           GError              **error);
+GdkPixbuf            *phosh_background_cache_lookup       (PhoshBackgroundCache *self,
+                                                           const gchar          *key);
+void                  phosh_background_cache_insert       (PhoshBackgroundCache *self,
+                                                           const gchar          *key,
+                                                           GdkPixbuf            *pixbuf);
+gsize                 phosh_background_cache_get_size     (PhoshBackgroundCache *self);
+
+G_END_DECLS
@@ -7,6 +7,7 @@
 #define G_LOG_DOMAIN "phosh-background-manager"
 
 #include "background-manager.h"
+#include "background-cache.h"
 #include "background.h"
 #include "monitor/monitor.h"
 #include "phosh-wayland.h"
@@ -15,6 +16,13 @@
 
 #include <gdk/gdkwayland.h>
 
+/*
+ * Enough for a decoded 4K wallpaper plus its scaled variants for a
+ * couple of outputs and orientations without hurting devices with
+ * 2-3 GB of RAM.
+ */
+#define BACKGROUND_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
 /**
  * SECTION:phosh-background-manager
  * @short_description: Tracks screen related events and updates
@@ -25,6 +33,8 @@
 struct _PhoshBackgroundManager {
   GObject parent;
   GHashTable *backgrounds;
+  PhoshBackgroundCache *cache;
+  PhoshMonitor *primary_monitor;
 };
 
 G_DEFINE_TYPE (PhoshBackgroundManager, phosh_background_manager, G_TYPE_OBJECT);
@@ -39,12 +49,15 @@ create_background_for_monitor (PhoshBackgroundManager *self, PhoshMonitor *monit
   PhoshBackground *background;
 
   primary_monitor = phosh_shell_get_primary_monitor (shell);
+  if (monitor == primary_monitor)
+    self->primary_monitor = monitor;
   background = g_object_ref_sink(PHOSH_BACKGROUND (phosh_background_new (
                                                      phosh_wayland_get_zwlr_layer_shell_v1(wl),
                                                      monitor->wl_output,
                                                      monitor->width / monitor->scale,
                                                      monitor->height / monitor->scale,
-                                                     monitor == primary_monitor)));
+                                                     monitor == primary_monitor,
+                                                     self->cache)));
   g_hash_table_insert (self->backgrounds,
                        g_object_ref (monitor),
                        background);
@@ -69,19 +82,6 @@ create_all_backgrounds (PhoshBackgroundManager *self)
 }
 
 
-static void
-on_monitor_removed (PhoshBackgroundManager *self,
-                    PhoshMonitor           *monitor,
-                    PhoshMonitorManager    *monitormanager)
-{
-  g_return_if_fail (PHOSH_IS_BACKGROUND_MANAGER (self));
-  g_return_if_fail (PHOSH_IS_MONITOR (monitor));
-
-  g_debug ("Monitor %p removed", monitor);
-  g_return_if_fail (g_hash_table_remove (self->backgrounds, monitor));
-}
-
-
 static void
 on_monitor_configured (PhoshBackgroundManager *self,
                        PhoshMonitor *monitor)
@@ -93,19 +93,49 @@ on_monitor_configured (PhoshBackgroundManager *self,
 
 
 static void
-on_monitor_added (PhoshBackgroundManager *self,
-                  PhoshMonitor           *monitor,
-                  PhoshMonitorManager    *unused)
+on_monitors_changed (PhoshBackgroundManager *self,
+                     GPtrArray              *added,
+                     GPtrArray              *removed,
+                     PhoshMonitorManager    *monitormanager)
 {
   g_return_if_fail (PHOSH_IS_BACKGROUND_MANAGER (self));
-  g_return_if_fail (PHOSH_IS_MONITOR (monitor));
 
-  g_debug ("Monitor %p added", monitor);
+  for (int i = 0; i < removed->len; i++) {
+    PhoshMonitor *monitor = g_ptr_array_index (removed, i);
 
-  g_signal_connect_object (monitor, "configured",
-                           G_CALLBACK (on_monitor_configured),
-                           self,
-                           G_CONNECT_SWAPPED);
+    g_debug ("Monitor %p removed", monitor);
+    g_signal_handlers_disconnect_by_func (monitor, on_monitor_configured, self);
+    g_hash_table_remove (self->backgrounds, monitor);
+    if (monitor == self->primary_monitor)
+      self->primary_monitor = NULL;
+  }
+
+  for (int i = 0; i < added->len; i++) {
+    PhoshMonitor *monitor = g_ptr_array_index (added, i);
+
+    g_debug ("Monitor %p added", monitor);
+    if (phosh_monitor_is_configured (monitor)) {
+      create_background_for_monitor (self, monitor);
+      continue;
+    }
+
+    g_signal_connect_object (monitor, "configured",
+                             G_CALLBACK (on_monitor_configured),
+                             self,
+                             G_CONNECT_SWAPPED);
+  }
+}
+
+
+/* Only the old and the new primary monitor need new backgrounds */
+static void
+update_background_for_monitor (PhoshBackgroundManager *self, PhoshMonitor *monitor)
+{
+  if (monitor == NULL || !g_hash_table_contains (self->backgrounds, monitor))
+    return;
+
+  g_hash_table_remove (self->backgrounds, monitor);
+  create_background_for_monitor (self, monitor);
 }
 
 
@@ -114,10 +144,19 @@ on_primary_monitor_changed (PhoshBackgroundManager *self,
                             GParamSpec *pspec,
                             PhoshShell *shell)
 {
+  PhoshMonitor *primary_monitor, *old_primary;
+
   g_return_if_fail (PHOSH_IS_BACKGROUND_MANAGER (self));
   g_return_if_fail (PHOSH_IS_SHELL (shell));
 
-  create_all_backgrounds (self);
+  primary_monitor = phosh_shell_get_primary_monitor (shell);
+  if (primary_monitor == self->primary_monitor)
+    return;
+
+  old_primary = self->primary_monitor;
+  self->primary_monitor = NULL;
+  update_background_for_monitor (self, old_primary);
+  update_background_for_monitor (self, primary_monitor);
 }
 
 
@@ -126,7 +165,8 @@ phosh_background_manager_dispose (GObject *object)
 {
   PhoshBackgroundManager *self = PHOSH_BACKGROUND_MANAGER (object);
 
-  g_hash_table_destroy (self->backgrounds);
+  g_clear_pointer (&self->backgrounds, g_hash_table_destroy);
+  g_clear_object (&self->cache);
   G_OBJECT_CLASS (phosh_background_manager_parent_class)->dispose (object);
 }
 
@@ -141,12 +181,8 @@ phosh_background_manager_constructed (GObject *object)
   G_OBJECT_CLASS (phosh_background_manager_parent_class)->constructed (object);
 
   /* Listen for monitor changes */
-  g_signal_connect_object (monitor_manager, "monitor-added",
-                           G_CALLBACK (on_monitor_added),
-                           self,
-                           G_CONNECT_SWAPPED);
-  g_signal_connect_object (monitor_manager, "monitor-removed",
-                           G_CALLBACK (on_monitor_removed),
+  g_signal_connect_object (monitor_manager, "monitors-changed",
+                           G_CALLBACK (on_monitors_changed),
                            self,
                            G_CONNECT_SWAPPED);
   g_signal_connect_object (shell, "notify::primary-monitor",
@@ -175,6 +211,7 @@ phosh_background_manager_init (PhoshBackgroundManager *self)
                                              g_direct_equal,
                                              g_object_unref,
                                              (GDestroyNotify)gtk_widget_destroy);
+  self->cache = phosh_background_cache_new (BACKGROUND_CACHE_MAX_BYTES);
 }
 
 
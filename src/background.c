@@ -37,6 +37,7 @@
 enum {
   PROP_0,
   PROP_PRIMARY,
+  PROP_CACHE,
   PROP_LAST_PROP
 };
 static GParamSpec *props[PROP_LAST_PROP];
@@ -57,10 +58,27 @@ struct _PhoshBackground
   GdkRGBA color;
 
   gboolean primary;
-  GdkPixbuf *pixbuf;
   GSettings *settings;
+
+  /* The scaled image converted to cairo's format once per load */
+  cairo_surface_t *surface;
+  gint surface_width;
+  gint surface_height;
+
+  GCancellable *cancel;
+  PhoshBackgroundCache *cache;
 };
 
+typedef struct _LoadData {
+  PhoshBackgroundCache    *cache;
+  gchar                   *path;
+  gint                     width;
+  gint                     height;
+  gint                     scale;
+  GDesktopBackgroundStyle  style;
+  GdkRGBA                  color;
+} LoadData;
+
 
 G_DEFINE_TYPE (PhoshBackground, phosh_background, PHOSH_TYPE_LAYER_SURFACE);
 
@@ -77,6 +95,9 @@ phosh_background_set_property (GObject *object,
   case PROP_PRIMARY:
     phosh_background_set_primary (self, g_value_get_boolean (value));
     break;
+  case PROP_CACHE:
+    self->cache = g_value_dup_object (value);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     break;
@@ -96,6 +117,9 @@ phosh_background_get_property (GObject *object,
   case PROP_PRIMARY:
     g_value_set_boolean (value, self->primary);
     break;
+  case PROP_CACHE:
+    g_value_set_object (value, self->cache);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     break;
@@ -226,48 +250,201 @@ image_background (GdkPixbuf               *image,
 }
 
 
+/*
+ * Determine the size to decode the image at so we don't decode more
+ * pixels than needed to fill an output of @width x @height.
+ */
 static void
-load_background (PhoshBackground *self)
+get_decode_size (const gchar             *path,
+                 gint                     width,
+                 gint                     height,
+                 GDesktopBackgroundStyle  style,
+                 gint                    *decode_width,
+                 gint                    *decode_height)
 {
+  gint src_width, src_height;
+  double factor;
+
+  *decode_width = *decode_height = -1;
+
+  if (!gdk_pixbuf_get_file_info (path, &src_width, &src_height) ||
+      src_width <= 0 || src_height <= 0)
+    return;
+
+  switch (style) {
+  case G_DESKTOP_BACKGROUND_STYLE_SCALED:
+    factor = MIN (width / (double) src_width, height / (double) src_height);
+    break;
+  case G_DESKTOP_BACKGROUND_STYLE_NONE:
+  case G_DESKTOP_BACKGROUND_STYLE_WALLPAPER:
+  case G_DESKTOP_BACKGROUND_STYLE_CENTERED:
+  case G_DESKTOP_BACKGROUND_STYLE_STRETCHED:
+  case G_DESKTOP_BACKGROUND_STYLE_SPANNED:
+  case G_DESKTOP_BACKGROUND_STYLE_ZOOM:
+  default:
+    /* See image_background () */
+    factor = MAX (width / (double) src_width, height / (double) src_height);
+    break;
+  }
+
+  /* Upscaling happens after decoding */
+  if (factor >= 1.0)
+    return;
+
+  *decode_width = MAX (1, ceil (src_width * factor));
+  *decode_height = MAX (1, ceil (src_height * factor));
+}
+
+
+static void
+load_data_free (LoadData *data)
+{
+  g_clear_object (&data->cache);
+  g_free (data->path);
+  g_free (data);
+}
+
+
+static void
+load_background_thread (GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable)
+{
+  LoadData *data = task_data;
   g_autoptr(GdkPixbuf) image = NULL;
-  GError *err = NULL;
+  g_autoptr(GError) err = NULL;
+  g_autofree gchar *key = NULL;
+  GDesktopBackgroundStyle style = data->style;
+  GdkPixbuf *pixbuf;
+  gint64 mtime = 0;
+  gint decode_width, decode_height;
+
+  /* No need to decode anything for a solid fill */
+  if (data->path && style != G_DESKTOP_BACKGROUND_STYLE_NONE) {
+    get_decode_size (data->path, data->width, data->height, style,
+                     &decode_width, &decode_height);
+    image = phosh_background_cache_get_image (data->cache, data->path,
+                                              decode_width, decode_height,
+                                              &mtime, &err);
+    if (!image)
+      g_warning ("Failed to load background: %s", err ? err->message : "unknown error");
+  }
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  if (image) {
+    /* Other outputs or an earlier rotation might have needed the same */
+    key = g_strdup_printf ("scaled:%s:%" G_GINT64_FORMAT ":%dx%d@%d:%d:%08x",
+                           data->path, mtime, data->width, data->height, data->scale,
+                           style, COLOR_TO_PIXEL((&data->color)));
+    pixbuf = phosh_background_cache_lookup (data->cache, key);
+    if (pixbuf) {
+      g_task_return_pointer (task, pixbuf, g_object_unref);
+      return;
+    }
+  }
+
+  /* Fallback to solid fill if  image can't be loaded */
+  if (!image)
+    style = G_DESKTOP_BACKGROUND_STYLE_NONE;
+
+  pixbuf = image_background (image, data->width, data->height, style, &data->color);
+  if (!pixbuf) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                             "Failed to scale background to %dx%d", data->width, data->height);
+    return;
+  }
+
+  if (key)
+    phosh_background_cache_insert (data->cache, key, pixbuf);
+
+  g_task_return_pointer (task, pixbuf, g_object_unref);
+}
+
+
+static void
+on_background_loaded (GObject      *source_object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  PhoshBackground *self;
+  g_autoptr(GError) err = NULL;
+  GdkPixbuf *pixbuf;
+
+  pixbuf = g_task_propagate_pointer (G_TASK (res), &err);
+  if (!pixbuf) {
+    /* A newer request superseded us or we're being disposed */
+    if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      g_warning ("Failed to load background: %s", err->message);
+    return;
+  }
+
+  self = PHOSH_BACKGROUND (source_object);
+  g_clear_object (&self->cancel);
+
+  /* Convert once so drawing doesn't need to on every frame */
+  g_clear_pointer (&self->surface, cairo_surface_destroy);
+  self->surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, 1,
+                                                        gtk_widget_get_window (GTK_WIDGET (self)));
+  self->surface_width = gdk_pixbuf_get_width (pixbuf);
+  self->surface_height = gdk_pixbuf_get_height (pixbuf);
+  g_object_unref (pixbuf);
+
+  /* force background redraw */
+  gtk_widget_queue_draw (GTK_WIDGET (self));
+  g_signal_emit(self, signals[BACKGROUND_LOADED], 0);
+}
+
+
+static void
+load_background (PhoshBackground *self)
+{
+  GTask *task;
+  LoadData *data;
   gint width, height, scale = gtk_widget_get_scale_factor(GTK_WIDGET(self));
-  GDesktopBackgroundStyle style = self->style;
 
-  g_clear_object (&self->pixbuf);
+  /* Only the latest request matters */
+  g_cancellable_cancel (self->cancel);
+  g_clear_object (&self->cancel);
+  self->cancel = g_cancellable_new ();
+
+  data = g_new0 (LoadData, 1);
+  data->cache = g_object_ref (self->cache);
+  data->scale = scale;
+  data->style = self->style;
+  data->color = self->color;
 
   /* FIXME: support GnomeDesktop.BGSlideShow as well */
   if (!g_str_has_prefix(self->uri, "file:///")) {
     g_warning ("Only file URIs supported for backgrounds not %s", self->uri);
   } else {
-    g_autofree gchar *path = g_uri_unescape_string (&self->uri[strlen("file://")], NULL);
-    if (!path) {
+    data->path = g_uri_unescape_string (&self->uri[strlen("file://")], NULL);
+    if (!data->path)
       g_warning ("Invalid background URI: %s", self->uri);
-    } else {
-      image = gdk_pixbuf_new_from_file (path, &err);
-      if (!image) {
-        const char *reason = err ? err->message : "unknown error";
-        g_warning ("Failed to load background: %s", reason);
-        if (err)
-          g_clear_error (&err);
-      }
-    }
   }
 
-  /* Fallback to solid fill if  image can't be loaded */
-  if (!image)
-    style = G_DESKTOP_BACKGROUND_STYLE_NONE;
-
   if (self->primary)
     phosh_shell_get_usable_area (phosh_shell_get_default (), NULL, NULL, &width, &height);
   else
     g_object_get (self, "width", &width, "height", &height, NULL);
 
-  self->pixbuf = image_background (image, width * scale, height * scale, style, &self->color);
+  data->width = width * scale;
+  data->height = height * scale;
 
-  /* force background redraw */
-  gtk_widget_queue_draw (GTK_WIDGET (self));
-  g_signal_emit(self, signals[BACKGROUND_LOADED], 0);
+  /* Show the solid color until loaded unless the current image still fits */
+  if (self->surface && (self->surface_width != data->width ||
+                        self->surface_height != data->height)) {
+    g_clear_pointer (&self->surface, cairo_surface_destroy);
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+  }
+
+  task = g_task_new (self, self->cancel, on_background_loaded, NULL);
+  g_task_set_source_tag (task, load_background);
+  g_task_set_task_data (task, data, (GDestroyNotify) load_data_free);
+  g_task_run_in_thread (task, load_background_thread);
+  g_object_unref (task);
 }
 
 
@@ -279,14 +456,20 @@ background_draw_cb (PhoshBackground *self,
   gint x = 0, y = 0, scale = gtk_widget_get_scale_factor (GTK_WIDGET (self));
 
   g_return_val_if_fail (PHOSH_IS_BACKGROUND (self), TRUE);
-  g_return_val_if_fail (GDK_IS_PIXBUF (self->pixbuf), TRUE);
+
+  /* Placeholder while the image is being loaded */
+  if (self->surface == NULL) {
+    gdk_cairo_set_source_rgba (cr, &self->color);
+    cairo_paint (cr);
+    return TRUE;
+  }
 
   if (self->primary)
     phosh_shell_get_usable_area (phosh_shell_get_default (), &x, &y, NULL, NULL);
 
   cairo_save(cr);
   cairo_scale(cr, 1.0 / scale, 1.0 / scale);
-  gdk_cairo_set_source_pixbuf (cr, self->pixbuf, x * scale, y * scale);
+  cairo_set_source_surface (cr, self->surface, x * scale, y * scale);
   cairo_paint (cr);
   cairo_restore(cr);
   return TRUE;
@@ -325,6 +508,19 @@ rotation_notify_cb (PhoshBackground *self,
 }
 
 
+static void
+on_scale_factor_changed (PhoshBackground *self,
+                         GParamSpec      *pspec,
+                         gpointer         unused)
+{
+  g_return_if_fail (PHOSH_IS_BACKGROUND (self));
+
+  /* Surface size in device pixels changed */
+  if (self->uri)
+    load_background (self);
+}
+
+
 static void
 on_phosh_background_configured (PhoshLayerSurface *surface)
 {
@@ -360,6 +556,19 @@ phosh_background_constructed (GObject *object)
                             self);
 
   g_signal_connect (self, "configured", G_CALLBACK (on_phosh_background_configured), self);
+  g_signal_connect (self, "notify::scale-factor", G_CALLBACK (on_scale_factor_changed), NULL);
+}
+
+
+static void
+phosh_background_dispose (GObject *object)
+{
+  PhoshBackground *self = PHOSH_BACKGROUND (object);
+
+  g_cancellable_cancel (self->cancel);
+  g_clear_object (&self->cancel);
+
+  G_OBJECT_CLASS (phosh_background_parent_class)->dispose (object);
 }
 
 
@@ -369,7 +578,8 @@ phosh_background_finalize (GObject *object)
   GObjectClass *parent_class = G_OBJECT_CLASS (phosh_background_parent_class);
   PhoshBackground *self = PHOSH_BACKGROUND (object);
 
-  g_object_unref (self->pixbuf);
+  g_clear_pointer (&self->surface, cairo_surface_destroy);
+  g_clear_object (&self->cache);
   g_clear_pointer (&self->uri, g_free);
   g_clear_object (&self->settings);
 
@@ -382,11 +592,18 @@ phosh_background_class_init (PhoshBackgroundClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+  /**
+   * PhoshBackground::background-loaded:
+   *
+   * Emitted once the background image got decoded and scaled
+   * to the output's size.
+   */
   signals[BACKGROUND_LOADED] = g_signal_new ("background-loaded",
       G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
       NULL, G_TYPE_NONE, 0);
 
   object_class->constructed = phosh_background_constructed;
+  object_class->dispose = phosh_background_dispose;
   object_class->finalize = phosh_background_finalize;
 
   object_class->set_property = phosh_background_set_property;
@@ -407,6 +624,20 @@ phosh_background_class_init (PhoshBackgroundClass *klass)
                           G_PARAM_EXPLICIT_NOTIFY |
                           G_PARAM_CONSTRUCT);
 
+  /**
+   * PhoshBackground:cache:
+   *
+   * The cache for decoded and scaled background images
+   */
+  props[PROP_CACHE] =
+    g_param_spec_object ("cache",
+                         "Cache",
+                         "Background image cache",
+                         PHOSH_TYPE_BACKGROUND_CACHE,
+                         G_PARAM_READWRITE |
+                         G_PARAM_STATIC_STRINGS |
+                         G_PARAM_CONSTRUCT_ONLY);
+
   g_object_class_install_properties (object_class, PROP_LAST_PROP, props);
 }
 
@@ -422,7 +653,8 @@ phosh_background_new (gpointer layer_shell,
                       gpointer wl_output,
                       guint width,
                       guint height,
-                      gboolean primary)
+                      gboolean primary,
+                      PhoshBackgroundCache *cache)
 {
   return g_object_new (PHOSH_TYPE_BACKGROUND,
                        "layer-shell", layer_shell,
@@ -438,6 +670,7 @@ phosh_background_new (gpointer layer_shell,
                        "exclusive-zone", -1,
                        "namespace", "phosh background",
                        "primary", primary,
+                       "cache", cache,
                        NULL);
 }
 
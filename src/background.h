@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "background-cache.h"
 #include "layersurface.h"
 #include "monitor/monitor.h"
 
@@ -20,5 +21,6 @@ GtkWidget *phosh_background_new (gpointer layer_shell,
                                  gpointer wl_output,
                                  guint width,
                                  guint height,
-                                 gboolean primary);
+                                 gboolean primary,
+                                 PhoshBackgroundCache *cache);
 void phosh_background_set_primary (PhoshBackground *self, gboolean primary);
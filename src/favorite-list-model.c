@@ -9,9 +9,25 @@
 #define FAVORITES_KEY "favorites"
 
 #include "favorite-list-model.h"
+#include "app-list-model.h"
 
 #include <gio/gio.h>
 
+/**
+ * SECTION:phosh-favorite-list-model
+ * @short_description: The list of favorite apps
+ * @Title: PhoshFavoriteListModel
+ *
+ * A #GListModel of the favorite apps' #GAppInfo. Interested parties
+ * can connect to #PhoshFavoriteListModel::favorite-changed with the
+ * desktop id as detail to only get notified about a single app.
+ */
+
+enum {
+  FAVORITE_CHANGED,
+  N_SIGNALS
+};
+static guint signals[N_SIGNALS];
 
 typedef struct _PhoshFavoriteListModelPrivate PhoshFavoriteListModelPrivate;
 struct _PhoshFavoriteListModelPrivate {
@@ -23,6 +39,9 @@ struct _PhoshFavoriteListModelPrivate {
   // Cached length of @items
   guint len;
 
+  // Set of all ids in @items_inc_missing
+  GHashTable *favorites;
+
   GSettings *settings;
 };
 
@@ -42,6 +61,7 @@ phosh_favorite_list_model_finalize (GObject *object)
 
   g_clear_pointer (&priv->items_inc_missing, g_strfreev);
   g_clear_pointer (&priv->items, g_strfreev);
+  g_clear_pointer (&priv->favorites, g_hash_table_destroy);
 
   G_OBJECT_CLASS (phosh_favorite_list_model_parent_class)->finalize (object);
 }
@@ -52,6 +72,27 @@ phosh_favorite_list_model_class_init (PhoshFavoriteListModelClass *klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
   gobject_class->finalize = phosh_favorite_list_model_finalize;
+
+  /**
+   * PhoshFavoriteListModel::favorite-changed:
+   * @self: The #PhoshFavoriteListModel
+   * @app_id: The desktop id of the app
+   * @is_favorite: Whether the app is a favorite now
+   *
+   * Emitted once for every app that was added to or removed from the
+   * favorites. The app's desktop id is used as detail.
+   */
+  signals[FAVORITE_CHANGED] = g_signal_new ("favorite-changed",
+                                            G_TYPE_FROM_CLASS (klass),
+                                            G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
+                                            0,
+                                            NULL,
+                                            NULL,
+                                            NULL,
+                                            G_TYPE_NONE,
+                                            2,
+                                            G_TYPE_STRING,
+                                            G_TYPE_BOOLEAN);
 }
 
 static GType
@@ -70,7 +111,8 @@ list_get_item (GListModel *list, guint position)
     return NULL;
   }
 
-  return g_desktop_app_info_new (priv->items[position]);
+  return phosh_app_list_model_lookup_app_id (phosh_app_list_model_get_default (),
+                                             priv->items[position]);
 }
 
 static unsigned int
@@ -96,6 +138,10 @@ favorites_changed (GSettings              *settings,
                    PhoshFavoriteListModel *self)
 {
   PhoshFavoriteListModelPrivate *priv = phosh_favorite_list_model_get_instance_private (self);
+  g_autoptr (GHashTable) old_favorites = NULL;
+  g_autoptr (GPtrArray) flipped = NULL;
+  GHashTableIter iter;
+  gpointer id;
   int removed;
   int added = 0;
   int new_length = 0;
@@ -111,13 +157,34 @@ favorites_changed (GSettings              *settings,
   priv->items_inc_missing = g_settings_get_strv (settings, key);
   new_length = g_strv_length (priv->items_inc_missing);
 
+  old_favorites = priv->favorites;
+  priv->favorites = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  flipped = g_ptr_array_new_with_free_func (g_free);
+
+  for (int j = 0; j < new_length; j++) {
+    const char *item = priv->items_inc_missing[j];
+
+    // Skip duplicates
+    if (!g_hash_table_add (priv->favorites, g_strdup (item)))
+      continue;
+    if (old_favorites == NULL || !g_hash_table_remove (old_favorites, item))
+      g_ptr_array_add (flipped, g_strdup (item));
+  }
+  // What's left in the old set is no favorite anymore
+  if (old_favorites) {
+    g_hash_table_iter_init (&iter, old_favorites);
+    while (g_hash_table_iter_next (&iter, &id, NULL))
+      g_ptr_array_add (flipped, g_strdup (id));
+  }
+
   priv->items = g_new (char *, new_length + 1);
 
   while (priv->items_inc_missing[i]) {
-    g_autoptr (GDesktopAppInfo) info = NULL;
-    
+    g_autoptr (GAppInfo) info = NULL;
+
     // We don't actually care about this value, just that it isn't NULL
-    info = g_desktop_app_info_new (priv->items_inc_missing[i]);
+    info = phosh_app_list_model_lookup_app_id (phosh_app_list_model_get_default (),
+                                               priv->items_inc_missing[i]);
 
     if (G_LIKELY (info != NULL)) {
       priv->items[added] = g_strdup (priv->items_inc_missing[i]);
@@ -133,6 +200,15 @@ favorites_changed (GSettings              *settings,
   priv->len = added;
 
   g_list_model_items_changed (G_LIST_MODEL (self), 0, removed, added);
+
+  for (guint j = 0; j < flipped->len; j++) {
+    const char *app_id = g_ptr_array_index (flipped, j);
+
+    /* Connecting to a detail interns it so an unknown id has no detailed
+     * handlers, emit to the undetailed ones only */
+    g_signal_emit (self, signals[FAVORITE_CHANGED], g_quark_try_string (app_id),
+                   app_id, g_hash_table_contains (priv->favorites, app_id));
+  }
 }
 
 
@@ -192,11 +268,7 @@ phosh_favorite_list_model_app_is_favorite (PhoshFavoriteListModel *self,
     return FALSE;
   }
 
-  if (g_strv_contains ((const gchar* const*) priv->items_inc_missing, id)) {
-    return TRUE;
-  }
-
-  return FALSE;
+  return g_hash_table_contains (priv->favorites, id);
 }
 
 void
@@ -660,6 +660,26 @@ gtk_filter_list_model_has_filter (GtkFilterListModel *self)
  **/
 void
 gtk_filter_list_model_refilter (GtkFilterListModel *self)
+{
+  gtk_filter_list_model_refilter_with_hint (self, GTK_FILTER_CHANGE_DIFFERENT);
+}
+
+/**
+ * gtk_filter_list_model_refilter_with_hint:
+ * @self: a #GtkFilterListModel
+ * @change: How the filter changed
+ *
+ * Like gtk_filter_list_model_refilter() but uses @change to only
+ * run the filter function on items that can change visibility:
+ * For %GTK_FILTER_CHANGE_MORE_STRICT only visible items are
+ * checked, for %GTK_FILTER_CHANGE_LESS_STRICT only hidden ones.
+ *
+ * Items are fetched from the underlying model in order so models
+ * that cache their last position can avoid positional lookups.
+ **/
+void
+gtk_filter_list_model_refilter_with_hint (GtkFilterListModel *self,
+                                          GtkFilterChange     change)
 {
   FilterNode *node;
   guint i, first_change, last_change;
@@ -679,7 +699,22 @@ gtk_filter_list_model_refilter (GtkFilterListModel *self)
        node != NULL;
        i++, node = gtk_rb_tree_node_get_next (node))
     {
-      visible = gtk_filter_list_model_run_filter (self, i);
+      switch (change)
+        {
+        case GTK_FILTER_CHANGE_MORE_STRICT:
+          visible = node->visible ? gtk_filter_list_model_run_filter (self, i) : FALSE;
+          break;
+
+        case GTK_FILTER_CHANGE_LESS_STRICT:
+          visible = node->visible ? TRUE : gtk_filter_list_model_run_filter (self, i);
+          break;
+
+        case GTK_FILTER_CHANGE_DIFFERENT:
+        default:
+          visible = gtk_filter_list_model_run_filter (self, i);
+          break;
+        }
+
       if (visible == node->visible)
         {
           if (visible)
@@ -708,4 +743,3 @@ gtk_filter_list_model_refilter (GtkFilterListModel *self)
                                   last_change - first_change);
     }
 }
-
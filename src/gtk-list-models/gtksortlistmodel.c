@@ -22,6 +22,7 @@
 #include "gtksortlistmodel.h"
 
 #include <glib/gi18n-lib.h>
+#include <string.h>
 
 /**
  * SECTION:gtksortlistmodel
@@ -32,6 +33,12 @@
  * #GtkSortListModel is a list model that takes a list model and
  * sorts its elements according to a compare function.
  *
+ * Alternatively or additionally a key function can be set with
+ * gtk_sort_list_model_set_key_func(). The key is computed once per
+ * item, stored next to it and used to order items the sort function
+ * considers equal. This avoids recomputing expensive comparison data
+ * like collation keys on every comparison.
+ *
  * #GtkSortListModel is a generic model and because of that it
  * cannot take advantage of any external knowledge when sorting.
  * If you run into performance issues with #GtkSortListModel, it
@@ -47,6 +54,14 @@ enum {
   NUM_PROPERTIES
 };
 
+typedef struct _SortEntry SortEntry;
+
+struct _SortEntry
+{
+  gpointer item;
+  gchar *key; /* NULL if key_func == NULL */
+};
+
 struct _GtkSortListModel
 {
   GObject parent_instance;
@@ -56,9 +71,19 @@ struct _GtkSortListModel
   GCompareDataFunc sort_func;
   gpointer user_data;
   GDestroyNotify user_destroy;
-
-  GSequence *sorted; /* NULL if sort_func == NULL */
-  GSequence *unsorted; /* NULL if sort_func == NULL */
+  GtkSortListModelKeyFunc key_func;
+  gpointer key_user_data;
+  GDestroyNotify key_user_destroy;
+
+  GSequence *sorted; /* NULL if sort_func == NULL && key_func == NULL */
+  GSequence *unsorted; /* NULL if sort_func == NULL && key_func == NULL */
+
+  /* position cache so iterating over the items in order is cheap */
+  struct {
+    gboolean       is_valid;
+    guint          position;
+    GSequenceIter *iter;
+  } last;
 };
 
 struct _GtkSortListModelClass
@@ -68,6 +93,39 @@ struct _GtkSortListModelClass
 
 static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 
+static void
+sort_entry_free (gpointer data)
+{
+  SortEntry *entry = data;
+
+  g_object_unref (entry->item);
+  g_free (entry->key);
+  g_slice_free (SortEntry, entry);
+}
+
+static gint
+gtk_sort_list_model_compare (gconstpointer a,
+                             gconstpointer b,
+                             gpointer      data)
+{
+  GtkSortListModel *self = data;
+  const SortEntry *entry_a = a;
+  const SortEntry *entry_b = b;
+  gint result;
+
+  if (self->sort_func)
+    {
+      result = self->sort_func (entry_a->item, entry_b->item, self->user_data);
+      if (result != 0)
+        return result;
+    }
+
+  if (entry_a->key == NULL || entry_b->key == NULL)
+    return 0;
+
+  return strcmp (entry_a->key, entry_b->key);
+}
+
 static GType
 gtk_sort_list_model_get_item_type (GListModel *list)
 {
@@ -96,6 +154,7 @@ gtk_sort_list_model_get_item (GListModel *list,
 {
   GtkSortListModel *self = GTK_SORT_LIST_MODEL (list);
   GSequenceIter *iter;
+  SortEntry *entry;
 
   if (self->model == NULL)
     return NULL;
@@ -103,11 +162,32 @@ gtk_sort_list_model_get_item (GListModel *list,
   if (self->unsorted == NULL)
     return g_list_model_get_item (self->model, position);
 
-  iter = g_sequence_get_iter_at_pos (self->sorted, position);
+  iter = NULL;
+  if (self->last.is_valid)
+    {
+      if (position < G_MAXUINT && self->last.position == position + 1)
+        iter = g_sequence_iter_prev (self->last.iter);
+      else if (position > 0 && self->last.position == position - 1)
+        iter = g_sequence_iter_next (self->last.iter);
+      else if (self->last.position == position)
+        iter = self->last.iter;
+    }
+
+  if (iter == NULL)
+    iter = g_sequence_get_iter_at_pos (self->sorted, position);
+
   if (g_sequence_iter_is_end (iter))
+    {
+      self->last.is_valid = FALSE;
       return NULL;
+    }
+
+  self->last.iter = iter;
+  self->last.position = position;
+  self->last.is_valid = TRUE;
 
-  return g_object_ref (g_sequence_get (iter));
+  entry = g_sequence_get (iter);
+  return g_object_ref (entry->item);
 }
 
 static void
@@ -121,6 +201,14 @@ gtk_sort_list_model_model_init (GListModelInterface *iface)
 G_DEFINE_TYPE_WITH_CODE (GtkSortListModel, gtk_sort_list_model, G_TYPE_OBJECT,
                          G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, gtk_sort_list_model_model_init))
 
+static void
+gtk_sort_list_model_invalidate_cache (GtkSortListModel *self)
+{
+  self->last.is_valid = FALSE;
+  self->last.iter = NULL;
+  self->last.position = 0;
+}
+
 static void
 gtk_sort_list_model_remove_items (GtkSortListModel *self,
                                   guint             position,
@@ -171,8 +259,11 @@ gtk_sort_list_model_add_items (GtkSortListModel *self,
 
   for (i = 0; i < n_items; i++)
     {
-      gpointer item = g_list_model_get_item (self->model, position + i);
-      sorted_iter = g_sequence_insert_sorted (self->sorted, item, self->sort_func, self->user_data);
+      SortEntry *entry = g_slice_new (SortEntry);
+
+      entry->item = g_list_model_get_item (self->model, position + i);
+      entry->key = self->key_func ? self->key_func (entry->item, self->key_user_data) : NULL;
+      sorted_iter = g_sequence_insert_sorted (self->sorted, entry, gtk_sort_list_model_compare, self);
       g_sequence_insert_before (unsorted_iter, sorted_iter);
       if (unmodified_start != NULL || unmodified_end != NULL)
         {
@@ -206,6 +297,7 @@ gtk_sort_list_model_items_changed_cb (GListModel       *model,
       return;
     }
 
+  gtk_sort_list_model_invalidate_cache (self);
   gtk_sort_list_model_remove_items (self, position, removed, &start, &end);
   gtk_sort_list_model_add_items (self, position, added, &start2, &end2);
   start = MIN (start, start2);
@@ -250,7 +342,7 @@ gtk_sort_list_model_get_property (GObject     *object,
   switch (prop_id)
     {
     case PROP_HAS_SORT:
-      g_value_set_boolean (value, self->sort_func != NULL);
+      g_value_set_boolean (value, self->sort_func != NULL || self->key_func != NULL);
       break;
 
     case PROP_ITEM_TYPE:
@@ -277,6 +369,7 @@ gtk_sort_list_model_clear_model (GtkSortListModel *self)
   g_clear_object (&self->model);
   g_clear_pointer (&self->sorted, g_sequence_free);
   g_clear_pointer (&self->unsorted, g_sequence_free);
+  gtk_sort_list_model_invalidate_cache (self);
 }
 
 static void
@@ -290,6 +383,11 @@ gtk_sort_list_model_dispose (GObject *object)
   self->sort_func = NULL;
   self->user_data = NULL;
   self->user_destroy = NULL;
+  if (self->key_user_destroy)
+    self->key_user_destroy (self->key_user_data);
+  self->key_func = NULL;
+  self->key_user_data = NULL;
+  self->key_user_destroy = NULL;
 
   G_OBJECT_CLASS (gtk_sort_list_model_parent_class)->dispose (object);
 };
@@ -403,10 +501,10 @@ gtk_sort_list_model_new_for_type (GType item_type)
 static void
 gtk_sort_list_model_create_sequences (GtkSortListModel *self)
 {
-  if (!self->sort_func || self->model == NULL)
+  if ((!self->sort_func && !self->key_func) || self->model == NULL)
     return;
 
-  self->sorted = g_sequence_new (g_object_unref);
+  self->sorted = g_sequence_new (sort_entry_free);
   self->unsorted = g_sequence_new (NULL);
 
   gtk_sort_list_model_add_items (self, 0, g_list_model_get_n_items (self->model), NULL, NULL);
@@ -443,6 +541,7 @@ gtk_sort_list_model_set_sort_func (GtkSortListModel *self,
 
   g_clear_pointer (&self->unsorted, g_sequence_free);
   g_clear_pointer (&self->sorted, g_sequence_free);
+  gtk_sort_list_model_invalidate_cache (self);
   self->sort_func = sort_func;
   self->user_data = user_data;
   self->user_destroy = user_destroy;
@@ -456,6 +555,53 @@ gtk_sort_list_model_set_sort_func (GtkSortListModel *self,
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_HAS_SORT]);
 }
 
+/**
+ * gtk_sort_list_model_set_key_func:
+ * @self: a #GtkSortListModel
+ * @key_func: (allow-none): key function or %NULL to not use keys
+ * @user_data: user data passed to @key_func
+ * @user_destroy: destroy notifier for @user_data
+ *
+ * Sets the function used to compute the sort key of an item. The
+ * function is called once for every item when it's added to the
+ * model and must return a newly allocated, %NUL terminated string
+ * like the one returned by g_utf8_collate_key(). Keys are compared
+ * with strcmp() and used to order items the sort function (if any)
+ * considers equal.
+ **/
+void
+gtk_sort_list_model_set_key_func (GtkSortListModel        *self,
+                                  GtkSortListModelKeyFunc  key_func,
+                                  gpointer                 user_data,
+                                  GDestroyNotify           user_destroy)
+{
+  guint n_items;
+
+  g_return_if_fail (GTK_IS_SORT_LIST_MODEL (self));
+  g_return_if_fail (key_func != NULL || (user_data == NULL && !user_destroy));
+
+  if (!key_func && !self->key_func)
+    return;
+
+  if (self->key_user_destroy)
+    self->key_user_destroy (self->key_user_data);
+
+  g_clear_pointer (&self->unsorted, g_sequence_free);
+  g_clear_pointer (&self->sorted, g_sequence_free);
+  gtk_sort_list_model_invalidate_cache (self);
+  self->key_func = key_func;
+  self->key_user_data = user_data;
+  self->key_user_destroy = user_destroy;
+
+  gtk_sort_list_model_create_sequences (self);
+
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (self));
+  if (n_items > 1)
+    g_list_model_items_changed (G_LIST_MODEL (self), 0, n_items, n_items);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_HAS_SORT]);
+}
+
 /**
  * gtk_sort_list_model_set_model:
  * @self: a #GtkSortListModel
@@ -529,7 +675,7 @@ gtk_sort_list_model_has_sort (GtkSortListModel *self)
 {
   g_return_val_if_fail (GTK_IS_SORT_LIST_MODEL (self), FALSE);
 
-  return self->sort_func != NULL;
+  return self->sort_func != NULL || self->key_func != NULL;
 }
 
 /**
@@ -540,11 +686,16 @@ gtk_sort_list_model_has_sort (GtkSortListModel *self)
  *
  * Calling this function is necessary when data used by the sort
  * function has changed.
+ *
+ * Only the range of items that actually moved is reported via
+ * #GListModel::items-changed.
  **/
 void
 gtk_sort_list_model_resort (GtkSortListModel *self)
 {
-  guint n_items;
+  GSequenceIter *iter;
+  gpointer *before;
+  guint i, n_items, first, last;
 
   g_return_if_fail (GTK_IS_SORT_LIST_MODEL (self));
   
@@ -555,8 +706,29 @@ gtk_sort_list_model_resort (GtkSortListModel *self)
   if (n_items <= 1)
     return;
 
-  g_sequence_sort (self->sorted, self->sort_func, self->user_data);
+  before = g_new (gpointer, n_items);
+  for (i = 0, iter = g_sequence_get_begin_iter (self->sorted);
+       !g_sequence_iter_is_end (iter);
+       i++, iter = g_sequence_iter_next (iter))
+    before[i] = g_sequence_get (iter);
 
-  g_list_model_items_changed (G_LIST_MODEL (self), 0, n_items, n_items);
-}
+  g_sequence_sort (self->sorted, gtk_sort_list_model_compare, self);
+  gtk_sort_list_model_invalidate_cache (self);
+
+  first = G_MAXUINT;
+  last = 0;
+  for (i = 0, iter = g_sequence_get_begin_iter (self->sorted);
+       !g_sequence_iter_is_end (iter);
+       i++, iter = g_sequence_iter_next (iter))
+    {
+      if (before[i] == g_sequence_get (iter))
+        continue;
+
+      first = MIN (first, i);
+      last = i;
+    }
+  g_free (before);
 
+  if (first <= last)
+    g_list_model_items_changed (G_LIST_MODEL (self), first, last - first + 1, last - first + 1);
+}
@@ -32,6 +32,17 @@ G_BEGIN_DECLS
 GDK_AVAILABLE_IN_ALL
 G_DECLARE_FINAL_TYPE (GtkSortListModel, gtk_sort_list_model, GTK, SORT_LIST_MODEL, GObject)
 
+/**
+ * GtkSortListModelKeyFunc:
+ * @item: (type GObject): The item to compute the key for
+ * @user_data: user data
+ *
+ * User function that computes the sort key of @item.
+ *
+ * Returns: (transfer full): A newly allocated %NUL terminated key
+ */
+typedef gchar * (* GtkSortListModelKeyFunc) (gpointer item, gpointer user_data);
+
 GDK_AVAILABLE_IN_ALL
 GtkSortListModel *      gtk_sort_list_model_new                 (GListModel             *model,
                                                                  GCompareDataFunc        sort_func,
@@ -46,6 +57,11 @@ void                    gtk_sort_list_model_set_sort_func       (GtkSortListMode
                                                                  gpointer                user_data,
                                                                  GDestroyNotify          user_destroy);
 GDK_AVAILABLE_IN_ALL
+void                    gtk_sort_list_model_set_key_func        (GtkSortListModel       *self,
+                                                                 GtkSortListModelKeyFunc key_func,
+                                                                 gpointer                user_data,
+                                                                 GDestroyNotify          user_destroy);
+GDK_AVAILABLE_IN_ALL
 gboolean                gtk_sort_list_model_has_sort            (GtkSortListModel       *self);
 GDK_AVAILABLE_IN_ALL
 void                    gtk_sort_list_model_set_model           (GtkSortListModel       *self,
@@ -349,6 +349,8 @@ phosh_home_set_state (PhoshHome *self, PhoshHomeState state)
     gtk_widget_show (self->btn_osk);
     kbd_interactivity = FALSE;
   }
+  phosh_overview_set_live_thumbnails (PHOSH_OVERVIEW (self->overview),
+                                      state == PHOSH_HOME_STATE_UNFOLDED);
   phosh_layer_surface_set_kbd_interactivity (PHOSH_LAYER_SURFACE (self), kbd_interactivity);
 
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_HOME_STATE]);
@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#define G_LOG_DOMAIN "phosh-icon-cache"
+
+#include "icon-cache.h"
+
+/* Enough for a couple of hundred avatars and app icons */
+#define ICON_CACHE_DEFAULT_MAX_BYTES (4 * 1024 * 1024)
+/* How long a file based icon is served without looking at the file again */
+#define ICON_CACHE_REVALIDATE_US (10 * G_USEC_PER_SEC)
+
+/**
+ * SECTION:phosh-icon-cache
+ * @short_description: A size limited cache for rendered icons
+ * @Title: PhoshIconCache
+ *
+ * Keeps rendered icons around so widgets showing the same #GIcon over
+ * and over (like notification app icons or avatars sent as image
+ * path) don't need to look up the icon theme or decode the file each
+ * time. Entries are keyed by the icon, its size and scale. File based
+ * icons are reloaded when the file's modification time changes. To
+ * keep lookups from hitting the disk the file is only looked at when
+ * the entry is inserted or once it's older than a couple of seconds. All
+ * entries are dropped when the icon theme changes. Least recently used
+ * entries are dropped once the cache exceeds its size limit.
+ *
+ * Icons that can't be serialized (like #GdkPixbuf) are rendered but
+ * not cached.
+ */
+
+typedef struct _CacheEntry {
+  gchar           *key;
+  cairo_surface_t *surface;
+  guint64          mtime;
+  gint64           validated;
+  gsize            size;
+  GList            link;
+} CacheEntry;
+
+struct _PhoshIconCache {
+  GObject     parent;
+
+  GHashTable *entries;  /* key → CacheEntry */
+  GQueue      lru;      /* most recently used first */
+  gsize       size;
+  gsize       max_bytes;
+
+  guint       hits;
+  guint       misses;
+};
+
+G_DEFINE_TYPE (PhoshIconCache, phosh_icon_cache, G_TYPE_OBJECT);
+
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+  g_free (entry->key);
+  cairo_surface_destroy (entry->surface);
+  g_free (entry);
+}
+
+
+static gsize
+surface_size (cairo_surface_t *surface)
+{
+  if (cairo_surface_get_type (surface) != CAIRO_SURFACE_TYPE_IMAGE)
+    return 0;
+
+  return (gsize) cairo_image_surface_get_stride (surface) *
+    cairo_image_surface_get_height (surface);
+}
+
+
+/* Modification time of file based icons, 0 otherwise */
+static guint64
+get_mtime (GIcon *icon)
+{
+  g_autoptr (GFileInfo) info = NULL;
+  GFile *file;
+
+  if (!G_IS_FILE_ICON (icon))
+    return 0;
+
+  file = g_file_icon_get_file (G_FILE_ICON (icon));
+  info = g_file_query_info (file, G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (info == NULL)
+    return 0;
+
+  return g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+    g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
+
+
+static void
+remove_entry (PhoshIconCache *self, CacheEntry *entry)
+{
+  g_queue_unlink (&self->lru, &entry->link);
+  self->size -= entry->size;
+  g_hash_table_remove (self->entries, entry->key);
+}
+
+
+static void
+evict (PhoshIconCache *self)
+{
+  while (self->size > self->max_bytes && self->lru.tail) {
+    CacheEntry *entry = self->lru.tail->data;
+
+    g_debug ("Evicting %s (%" G_GSIZE_FORMAT " bytes)", entry->key, entry->size);
+    remove_entry (self, entry);
+  }
+}
+
+
+static cairo_surface_t *
+render_icon (GIcon *icon, int size, int scale)
+{
+  g_autoptr (GtkIconInfo) info = NULL;
+  g_autoptr (GError) err = NULL;
+  cairo_surface_t *surface;
+
+  info = gtk_icon_theme_lookup_by_gicon_for_scale (gtk_icon_theme_get_default (),
+                                                   icon, size, scale,
+                                                   GTK_ICON_LOOKUP_FORCE_SIZE);
+  if (info == NULL)
+    return NULL;
+
+  surface = gtk_icon_info_load_surface (info, NULL, &err);
+  if (surface == NULL)
+    g_debug ("Failed to load icon: %s", err->message);
+
+  return surface;
+}
+
+
+static void
+on_icon_theme_changed (PhoshIconCache *self, GtkIconTheme *theme)
+{
+  g_debug ("Icon theme changed, dropping cache");
+  phosh_icon_cache_clear (self);
+}
+
+
+static void
+phosh_icon_cache_finalize (GObject *object)
+{
+  PhoshIconCache *self = PHOSH_ICON_CACHE (object);
+
+  g_hash_table_destroy (self->entries);
+
+  G_OBJECT_CLASS (phosh_icon_cache_parent_class)->finalize (object);
+}
+
+
+static void
+phosh_icon_cache_class_init (PhoshIconCacheClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = phosh_icon_cache_finalize;
+}
+
+
+static void
+phosh_icon_cache_init (PhoshIconCache *self)
+{
+  g_queue_init (&self->lru);
+  self->entries = g_hash_table_new_full (g_str_hash,
+                                         g_str_equal,
+                                         NULL,
+                                         (GDestroyNotify) cache_entry_free);
+
+  g_signal_connect_object (gtk_icon_theme_get_default (), "changed",
+                           G_CALLBACK (on_icon_theme_changed),
+                           self,
+                           G_CONNECT_SWAPPED);
+}
+
+
+/**
+ * phosh_icon_cache_new:
+ * @max_bytes: The maximum amount of pixel data to keep around
+ *
+ * Returns: A new #PhoshIconCache
+ */
+PhoshIconCache *
+phosh_icon_cache_new (gsize max_bytes)
+{
+  PhoshIconCache *self = g_object_new (PHOSH_TYPE_ICON_CACHE, NULL);
+
+  self->max_bytes = max_bytes;
+  return self;
+}
+
+
+/**
+ * phosh_icon_cache_get_default:
+ *
+ * Returns: (transfer none): The shared #PhoshIconCache
+ */
+PhoshIconCache *
+phosh_icon_cache_get_default (void)
+{
+  static PhoshIconCache *instance;
+
+  if (instance == NULL) {
+    instance = phosh_icon_cache_new (ICON_CACHE_DEFAULT_MAX_BYTES);
+    g_object_add_weak_pointer (G_OBJECT (instance), (gpointer *)&instance);
+  }
+
+  return instance;
+}
+
+
+/**
+ * phosh_icon_cache_lookup:
+ * @self: The #PhoshIconCache
+ * @icon: The icon to render
+ * @size: The icon size in application pixels
+ * @scale: The scale factor of the widget showing the icon
+ *
+ * Gets @icon rendered at @size and @scale. The icon is only rendered
+ * if it isn't cached yet or its file changed since the entry was
+ * last validated.
+ *
+ * Returns: (transfer full) (nullable): The rendered icon
+ */
+cairo_surface_t *
+phosh_icon_cache_lookup (PhoshIconCache *self, GIcon *icon, int size, int scale)
+{
+  g_autofree gchar *icon_str = NULL;
+  g_autofree gchar *key = NULL;
+  cairo_surface_t *surface;
+  CacheEntry *entry;
+  guint64 mtime = 0;
+  gint64 now;
+
+  g_return_val_if_fail (PHOSH_IS_ICON_CACHE (self), NULL);
+  g_return_val_if_fail (G_IS_ICON (icon), NULL);
+
+  /* Image data is unique per notification, no point in caching it */
+  if (GDK_IS_PIXBUF (icon))
+    return render_icon (icon, size, scale);
+
+  icon_str = g_icon_to_string (icon);
+  if (icon_str == NULL)
+    return render_icon (icon, size, scale);
+
+  key = g_strdup_printf ("%s:%d@%d", icon_str, size, scale);
+  now = g_get_monotonic_time ();
+
+  entry = g_hash_table_lookup (self->entries, key);
+  if (entry && now - entry->validated >= ICON_CACHE_REVALIDATE_US) {
+    mtime = get_mtime (icon);
+    if (entry->mtime == mtime)
+      entry->validated = now;
+  }
+
+  if (entry && now - entry->validated < ICON_CACHE_REVALIDATE_US) {
+    self->hits++;
+    g_queue_unlink (&self->lru, &entry->link);
+    g_queue_push_head_link (&self->lru, &entry->link);
+    return cairo_surface_reference (entry->surface);
+  }
+
+  self->misses++;
+  if (entry) {
+    g_debug ("%s changed, reloading", entry->key);
+    remove_entry (self, entry);
+  } else {
+    mtime = get_mtime (icon);
+  }
+
+  surface = render_icon (icon, size, scale);
+  if (surface == NULL)
+    return NULL;
+
+  entry = g_new0 (CacheEntry, 1);
+  entry->key = g_steal_pointer (&key);
+  entry->surface = cairo_surface_reference (surface);
+  entry->mtime = mtime;
+  entry->validated = now;
+  entry->size = surface_size (surface);
+  entry->link.data = entry;
+
+  if (entry->size > self->max_bytes) {
+    g_debug ("Not caching %s, %" G_GSIZE_FORMAT " bytes exceeds limit", entry->key, entry->size);
+    cache_entry_free (entry);
+    return surface;
+  }
+
+  g_hash_table_insert (self->entries, entry->key, entry);
+  g_queue_push_head_link (&self->lru, &entry->link);
+  self->size += entry->size;
+  evict (self);
+
+  return surface;
+}
+
+
+/**
+ * phosh_icon_cache_clear:
+ * @self: The #PhoshIconCache
+ *
+ * Drops all cached icons.
+ */
+void
+phosh_icon_cache_clear (PhoshIconCache *self)
+{
+  g_return_if_fail (PHOSH_IS_ICON_CACHE (self));
+
+  g_queue_init (&self->lru);
+  g_hash_table_remove_all (self->entries);
+  self->size = 0;
+}
+
+
+/**
+ * phosh_icon_cache_get_size:
+ * @self: The #PhoshIconCache
+ *
+ * Returns: The amount of pixel data currently cached in bytes
+ */
+gsize
+phosh_icon_cache_get_size (PhoshIconCache *self)
+{
+  g_return_val_if_fail (PHOSH_IS_ICON_CACHE (self), 0);
+
+  return self->size;
+}
+
+
+/**
+ * phosh_icon_cache_get_hits:
+ * @self: The #PhoshIconCache
+ *
+ * Returns: How often a lookup was served from the cache
+ */
+guint
+phosh_icon_cache_get_hits (PhoshIconCache *self)
+{
+  g_return_val_if_fail (PHOSH_IS_ICON_CACHE (self), 0);
+
+  return self->hits;
+}
+
+
+/**
+ * phosh_icon_cache_get_misses:
+ * @self: The #PhoshIconCache
+ *
+ * Returns: How often a lookup had to render the icon
+ */
+guint
+phosh_icon_cache_get_misses (PhoshIconCache *self)
+{
+  g_return_val_if_fail (PHOSH_IS_ICON_CACHE (self), 0);
+
+  return self->misses;
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define PHOSH_TYPE_ICON_CACHE (phosh_icon_cache_get_type())
+
+G_DECLARE_FINAL_TYPE (PhoshIconCache,
+                      phosh_icon_cache,
+                      PHOSH,
+                      ICON_CACHE,
+                      GObject)
+
+PhoshIconCache  *phosh_icon_cache_new         (gsize           max_bytes);
+PhoshIconCache  *phosh_icon_cache_get_default (void);
+cairo_surface_t *phosh_icon_cache_lookup      (PhoshIconCache *self,
+                                               GIcon          *icon,
+                                               int             size,
+                                               int             scale);
+void             phosh_icon_cache_clear       (PhoshIconCache *self);
+gsize            phosh_icon_cache_get_size    (PhoshIconCache *self);
+guint            phosh_icon_cache_get_hits    (PhoshIconCache *self);
+guint            phosh_icon_cache_get_misses  (PhoshIconCache *self);
+
+G_END_DECLS
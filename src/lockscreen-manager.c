@@ -33,6 +33,7 @@ enum {
   PHOSH_LOCKSCREEN_MANAGER_PROP_0,
   PHOSH_LOCKSCREEN_MANAGER_PROP_LOCKED,
   PHOSH_LOCKSCREEN_MANAGER_PROP_TIMEOUT,
+  PHOSH_LOCKSCREEN_MANAGER_PROP_LOCK_LATENCY,
   PHOSH_LOCKSCREEN_MANAGER_PROP_LAST_PROP
 };
 static GParamSpec *props[PHOSH_LOCKSCREEN_MANAGER_PROP_LAST_PROP];
@@ -40,14 +41,20 @@ static GParamSpec *props[PHOSH_LOCKSCREEN_MANAGER_PROP_LAST_PROP];
 
 typedef struct {
   PhoshLockscreen *lockscreen;     /* phone display lock screen */
+  PhoshMonitor *lockscreen_monitor; /* monitor the lock screen was built for */
   PhoshSessionPresence *presence;  /* gnome-session's presence interface */
-  GPtrArray *shields;              /* other outputs */
+  GHashTable *shields;             /* other outputs: PhoshMonitor → PhoshLockshield */
   GSettings *settings;
+  guint prepare_id;
+  PhoshMonitorManager *monitor_manager;
 
   gint timeout;                    /* timeout in seconds before screen locks */
   gboolean locked;
   gint64 active_time;              /* when lock was activated (in us) */
   gint rotation;                   /* the shell rotation before locking */
+
+  gint64 lock_latency;             /* lock request to first frame (in us) */
+  gulong first_frame_id;
 } PhoshLockscreenManagerPrivate;
 
 
@@ -59,12 +66,23 @@ typedef struct _PhoshLockscreenManager {
 G_DEFINE_TYPE_WITH_PRIVATE (PhoshLockscreenManager, phosh_lockscreen_manager, G_TYPE_OBJECT)
 
 
+static void prepare_surfaces (PhoshLockscreenManager *self);
+static void on_monitors_changed (PhoshLockscreenManager *self,
+                                 GPtrArray              *added,
+                                 GPtrArray              *removed,
+                                 PhoshMonitorManager    *monitormanager);
+static void on_primary_monitor_changed (PhoshLockscreenManager *self,
+                                        GParamSpec             *pspec,
+                                        PhoshShell             *shell);
+
+
 static void
 lockscreen_unlock_cb (PhoshLockscreenManager *self, PhoshLockscreen *lockscreen)
 {
   PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
   PhoshShell *shell = phosh_shell_get_default ();
-  PhoshMonitorManager *monitor_manager = phosh_shell_get_monitor_manager (shell);
+  GHashTableIter iter;
+  GtkWidget *shield;
 
   phosh_shell_rotate_display (shell, priv->rotation);
   priv->rotation = 0;
@@ -72,16 +90,26 @@ lockscreen_unlock_cb (PhoshLockscreenManager *self, PhoshLockscreen *lockscreen)
   g_return_if_fail (PHOSH_IS_LOCKSCREEN (lockscreen));
   g_return_if_fail (lockscreen == PHOSH_LOCKSCREEN (priv->lockscreen));
 
-  g_signal_handlers_disconnect_by_data (lockscreen, self);
-  g_signal_handlers_disconnect_by_data (monitor_manager, self);
-  g_clear_pointer (&priv->lockscreen, phosh_cp_widget_destroy);
+  if (priv->first_frame_id) {
+    g_signal_handler_disconnect (lockscreen, priv->first_frame_id);
+    priv->first_frame_id = 0;
+  }
+
+  /* Keep the surfaces around for the next lock */
+  gtk_widget_hide (GTK_WIDGET (lockscreen));
+  phosh_lockscreen_reset (lockscreen);
 
   /* Unlock all other outputs */
-  g_clear_pointer (&priv->shields, g_ptr_array_unref);
+  g_hash_table_iter_init (&iter, priv->shields);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &shield))
+    gtk_widget_hide (shield);
 
   priv->locked = FALSE;
   priv->active_time = 0;
   g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_LOCKSCREEN_MANAGER_PROP_LOCKED]);
+
+  /* Pick up monitor changes that happened while locked */
+  prepare_surfaces (self);
 }
 
 
@@ -96,105 +124,365 @@ lockscreen_wakeup_output_cb (PhoshLockscreenManager *self, PhoshLockscreen *lock
 }
 
 
-/* Lock a particular monitor bringing up a shield */
 static void
-lock_monitor (PhoshLockscreenManager *self,
-              PhoshMonitor           *monitor)
+on_lockscreen_destroyed (PhoshLockscreenManager *self, PhoshLockscreen *lockscreen)
+{
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+
+  g_return_if_fail (lockscreen == priv->lockscreen);
+
+  /* The compositor closed the surface */
+  priv->lockscreen = NULL;
+  priv->lockscreen_monitor = NULL;
+  priv->first_frame_id = 0;
+}
+
+
+static void
+on_shield_destroyed (PhoshLockscreenManager *self, GtkWidget *shield)
+{
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+  GHashTableIter iter;
+  GtkWidget *value;
+
+  g_hash_table_iter_init (&iter, priv->shields);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &value)) {
+    if (value == shield) {
+      g_hash_table_iter_steal (&iter);
+      break;
+    }
+  }
+}
+
+
+static void
+destroy_shield (GtkWidget *shield)
+{
+  g_signal_handlers_disconnect_matched (shield, G_SIGNAL_MATCH_FUNC, 0, 0, NULL,
+                                        on_shield_destroyed, NULL);
+  gtk_widget_destroy (shield);
+}
+
+
+static void
+destroy_lockscreen (PhoshLockscreenManager *self)
+{
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+
+  if (priv->lockscreen == NULL)
+    return;
+
+  g_signal_handlers_disconnect_by_data (priv->lockscreen, self);
+  priv->first_frame_id = 0;
+  g_clear_pointer (&priv->lockscreen, phosh_cp_widget_destroy);
+  priv->lockscreen_monitor = NULL;
+}
+
+
+/* Build a shield for a particular monitor, it's not shown yet */
+static GtkWidget *
+prepare_shield (PhoshLockscreenManager *self,
+                PhoshMonitor           *monitor)
 {
   PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
   PhoshWayland *wl = phosh_wayland_get_default ();
   GtkWidget *shield;
 
+  shield = g_hash_table_lookup (priv->shields, monitor);
+  if (shield)
+    return shield;
+
+  g_debug ("Preparing lock shield for %s", monitor->name);
   shield = phosh_lockshield_new (
     phosh_wayland_get_zwlr_layer_shell_v1 (wl),
     monitor->wl_output);
+  g_signal_connect_object (shield, "destroy",
+                           G_CALLBACK (on_shield_destroyed),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_hash_table_insert (priv->shields, monitor, shield);
 
-  g_ptr_array_add (priv->shields, shield);
-  gtk_widget_show (shield);
+  return shield;
 }
 
 
+/* Build the lock screen for a particular monitor, it's not shown yet */
 static void
-on_monitor_removed (PhoshLockscreenManager *self,
-                    PhoshMonitor           *monitor,
-                    PhoshMonitorManager    *monitormanager)
+create_lockscreen (PhoshLockscreenManager *self,
+                   PhoshMonitor           *monitor)
 {
-  g_return_if_fail (PHOSH_IS_MONITOR (monitor));
-  g_return_if_fail (PHOSH_IS_LOCKSCREEN_MANAGER (self));
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+  PhoshWayland *wl = phosh_wayland_get_default ();
+
+  g_debug ("Preparing lockscreen for %s", monitor->name);
+  /* The lock screen's output gets the clock, keypad, ... */
+  priv->lockscreen = PHOSH_LOCKSCREEN (phosh_lockscreen_new (
+                                         phosh_wayland_get_zwlr_layer_shell_v1(wl),
+                                         monitor->wl_output));
+  priv->lockscreen_monitor = monitor;
 
-  g_debug ("Monitor removed");
-  /* TODO: We just leave the widget dangling, it will be destroyed on
-   * unlock */
+  g_object_connect (
+    priv->lockscreen,
+    "swapped-object-signal::lockscreen-unlock", G_CALLBACK(lockscreen_unlock_cb), self,
+    "swapped-object-signal::wakeup-output", G_CALLBACK(lockscreen_wakeup_output_cb), self,
+    "swapped-object-signal::destroy", G_CALLBACK(on_lockscreen_destroyed), self,
+    NULL);
 }
 
 
 static void
-on_monitor_added (PhoshLockscreenManager *self,
-                  PhoshMonitor           *monitor,
-                  PhoshMonitorManager    *monitormanager)
+show_lockscreen (PhoshLockscreenManager *self)
 {
-  g_return_if_fail (PHOSH_IS_MONITOR (monitor));
-  g_return_if_fail (PHOSH_IS_LOCKSCREEN_MANAGER (self));
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
 
-  g_warning ("Monitor added");
-  lock_monitor (self, monitor);
+  phosh_lockscreen_reset (priv->lockscreen);
+  gtk_widget_show (GTK_WIDGET (priv->lockscreen));
 }
 
 
+/*
+ * The lock screen's monitor went away while locked. Move the lock
+ * screen to the primary monitor or any other remaining one. If there's
+ * none it's put on the next monitor that shows up.
+ */
 static void
-lockscreen_lock (PhoshLockscreenManager *self)
+move_lockscreen (PhoshLockscreenManager *self,
+                 GPtrArray              *removed)
 {
   PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
-  PhoshMonitor *primary_monitor;
-  PhoshWayland *wl = phosh_wayland_get_default ();
-  PhoshShell *shell = phosh_shell_get_default ();
-  PhoshMonitorManager *monitor_manager = phosh_shell_get_monitor_manager (shell);
+  PhoshMonitor *monitor = phosh_shell_get_primary_monitor (phosh_shell_get_default ());
 
-  g_return_if_fail (!priv->locked);
+  destroy_lockscreen (self);
 
-  primary_monitor = phosh_shell_get_primary_monitor (shell);
-  g_return_if_fail (primary_monitor);
+  for (int i = 0; monitor == NULL || g_ptr_array_find (removed, monitor, NULL); i++) {
+    if (i >= phosh_monitor_manager_get_num_monitors (priv->monitor_manager)) {
+      g_debug ("No monitor left for the lock screen");
+      return;
+    }
+    monitor = phosh_monitor_manager_get_monitor (priv->monitor_manager, i);
+  }
+
+  /* The lock screen takes the place of the monitor's shield */
+  g_hash_table_remove (priv->shields, monitor);
+  create_lockscreen (self, monitor);
+  show_lockscreen (self);
+}
 
-  /* Undo any rotation so the keypad becomes usable */
-  priv->rotation = phosh_shell_get_rotation (shell);
-  phosh_shell_rotate_display (shell, 0);
 
-  /* Listen for monitor changes */
-  g_signal_connect_object (monitor_manager, "monitor-added",
-                           G_CALLBACK (on_monitor_added),
+/* Listen for monitor changes */
+static void
+connect_monitor_signals (PhoshLockscreenManager *self)
+{
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+  PhoshShell *shell = phosh_shell_get_default ();
+
+  priv->monitor_manager = phosh_shell_get_monitor_manager (shell);
+
+  g_signal_connect_object (priv->monitor_manager, "monitors-changed",
+                           G_CALLBACK (on_monitors_changed),
                            self,
                            G_CONNECT_SWAPPED);
 
-  g_signal_connect_object (monitor_manager, "monitor-removed",
-                           G_CALLBACK (on_monitor_removed),
+  g_signal_connect_object (shell, "notify::primary-monitor",
+                           G_CALLBACK (on_primary_monitor_changed),
                            self,
                            G_CONNECT_SWAPPED);
+}
 
-  /* The primary output gets the clock, keypad, ... */
-  priv->lockscreen = PHOSH_LOCKSCREEN (phosh_lockscreen_new (
-                                         phosh_wayland_get_zwlr_layer_shell_v1(wl),
-                                         primary_monitor->wl_output));
-  gtk_widget_show (GTK_WIDGET (priv->lockscreen));
 
-  /* Lock all other outputs */
-  priv->shields = g_ptr_array_new_with_free_func ((GDestroyNotify) (gtk_widget_destroy));
+/*
+ * Build the lock screen for the primary monitor and shields for all
+ * other monitors ahead of time so locking only needs to map them.
+ */
+static void
+prepare_surfaces (PhoshLockscreenManager *self)
+{
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+  PhoshShell *shell = phosh_shell_get_default ();
+  PhoshMonitorManager *monitor_manager;
+  PhoshMonitor *primary_monitor;
+  GHashTableIter iter;
+  PhoshMonitor *monitor;
+
+  /* Don't rebuild surfaces that are in use */
+  if (priv->locked)
+    return;
+
+  if (priv->monitor_manager == NULL)
+    connect_monitor_signals (self);
+
+  monitor_manager = priv->monitor_manager;
+  primary_monitor = phosh_shell_get_primary_monitor (shell);
+
+  /* No monitors (yet), we're called again once there are */
+  if (primary_monitor == NULL)
+    return;
+
+  if (priv->lockscreen && priv->lockscreen_monitor != primary_monitor)
+    destroy_lockscreen (self);
+
+  if (priv->lockscreen == NULL)
+    create_lockscreen (self, primary_monitor);
 
+  /* Drop shields of gone monitors and the primary one */
+  g_hash_table_iter_init (&iter, priv->shields);
+  while (g_hash_table_iter_next (&iter, (gpointer) &monitor, NULL)) {
+    gboolean found = FALSE;
+
+    for (int i = 0; i < phosh_monitor_manager_get_num_monitors (monitor_manager); i++) {
+      if (monitor == phosh_monitor_manager_get_monitor (monitor_manager, i)) {
+        found = TRUE;
+        break;
+      }
+    }
+
+    if (!found || monitor == primary_monitor)
+      g_hash_table_iter_remove (&iter);
+  }
+
+  /* All other outputs get a shield */
   for (int i = 0; i < phosh_monitor_manager_get_num_monitors (monitor_manager); i++) {
-    PhoshMonitor *monitor = phosh_monitor_manager_get_monitor (monitor_manager, i);
+    monitor = phosh_monitor_manager_get_monitor (monitor_manager, i);
 
     if (monitor == NULL || monitor == primary_monitor)
       continue;
-    lock_monitor (self, monitor);
+    prepare_shield (self, monitor);
   }
+}
 
-  g_object_connect (
-    priv->lockscreen,
-    "swapped-object-signal::lockscreen-unlock", G_CALLBACK(lockscreen_unlock_cb), self,
-    "swapped-object-signal::wakeup-output", G_CALLBACK(lockscreen_wakeup_output_cb), self,
-    NULL);
 
-  priv->locked = TRUE;
+static gboolean
+prepare_surfaces_idle_cb (PhoshLockscreenManager *self)
+{
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+
+  priv->prepare_id = 0;
+  prepare_surfaces (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+static void
+queue_prepare_surfaces (PhoshLockscreenManager *self)
+{
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+
+  if (priv->prepare_id)
+    return;
+
+  priv->prepare_id = g_idle_add ((GSourceFunc) prepare_surfaces_idle_cb, self);
+  g_source_set_name_by_id (priv->prepare_id, "[phosh] prepare_lock_surfaces");
+}
+
+
+static void
+on_monitors_changed (PhoshLockscreenManager *self,
+                     GPtrArray              *added,
+                     GPtrArray              *removed,
+                     PhoshMonitorManager    *monitormanager)
+{
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+
+  g_return_if_fail (PHOSH_IS_LOCKSCREEN_MANAGER (self));
+
+  g_debug ("Monitors changed: %u added, %u removed", added->len, removed->len);
+  for (int i = 0; i < removed->len; i++) {
+    PhoshMonitor *monitor = g_ptr_array_index (removed, i);
+
+    g_hash_table_remove (priv->shields, monitor);
+
+    if (monitor != priv->lockscreen_monitor)
+      continue;
+
+    if (priv->locked)
+      move_lockscreen (self, removed);
+    else
+      destroy_lockscreen (self);
+  }
+
+  if (priv->locked) {
+    /* Lock new outputs right away */
+    for (int i = 0; i < added->len; i++) {
+      PhoshMonitor *monitor = g_ptr_array_index (added, i);
+
+      if (priv->lockscreen == NULL) {
+        create_lockscreen (self, monitor);
+        show_lockscreen (self);
+        continue;
+      }
+      /* The lock screen might have moved there already */
+      if (monitor == priv->lockscreen_monitor)
+        continue;
+      gtk_widget_show (prepare_shield (self, monitor));
+    }
+    return;
+  }
+
+  queue_prepare_surfaces (self);
+}
+
+
+static void
+on_primary_monitor_changed (PhoshLockscreenManager *self,
+                            GParamSpec             *pspec,
+                            PhoshShell             *shell)
+{
+  queue_prepare_surfaces (self);
+}
+
+
+static gboolean
+on_lockscreen_first_frame (PhoshLockscreenManager *self,
+                           cairo_t                *cr,
+                           PhoshLockscreen        *lockscreen)
+{
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+
+  g_signal_handler_disconnect (lockscreen, priv->first_frame_id);
+  priv->first_frame_id = 0;
+
+  priv->lock_latency = g_get_monotonic_time () - priv->active_time;
+  g_debug ("Lock screen shown after %" G_GINT64_FORMAT " ms", priv->lock_latency / 1000);
+  g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_LOCKSCREEN_MANAGER_PROP_LOCK_LATENCY]);
+
+  return GDK_EVENT_PROPAGATE;
+}
+
+
+static void
+lockscreen_lock (PhoshLockscreenManager *self)
+{
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+  PhoshShell *shell = phosh_shell_get_default ();
+  GHashTableIter iter;
+  GtkWidget *shield;
+
+  g_return_if_fail (!priv->locked);
+
   priv->active_time = g_get_monotonic_time ();
+
+  /* Usually a no-op since surfaces are built ahead of time */
+  g_clear_handle_id (&priv->prepare_id, g_source_remove);
+  prepare_surfaces (self);
+  g_return_if_fail (priv->lockscreen);
+
+  /* Undo any rotation so the keypad becomes usable */
+  priv->rotation = phosh_shell_get_rotation (shell);
+  phosh_shell_rotate_display (shell, 0);
+
+  priv->first_frame_id = g_signal_connect_object (priv->lockscreen, "draw",
+                                                  G_CALLBACK (on_lockscreen_first_frame),
+                                                  self,
+                                                  G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+  show_lockscreen (self);
+
+  /* Lock all other outputs */
+  g_hash_table_iter_init (&iter, priv->shields);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &shield))
+    gtk_widget_show (shield);
+
+  priv->locked = TRUE;
   g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_LOCKSCREEN_MANAGER_PROP_LOCKED]);
 }
 
@@ -248,6 +536,9 @@ phosh_lockscreen_manager_get_property (GObject *object,
   case PHOSH_LOCKSCREEN_MANAGER_PROP_TIMEOUT:
     g_value_set_uint (value, priv->timeout);
     break;
+  case PHOSH_LOCKSCREEN_MANAGER_PROP_LOCK_LATENCY:
+    g_value_set_int64 (value, priv->lock_latency);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     break;
@@ -261,11 +552,9 @@ phosh_lockscreen_manager_dispose (GObject *object)
   PhoshLockscreenManager *self = PHOSH_LOCKSCREEN_MANAGER (object);
   PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
 
-  g_clear_pointer (&priv->shields, g_ptr_array_unref);
-  if (priv->lockscreen) {
-    g_signal_handlers_disconnect_by_data (priv->lockscreen, self);
-    g_clear_pointer (&priv->lockscreen, phosh_cp_widget_destroy);
-  }
+  g_clear_handle_id (&priv->prepare_id, g_source_remove);
+  g_clear_pointer (&priv->shields, g_hash_table_destroy);
+  destroy_lockscreen (self);
   g_clear_object (&priv->settings);
 
   G_OBJECT_CLASS (phosh_lockscreen_manager_parent_class)->dispose (object);
@@ -290,6 +579,9 @@ phosh_lockscreen_manager_constructed (GObject *object)
                               (GCallback) presence_status_changed_cb,
                               self);
   }
+
+  /* The shell isn't fully up yet, build the surfaces once it is */
+  queue_prepare_surfaces (self);
 }
 
 
@@ -318,6 +610,20 @@ phosh_lockscreen_manager_class_init (PhoshLockscreenManagerClass *klass)
                       G_MAXINT,
                       300,
                       G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  /**
+   * PhoshLockscreenManager:lock-latency:
+   *
+   * The time in microseconds it took from the last lock request until
+   * the lock screen drew its first frame.
+   */
+  props[PHOSH_LOCKSCREEN_MANAGER_PROP_LOCK_LATENCY] =
+    g_param_spec_int64 ("lock-latency",
+                        "Lock latency",
+                        "Time from lock request to first lock screen frame",
+                        0,
+                        G_MAXINT64,
+                        0,
+                        G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
   g_object_class_install_properties (object_class, PHOSH_LOCKSCREEN_MANAGER_PROP_LAST_PROP, props);
 
   /**
@@ -336,6 +642,12 @@ phosh_lockscreen_manager_class_init (PhoshLockscreenManagerClass *klass)
 static void
 phosh_lockscreen_manager_init (PhoshLockscreenManager *self)
 {
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+
+  priv->shields = g_hash_table_new_full (g_direct_hash,
+                                         g_direct_equal,
+                                         NULL,
+                                         (GDestroyNotify) destroy_shield);
 }
 
 
@@ -406,3 +718,20 @@ phosh_lockscreen_manager_get_active_time (PhoshLockscreenManager *self)
   g_return_val_if_fail (PHOSH_IS_LOCKSCREEN_MANAGER (self), 0);
   return priv->active_time;
 }
+
+
+/**
+ * phosh_lockscreen_manager_get_lock_latency:
+ * @self: The #PhoshLockscreenManager
+ *
+ * Returns: The time in microseconds from the last lock request until
+ * the lock screen's first frame or 0 if it wasn't shown yet.
+ */
+gint64
+phosh_lockscreen_manager_get_lock_latency (PhoshLockscreenManager *self)
+{
+  PhoshLockscreenManagerPrivate *priv = phosh_lockscreen_manager_get_instance_private (self);
+
+  g_return_val_if_fail (PHOSH_IS_LOCKSCREEN_MANAGER (self), 0);
+  return priv->lock_latency;
+}
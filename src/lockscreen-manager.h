@@ -24,3 +24,4 @@ void                    phosh_lockscreen_manager_set_timeout (PhoshLockscreenMan
                                                               gint timeout);
 gint                    phosh_lockscreen_manager_get_timeout (PhoshLockscreenManager *self);
 gint64                  phosh_lockscreen_manager_get_active_time (PhoshLockscreenManager *self);
+gint64                  phosh_lockscreen_manager_get_lock_latency (PhoshLockscreenManager *self);
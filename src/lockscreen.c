@@ -59,6 +59,8 @@ typedef struct {
   guint      idle_timer;
   gint64     last_input;
   PhoshAuth *auth;
+  guint      shake_tick_id;
+  guint      shake_timeout_id;
 
   GnomeWallClock *wall_clock;
 } PhoshLockscreenPrivate;
@@ -123,12 +125,28 @@ show_unlock_page (PhoshLockscreen *self)
 
 static gboolean
 finish_shake_label (PhoshLockscreen *self) {
+  PhoshLockscreenPrivate *priv = phosh_lockscreen_get_instance_private (self);
+
+  priv->shake_timeout_id = 0;
   clear_input (self, TRUE);
   gtk_widget_set_sensitive (GTK_WIDGET (self), TRUE);
   return FALSE;
 }
 
 
+static void
+stop_shake_label (PhoshLockscreen *self)
+{
+  PhoshLockscreenPrivate *priv = phosh_lockscreen_get_instance_private (self);
+
+  if (priv->shake_tick_id) {
+    gtk_widget_remove_tick_callback (GTK_WIDGET (self), priv->shake_tick_id);
+    priv->shake_tick_id = 0;
+  }
+  g_clear_handle_id (&priv->shake_timeout_id, g_source_remove);
+}
+
+
 static gboolean
 shake_label (GtkWidget *widget,
                          GdkFrameClock *frame_clock,
@@ -146,7 +164,8 @@ shake_label (GtkWidget *widget,
     /* Stop the animation only when we would step over the idle position (0.5) */
     if ((gtk_entry_get_alignment (GTK_ENTRY (priv->entry_pin)) > 0.5 && pos < 0.5) || pos > 0.5) {
       gtk_entry_set_alignment (GTK_ENTRY (priv->entry_pin), 0.5);
-      g_timeout_add (400, (GSourceFunc) finish_shake_label, self);
+      priv->shake_tick_id = 0;
+      priv->shake_timeout_id = g_timeout_add (400, (GSourceFunc) finish_shake_label, self);
       return FALSE;
     }
   }
@@ -181,10 +200,11 @@ auth_async_cb (PhoshAuth *auth, GAsyncResult *result, PhoshLockscreen *self)
     /* give visual feedback on error */
     clock = gtk_widget_get_frame_clock (priv->entry_pin);
     now = gdk_frame_clock_get_frame_time (clock);
-    gtk_widget_add_tick_callback (GTK_WIDGET (self),
-                                  shake_label,
-                                  g_variant_ref_sink (g_variant_new_int64 (now)),
-                                  (GDestroyNotify) g_variant_unref);
+    stop_shake_label (self);
+    priv->shake_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (self),
+                                                        shake_label,
+                                                        g_variant_ref_sink (g_variant_new_int64 (now)),
+                                                        (GDestroyNotify) g_variant_unref);
 
 
   }
@@ -455,6 +475,7 @@ phosh_lockscreen_dispose (GObject *object)
   PhoshLockscreenPrivate *priv = phosh_lockscreen_get_instance_private (self);
 
   g_clear_object (&priv->wall_clock);
+  stop_shake_label (self);
   if (priv->idle_timer) {
     g_source_remove (priv->idle_timer);
     priv->idle_timer = 0;
@@ -522,6 +543,33 @@ phosh_lockscreen_init (PhoshLockscreen *self)
 }
 
 
+/**
+ * phosh_lockscreen_reset:
+ * @self: The #PhoshLockscreen
+ *
+ * Brings the lockscreen back into its initial state: The info page
+ * is shown with an up to date clock, any entered digits are cleared
+ * and a running shake animation is stopped. This allows to reuse the
+ * lock screen instead of building a new one.
+ */
+void
+phosh_lockscreen_reset (PhoshLockscreen *self)
+{
+  PhoshLockscreenPrivate *priv;
+
+  g_return_if_fail (PHOSH_IS_LOCKSCREEN (self));
+  priv = phosh_lockscreen_get_instance_private (self);
+
+  g_clear_handle_id (&priv->idle_timer, g_source_remove);
+  stop_shake_label (self);
+  clear_input (self, TRUE);
+  gtk_entry_set_alignment (GTK_ENTRY (priv->entry_pin), 0.5);
+  gtk_widget_set_sensitive (GTK_WIDGET (self), TRUE);
+  hdy_paginator_scroll_to_full (HDY_PAGINATOR (priv->paginator), priv->grid_info, 0);
+  wall_clock_notify_cb (self, NULL, priv->wall_clock);
+}
+
+
 GtkWidget *
 phosh_lockscreen_new (gpointer layer_shell,
                       gpointer wl_output)
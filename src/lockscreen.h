@@ -13,4 +13,5 @@ G_DECLARE_FINAL_TYPE (PhoshLockscreen, phosh_lockscreen, PHOSH, LOCKSCREEN,
                       PhoshLayerSurface)
 
 GtkWidget * phosh_lockscreen_new (gpointer layer_shell, gpointer wl_output);
+void        phosh_lockscreen_reset (PhoshLockscreen *self);
 
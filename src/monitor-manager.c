@@ -17,10 +17,13 @@
 
 #include <gdk/gdkwayland.h>
 
+/* Outputs of a dock usually show up within a couple of roundtrips */
+#define OUTPUTS_CHANGED_DEBOUNCE_MS 50
 
 enum {
   SIGNAL_MONITOR_ADDED,
   SIGNAL_MONITOR_REMOVED,
+  SIGNAL_MONITORS_CHANGED,
   N_SIGNALS
 };
 static guint signals[N_SIGNALS] = { 0 };
@@ -33,6 +36,7 @@ typedef struct _PhoshMonitorManager
   PhoshDisplayDbusDisplayConfigSkeleton parent;
 
   GPtrArray *monitors;   /* Currently known monitors */
+  guint outputs_changed_id;
 
   int dbus_name_id;
   int serial;
@@ -189,52 +193,35 @@ phosh_monitor_manager_handle_change_backlight (
 }
 
 
-struct get_wl_gamma_callback_data {
-  PhoshDisplayDbusDisplayConfig *skeleton;
-  GDBusMethodInvocation *invocation;
-};
-
-
-static void handle_wl_gamma_size(void *data, struct gamma_control *gamma_control,
-                                 uint32_t size) {
-  struct get_wl_gamma_callback_data *gamma_callback_data = data;
-  GBytes *red_bytes, *green_bytes, *blue_bytes;
-  GVariant *red_v, *green_v, *blue_v;
-  /* All known clients using libgnome-desktop's
-     gnome_rr_crtc_get_gamma only do so to get the size of the gamma
-     table. So don't bother getting the real table since this is not
-     supported by wlroots: https://github.com/swaywm/wlroots/pull/1059.
-     Return an empty table instead.
-  */
-  size *= sizeof(unsigned short);
-  red_bytes = g_bytes_new_take (g_malloc0 (size), size);
-  green_bytes = g_bytes_new_take (g_malloc0 (size), size);
-  blue_bytes = g_bytes_new_take (g_malloc0 (size), size);
-
-  red_v = g_variant_new_from_bytes (G_VARIANT_TYPE ("aq"), red_bytes, TRUE);
-  green_v = g_variant_new_from_bytes (G_VARIANT_TYPE ("aq"), green_bytes, TRUE);
-  blue_v = g_variant_new_from_bytes (G_VARIANT_TYPE ("aq"), blue_bytes, TRUE);
+/*
+ * Gamma controls are created when the monitor is added and the
+ * compositor sends the ramp size shortly after so don't block on it
+ * but let the caller retry.
+ */
+static struct gamma_control *
+get_gamma_control (PhoshMonitor *monitor, GDBusMethodInvocation *invocation)
+{
+  struct gamma_control *gamma_control;
 
-  phosh_display_dbus_display_config_complete_get_crtc_gamma (
-    gamma_callback_data->skeleton,
-    gamma_callback_data->invocation,
-    red_v, green_v, blue_v);
+  gamma_control = phosh_monitor_get_gamma_control (monitor);
+  if (gamma_control == NULL) {
+    g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                           G_DBUS_ERROR_NOT_SUPPORTED,
+                                           "gamma control not supported");
+    return NULL;
+  }
 
-  g_bytes_unref (red_bytes);
-  g_bytes_unref (green_bytes);
-  g_bytes_unref (blue_bytes);
+  if (monitor->gamma_size == 0) {
+    g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                           G_DBUS_ERROR_NOT_SUPPORTED,
+                                           "gamma size not known yet, try again later");
+    return NULL;
+  }
 
-  g_free (gamma_callback_data);
-  gamma_control_destroy (gamma_control);
+  return gamma_control;
 }
 
 
-static const struct
-gamma_control_listener gamma_control_listener = {
-	.gamma_size = handle_wl_gamma_size,
-};
-
-
 static gboolean
 phosh_monitor_manager_handle_get_crtc_gamma (
   PhoshDisplayDbusDisplayConfig *skeleton,
@@ -244,9 +231,8 @@ phosh_monitor_manager_handle_get_crtc_gamma (
 {
   PhoshMonitorManager *self = PHOSH_MONITOR_MANAGER (skeleton);
   PhoshMonitor *monitor;
-  struct gamma_control *gamma_control;
-  struct gamma_control_manager *gamma_control_manager;
-  struct get_wl_gamma_callback_data *data;;
+  g_autofree guint16 *ramp = NULL;
+  GVariant *red_v, *green_v, *blue_v;
 
   g_debug ("DBus call %s for crtc %d, serial %d", __func__, crtc_id, serial);
 
@@ -264,24 +250,25 @@ phosh_monitor_manager_handle_get_crtc_gamma (
     return TRUE;
   }
 
-  gamma_control_manager = phosh_wayland_get_gamma_control_manager (
-    phosh_wayland_get_default ());
-  if (gamma_control_manager == NULL) {
-    g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
-                                           G_DBUS_ERROR_NOT_SUPPORTED,
-                                           "gamma control not supported");
+  monitor = g_ptr_array_index (self->monitors, crtc_id);
+  if (get_gamma_control (monitor, invocation) == NULL)
     return TRUE;
-  }
 
-  data = g_new0 (struct get_wl_gamma_callback_data, 1);
-  data->skeleton = skeleton;
-  data->invocation = invocation;
+  /* All known clients using libgnome-desktop's
+     gnome_rr_crtc_get_gamma only do so to get the size of the gamma
+     table. So don't bother getting the real table since this is not
+     supported by wlroots: https://github.com/swaywm/wlroots/pull/1059.
+     Return an empty table instead.
+  */
+  ramp = g_new0 (guint16, monitor->gamma_size);
+  red_v = g_variant_new_fixed_array (G_VARIANT_TYPE_UINT16, ramp, monitor->gamma_size, sizeof (guint16));
+  green_v = g_variant_new_fixed_array (G_VARIANT_TYPE_UINT16, ramp, monitor->gamma_size, sizeof (guint16));
+  blue_v = g_variant_new_fixed_array (G_VARIANT_TYPE_UINT16, ramp, monitor->gamma_size, sizeof (guint16));
 
-  monitor = g_ptr_array_index (self->monitors, crtc_id);
-  gamma_control = gamma_control_manager_get_gamma_control (
-    gamma_control_manager,
-    monitor->wl_output);
-  gamma_control_add_listener (gamma_control, &gamma_control_listener, data);
+  phosh_display_dbus_display_config_complete_get_crtc_gamma (
+    skeleton,
+    invocation,
+    red_v, green_v, blue_v);
 
   return TRUE;
 }
@@ -299,10 +286,8 @@ phosh_monitor_manager_handle_set_crtc_gamma (
 {
   PhoshMonitorManager *self = PHOSH_MONITOR_MANAGER (skeleton);
   PhoshMonitor *monitor;
-  unsigned short *red, *green, *blue;
-  GBytes *red_bytes, *green_bytes, *blue_bytes;
-  gsize size, dummy;
-  struct gamma_control_manager *gamma_control_manager;
+  const guint16 *red, *green, *blue;
+  gsize n_red, n_green, n_blue;
   struct gamma_control *gamma_control;
   struct wl_array wl_red, wl_green, wl_blue;
 
@@ -321,63 +306,43 @@ phosh_monitor_manager_handle_set_crtc_gamma (
     return TRUE;
   }
 
-  gamma_control_manager = phosh_wayland_get_gamma_control_manager (
-    phosh_wayland_get_default ());
-  if (!gamma_control_manager) {
-    g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
-                                           G_DBUS_ERROR_NOT_SUPPORTED,
-                                           "gamma control not supported");
-    return TRUE;
-  }
-
   monitor = g_ptr_array_index (self->monitors, crtc_id);
+  gamma_control = get_gamma_control (monitor, invocation);
+  if (!gamma_control)
+    return TRUE;
 
-  red_bytes = g_variant_get_data_as_bytes (red_v);
-  green_bytes = g_variant_get_data_as_bytes (green_v);
-  blue_bytes = g_variant_get_data_as_bytes (blue_v);
+  red = g_variant_get_fixed_array (red_v, &n_red, sizeof (guint16));
+  green = g_variant_get_fixed_array (green_v, &n_green, sizeof (guint16));
+  blue = g_variant_get_fixed_array (blue_v, &n_blue, sizeof (guint16));
 
-  size = g_bytes_get_size (red_bytes);
-  if (size != g_bytes_get_size (blue_bytes) || size != g_bytes_get_size (green_bytes)) {
-        g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+  if (n_red != n_green || n_red != n_blue) {
+    g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
                                            G_DBUS_ERROR_NOT_SUPPORTED,
                                            "gamma for each color must have same size");
-    goto err;
+    return TRUE;
   }
 
-  red = (unsigned short*) g_bytes_get_data (red_bytes, &dummy);
-  green = (unsigned short*) g_bytes_get_data (green_bytes, &dummy);
-  blue = (unsigned short*) g_bytes_get_data (blue_bytes, &dummy);
-
-  wl_array_init (&wl_red);
-  wl_array_init (&wl_green);
-  wl_array_init (&wl_blue);
-
-  wl_array_add (&wl_red, size);
-  wl_array_add (&wl_green, size);
-  wl_array_add (&wl_blue, size);
+  /* A wrong size is a protocol error that would disconnect us */
+  if (n_red != monitor->gamma_size) {
+    g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                           G_DBUS_ERROR_INVALID_ARGS,
+                                           "gamma size %" G_GSIZE_FORMAT " doesn't match %u",
+                                           n_red, monitor->gamma_size);
+    return TRUE;
+  }
 
-  memcpy(wl_red.data, red, size);
-  memcpy(wl_green.data, green, size);
-  memcpy(wl_blue.data, blue, size);
+  /* libwayland only reads the arrays while marshalling so pass the
+     D-Bus payload on without copying it */
+  wl_red = (struct wl_array) { .size = n_red * sizeof (guint16), .data = (gpointer) red };
+  wl_green = (struct wl_array) { .size = n_green * sizeof (guint16), .data = (gpointer) green };
+  wl_blue = (struct wl_array) { .size = n_blue * sizeof (guint16), .data = (gpointer) blue };
 
-  gamma_control = gamma_control_manager_get_gamma_control (
-    gamma_control_manager,
-    monitor->wl_output);
-  gamma_control_set_gamma(gamma_control, &wl_red, &wl_green, &wl_blue);
-  gamma_control_destroy (gamma_control);
+  gamma_control_set_gamma (gamma_control, &wl_red, &wl_green, &wl_blue);
 
   phosh_display_dbus_display_config_complete_set_crtc_gamma (
       skeleton,
       invocation);
 
-  wl_array_release (&wl_red);
-  wl_array_release (&wl_green);
-  wl_array_release (&wl_blue);
-
- err:
-  g_bytes_unref (red_bytes);
-  g_bytes_unref (green_bytes);
-  g_bytes_unref (blue_bytes);
   return TRUE;
 }
 
@@ -765,10 +730,18 @@ on_monitor_removed (PhoshMonitorManager *self,
 }
 
 
+/*
+ * Reconcile the monitors with the current set of wl_outputs in one
+ * pass so consumers see a single transaction when e.g. a dock with
+ * several outputs gets plugged in.
+ */
 static void
-on_wl_outputs_changed (PhoshMonitorManager *self, GParamSpec *pspec, PhoshWayland *wl)
+sync_monitors (PhoshMonitorManager *self)
 {
+  PhoshWayland *wl = phosh_wayland_get_default ();
   GHashTable *wl_outputs = phosh_wayland_get_wl_outputs (wl);
+  g_autoptr (GPtrArray) added = g_ptr_array_new_with_free_func (g_object_unref);
+  g_autoptr (GPtrArray) removed = g_ptr_array_new_with_free_func (g_object_unref);
   GHashTableIter iter;
   struct wl_output *wl_output;
   PhoshMonitor *monitor;
@@ -776,13 +749,16 @@ on_wl_outputs_changed (PhoshMonitorManager *self, GParamSpec *pspec, PhoshWaylan
   /* Check for gone outputs */
   for (int i = 0; i < self->monitors->len; i++) {
     monitor = g_ptr_array_index (self->monitors, i);
-    if (!phosh_wayland_has_wl_output (wl, monitor->wl_output)) {
-      g_debug ("Monitor %p (%s) gone", monitor, monitor->name);
-      g_signal_emit (self, signals[SIGNAL_MONITOR_REMOVED], 0, monitor);
-      /* The monitor is removed from monitors in the class'es default
-       * signal handler */
-      return;
-    }
+    if (!phosh_wayland_has_wl_output (wl, monitor->wl_output))
+      g_ptr_array_add (removed, g_object_ref (monitor));
+  }
+
+  for (int i = 0; i < removed->len; i++) {
+    monitor = g_ptr_array_index (removed, i);
+    g_debug ("Monitor %p (%s) gone", monitor, monitor->name);
+    /* The monitor is removed from monitors in the class'es default
+     * signal handler */
+    g_signal_emit (self, signals[SIGNAL_MONITOR_REMOVED], 0, monitor);
   }
 
   /* Check for new outputs */
@@ -790,11 +766,40 @@ on_wl_outputs_changed (PhoshMonitorManager *self, GParamSpec *pspec, PhoshWaylan
   while (g_hash_table_iter_next (&iter, NULL, (gpointer)&wl_output)) {
     if (!find_monitor_by_wl_output (self, wl_output)) {
       monitor = phosh_monitor_new_from_wl_output (wl_output);
+      g_ptr_array_add (added, g_object_ref (monitor));
       phosh_monitor_manager_add_monitor (self, monitor);
       g_debug ("Monitor %p added", monitor);
-      return;
     }
   }
+
+  if (added->len == 0 && removed->len == 0)
+    return;
+
+  g_debug ("Monitors changed: %u added, %u removed", added->len, removed->len);
+  g_signal_emit (self, signals[SIGNAL_MONITORS_CHANGED], 0, added, removed);
+}
+
+
+static gboolean
+on_outputs_changed_timeout (PhoshMonitorManager *self)
+{
+  self->outputs_changed_id = 0;
+  sync_monitors (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+static void
+on_wl_outputs_changed (PhoshMonitorManager *self, GParamSpec *pspec, PhoshWayland *wl)
+{
+  if (self->outputs_changed_id)
+    g_source_remove (self->outputs_changed_id);
+
+  self->outputs_changed_id = g_timeout_add (OUTPUTS_CHANGED_DEBOUNCE_MS,
+                                            (GSourceFunc) on_outputs_changed_timeout,
+                                            self);
+  g_source_set_name_by_id (self->outputs_changed_id, "[phosh] sync_monitors");
 }
 
 
@@ -803,6 +808,8 @@ phosh_monitor_manager_finalize (GObject *object)
 {
   PhoshMonitorManager *self = PHOSH_MONITOR_MANAGER (object);
 
+  g_clear_handle_id (&self->outputs_changed_id, g_source_remove);
+  g_signal_handlers_disconnect_by_data (phosh_wayland_get_default (), self);
   g_ptr_array_free (self->monitors, TRUE);
 
   G_OBJECT_CLASS (phosh_monitor_manager_parent_class)->finalize (object);
@@ -880,6 +887,24 @@ phosh_monitor_manager_class_init (PhoshMonitorManagerClass *klass)
     G_SIGNAL_RUN_CLEANUP,
     G_CALLBACK (on_monitor_removed),
     NULL, NULL,  NULL, G_TYPE_NONE, 1, PHOSH_TYPE_MONITOR);
+
+  /**
+   * PhoshMonitorManager::monitors-changed:
+   * @manager: The #PhoshMonitorManager emitting the signal.
+   * @added: (element-type PhoshMonitor): The #PhoshMonitor s added
+   * @removed: (element-type PhoshMonitor): The #PhoshMonitor s removed
+   *
+   * Emitted once after a batch of output changes got processed. The
+   * #PhoshMonitorManager::monitor-added and
+   * #PhoshMonitorManager::monitor-removed signals for the individual
+   * monitors were emitted before. Newly added monitors might not be
+   * fully initialized yet, see #PhoshMonitorManager::monitor-added.
+   * Removed monitors are not part of the manager anymore.
+   */
+  signals[SIGNAL_MONITORS_CHANGED] = g_signal_new (
+    "monitors-changed",
+    G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+    NULL, G_TYPE_NONE, 2, G_TYPE_PTR_ARRAY, G_TYPE_PTR_ARRAY);
 }
 
 
@@ -901,6 +926,8 @@ void
 phosh_monitor_manager_add_monitor (PhoshMonitorManager *self, PhoshMonitor *monitor)
 {
   g_ptr_array_add (self->monitors, monitor);
+  /* So the ramp size is known by the time clients ask for it */
+  phosh_monitor_get_gamma_control (monitor);
   g_signal_emit (self, signals[SIGNAL_MONITOR_ADDED], 0, monitor);
 }
 
@@ -297,6 +297,7 @@ phosh_monitor_dispose (GObject *object)
   g_clear_pointer (&self->name, g_free);
   g_clear_pointer (&self->xdg_output, zxdg_output_v1_destroy);
   g_clear_pointer (&self->wlr_output_power, zwlr_output_power_v1_destroy);
+  g_clear_pointer (&self->gamma_control, gamma_control_destroy);
 
   G_OBJECT_CLASS (phosh_monitor_parent_class)->dispose (object);
 }
@@ -485,3 +486,56 @@ phosh_monitor_get_rotation (PhoshMonitor *self)
       g_assert_not_reached ();
     }
 }
+
+
+static void
+gamma_control_handle_gamma_size (void                 *data,
+                                 struct gamma_control *gamma_control,
+                                 uint32_t              size)
+{
+  PhoshMonitor *self = PHOSH_MONITOR (data);
+
+  g_debug ("Monitor %p (%s) has gamma size %u", self, self->name, size);
+  self->gamma_size = size;
+}
+
+
+static const struct gamma_control_listener gamma_control_listener = {
+  .gamma_size = gamma_control_handle_gamma_size,
+};
+
+
+/**
+ * phosh_monitor_get_gamma_control:
+ * @self: A #PhoshMonitor
+ *
+ * Gets the gamma control of this monitor. It's created on first use
+ * and kept for the monitor's lifetime so frequent gamma changes
+ * (e.g. by night light) don't need a new one each time. The ramp size
+ * is available in #PhoshMonitor's gamma_size once the compositor sent
+ * it, until then it's 0.
+ *
+ * Returns: (transfer none) (nullable): The gamma control or %NULL if
+ * not supported by the compositor.
+ */
+struct gamma_control *
+phosh_monitor_get_gamma_control (PhoshMonitor *self)
+{
+  struct gamma_control_manager *gamma_control_manager;
+
+  g_return_val_if_fail (PHOSH_IS_MONITOR (self), NULL);
+
+  if (self->gamma_control)
+    return self->gamma_control;
+
+  gamma_control_manager = phosh_wayland_get_gamma_control_manager (
+    phosh_wayland_get_default ());
+  if (gamma_control_manager == NULL)
+    return NULL;
+
+  self->gamma_control = gamma_control_manager_get_gamma_control (gamma_control_manager,
+                                                                 self->wl_output);
+  gamma_control_add_listener (self->gamma_control, &gamma_control_listener, self);
+
+  return self->gamma_control;
+}
@@ -50,6 +50,8 @@ struct _PhoshMonitor {
   struct wl_output *wl_output;
   struct zxdg_output_v1 *xdg_output;
   struct zwlr_output_power_v1 *wlr_output_power;
+  struct gamma_control *gamma_control;
+  guint32 gamma_size;
 
   gint x, y, width, height;
   gint subpixel;
@@ -80,3 +82,4 @@ gboolean           phosh_monitor_is_configured (PhoshMonitor *monitor);
 gboolean           phosh_monitor_is_builtin (PhoshMonitor *monitor);
 gboolean           phosh_monitor_is_flipped (PhoshMonitor *monitor);
 guint              phosh_monitor_get_rotation (PhoshMonitor *monitor);
+struct gamma_control *phosh_monitor_get_gamma_control (PhoshMonitor *monitor);
@@ -11,6 +11,8 @@
 #include "notification-frame.h"
 #include "shell.h"
 
+#include <glib/gi18n.h>
+
 #define HANDY_USE_UNSTABLE_API
 #include <handy.h>
 
@@ -18,22 +20,41 @@
  * SECTION:phosh-notification-banner
  * @short_description: A floating notification
  * @Title: PhoshNotificationBanner
+ *
+ * The banner shows a single notification. When that notification is
+ * closed handlers of #PhoshNotificationBanner::notification-done can
+ * put the next notification into the banner so the surface is reused
+ * otherwise the banner is destroyed. The number of notifications that
+ * were coalesced into the banner can be shown below it.
  */
 
 enum {
   PROP_0,
   PROP_NOTIFICATION,
+  PROP_COALESCED,
   LAST_PROP
 };
 static GParamSpec *props[LAST_PROP];
 
 
+enum {
+  SIGNAL_NOTIFICATION_DONE,
+  N_SIGNALS
+};
+static guint signals[N_SIGNALS];
+
+
 struct _PhoshNotificationBanner {
   PhoshLayerSurface parent;
 
   PhoshNotification *notification;
   gulong handler_expired;
   gulong handler_closed;
+  guint  coalesced;
+
+  GtkWidget *box;
+  GtkWidget *frame;
+  GtkWidget *lbl_coalesced;
 
   struct {
     gdouble progress;
@@ -65,6 +86,21 @@ clear_handler (PhoshNotificationBanner *self)
 }
 
 
+static void
+notification_done (PhoshNotificationBanner *self)
+{
+  g_autoptr (PhoshNotification) notification = g_object_ref (self->notification);
+
+  clear_handler (self);
+
+  g_signal_emit (self, signals[SIGNAL_NOTIFICATION_DONE], 0, notification);
+
+  // Nobody gave us a new notification, close the banner
+  if (self->notification == notification)
+    gtk_widget_destroy (GTK_WIDGET (self));
+}
+
+
 static void
 expired (PhoshNotification       *notification,
          PhoshNotificationBanner *self)
@@ -72,10 +108,7 @@ expired (PhoshNotification       *notification,
   g_return_if_fail (PHOSH_IS_NOTIFICATION_BANNER (self));
   g_return_if_fail (PHOSH_IS_NOTIFICATION (notification));
 
-  clear_handler (self);
-
-  // Close the banner
-  gtk_widget_destroy (GTK_WIDGET (self));
+  notification_done (self);
 }
 
 
@@ -87,32 +120,38 @@ closed (PhoshNotification       *notification,
   g_return_if_fail (PHOSH_IS_NOTIFICATION_BANNER (self));
   g_return_if_fail (PHOSH_IS_NOTIFICATION (notification));
 
-  clear_handler (self);
-
-  // Close the banner
-  gtk_widget_destroy (GTK_WIDGET (self));
+  notification_done (self);
 }
 
 
 static void
-phosh_notification_banner_set_notification (PhoshNotificationBanner *self,
-                                            PhoshNotification       *notification)
+update_coalesced_label (PhoshNotificationBanner *self)
 {
-  GtkWidget *content;
+  g_autofree gchar *text = NULL;
+  const gchar *app_name = NULL;
 
-  g_set_object (&self->notification, notification);
-
-  content = phosh_notification_frame_new ();
-  phosh_notification_frame_bind_notification (PHOSH_NOTIFICATION_FRAME (content),
-                                              self->notification);
-  gtk_container_add (GTK_CONTAINER (self), content);
+  if (self->coalesced == 0) {
+    gtk_widget_hide (self->lbl_coalesced);
+    return;
+  }
 
-  self->handler_expired = g_signal_connect (self->notification, "expired",
-                                            G_CALLBACK (expired), self);
-  self->handler_closed = g_signal_connect (self->notification, "closed",
-                                           G_CALLBACK (closed), self);
+  if (self->notification)
+    app_name = phosh_notification_get_app_name (self->notification);
+
+  if (app_name && *app_name) {
+    text = g_strdup_printf (ngettext ("%u more notification from %s",
+                                      "%u more notifications from %s",
+                                      self->coalesced),
+                            self->coalesced, app_name);
+  } else {
+    text = g_strdup_printf (ngettext ("%u more notification",
+                                      "%u more notifications",
+                                      self->coalesced),
+                            self->coalesced);
+  }
 
-  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_NOTIFICATION]);
+  gtk_label_set_label (GTK_LABEL (self->lbl_coalesced), text);
+  gtk_widget_show (self->lbl_coalesced);
 }
 
 
@@ -129,6 +168,9 @@ phosh_notification_banner_set_property (GObject      *object,
       phosh_notification_banner_set_notification (self,
                                                   g_value_get_object (value));
       break;
+    case PROP_COALESCED:
+      phosh_notification_banner_set_coalesced (self, g_value_get_uint (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -148,6 +190,9 @@ phosh_notification_banner_get_property (GObject    *object,
     case PROP_NOTIFICATION:
       g_value_set_object (value, self->notification);
       break;
+    case PROP_COALESCED:
+      g_value_set_uint (value, self->coalesced);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -253,11 +298,46 @@ phosh_notification_banner_class_init (PhoshNotificationBannerClass *klass)
                          "Notification",
                          "Notification in the banner",
                          PHOSH_TYPE_NOTIFICATION,
-                         G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE |
+                         G_PARAM_READWRITE |
                          G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * PhoshNotificationBanner:coalesced:
+   * @self: the #PhoshNotificationBanner
+   *
+   * The number of further notifications from the same app that
+   * were folded into @self
+   */
+  props[PROP_COALESCED] =
+    g_param_spec_uint ("coalesced",
+                       "Coalesced",
+                       "Number of coalesced notifications",
+                       0, G_MAXUINT, 0,
+                       G_PARAM_READWRITE |
+                       G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
+
   g_object_class_install_properties (object_class, LAST_PROP, props);
 
+  /**
+   * PhoshNotificationBanner::notification-done:
+   * @self: the #PhoshNotificationBanner
+   * @notification: the #PhoshNotification that went away
+   *
+   * The shown notification expired or was closed. Handlers can call
+   * phosh_notification_banner_set_notification() to reuse the banner
+   * for another notification, otherwise the banner is destroyed.
+   */
+  signals[SIGNAL_NOTIFICATION_DONE] = g_signal_new ("notification-done",
+                                                    G_TYPE_FROM_CLASS (klass),
+                                                    G_SIGNAL_RUN_LAST,
+                                                    0,
+                                                    NULL,
+                                                    NULL,
+                                                    NULL,
+                                                    G_TYPE_NONE,
+                                                    1,
+                                                    PHOSH_TYPE_NOTIFICATION);
+
   gtk_widget_class_set_css_name (widget_class, "phosh-notification-banner");
 }
 
@@ -265,7 +345,19 @@ phosh_notification_banner_class_init (PhoshNotificationBannerClass *klass)
 static void
 phosh_notification_banner_init (PhoshNotificationBanner *self)
 {
+  GtkStyleContext *context;
+
   self->animation.progress = 0.0;
+
+  self->box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  gtk_widget_show (self->box);
+  gtk_container_add (GTK_CONTAINER (self), self->box);
+
+  self->lbl_coalesced = gtk_label_new (NULL);
+  gtk_label_set_ellipsize (GTK_LABEL (self->lbl_coalesced), PANGO_ELLIPSIZE_END);
+  context = gtk_widget_get_style_context (self->lbl_coalesced);
+  gtk_style_context_add_class (context, "coalesced");
+  gtk_box_pack_end (GTK_BOX (self->box), self->lbl_coalesced, FALSE, FALSE, 0);
 }
 
 
@@ -300,3 +392,76 @@ phosh_notification_banner_get_notification (PhoshNotificationBanner *self)
 
   return self->notification;
 }
+
+
+/**
+ * phosh_notification_banner_set_notification:
+ * @self: the #PhoshNotificationBanner
+ * @notification: the #PhoshNotification to show
+ *
+ * Shows @notification in @self replacing the current notification.
+ * The banner's surface stays mapped, only its content is replaced.
+ */
+void
+phosh_notification_banner_set_notification (PhoshNotificationBanner *self,
+                                            PhoshNotification       *notification)
+{
+  g_return_if_fail (PHOSH_IS_NOTIFICATION_BANNER (self));
+  g_return_if_fail (PHOSH_IS_NOTIFICATION (notification));
+
+  if (self->notification == notification)
+    return;
+
+  clear_handler (self);
+  g_set_object (&self->notification, notification);
+
+  if (self->frame)
+    gtk_widget_destroy (self->frame);
+
+  self->frame = phosh_notification_frame_new ();
+  phosh_notification_frame_bind_notification (PHOSH_NOTIFICATION_FRAME (self->frame),
+                                              self->notification);
+  gtk_box_pack_start (GTK_BOX (self->box), self->frame, FALSE, FALSE, 0);
+
+  self->handler_expired = g_signal_connect (self->notification, "expired",
+                                            G_CALLBACK (expired), self);
+  self->handler_closed = g_signal_connect (self->notification, "closed",
+                                           G_CALLBACK (closed), self);
+
+  update_coalesced_label (self);
+
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_NOTIFICATION]);
+}
+
+
+/**
+ * phosh_notification_banner_set_coalesced:
+ * @self: the #PhoshNotificationBanner
+ * @coalesced: number of notifications folded into @self
+ *
+ * Sets the number of further notifications that were coalesced into
+ * this banner. If non-zero a hint is shown below the notification.
+ */
+void
+phosh_notification_banner_set_coalesced (PhoshNotificationBanner *self,
+                                         guint                    coalesced)
+{
+  g_return_if_fail (PHOSH_IS_NOTIFICATION_BANNER (self));
+
+  if (self->coalesced == coalesced)
+    return;
+
+  self->coalesced = coalesced;
+  update_coalesced_label (self);
+
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_COALESCED]);
+}
+
+
+guint
+phosh_notification_banner_get_coalesced (PhoshNotificationBanner *self)
+{
+  g_return_val_if_fail (PHOSH_IS_NOTIFICATION_BANNER (self), 0);
+
+  return self->coalesced;
+}
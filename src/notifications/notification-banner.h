@@ -19,7 +19,12 @@ G_DECLARE_FINAL_TYPE (PhoshNotificationBanner, phosh_notification_banner, PHOSH,
 
 
 GtkWidget         *phosh_notification_banner_new              (PhoshNotification       *notification);
+void               phosh_notification_banner_set_notification (PhoshNotificationBanner *self,
+                                                               PhoshNotification       *notification);
 PhoshNotification *phosh_notification_banner_get_notification (PhoshNotificationBanner *self);
+void               phosh_notification_banner_set_coalesced    (PhoshNotificationBanner *self,
+                                                               guint                    coalesced);
+guint              phosh_notification_banner_get_coalesced    (PhoshNotificationBanner *self);
 
 
 G_END_DECLS
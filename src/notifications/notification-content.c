@@ -9,6 +9,7 @@
 #define G_LOG_DOMAIN "phosh-notification-content"
 
 #include "config.h"
+#include "icon-cache.h"
 #include "notification-content.h"
 
 
@@ -50,15 +51,32 @@ set_image (GBinding     *binding,
 {
   PhoshNotificationContent *self = user_data;
   GIcon *image = g_value_get_object (from_value);
+  cairo_surface_t *surface = NULL;
 
-  gtk_widget_set_visible (self->img_image, image != NULL);
+  if (image) {
+    surface = phosh_icon_cache_lookup (phosh_icon_cache_get_default (),
+                                       image,
+                                       PHOSH_NOTIFICATION_CONTENT_IMAGE_SIZE,
+                                       gtk_widget_get_scale_factor (self->img_image));
+  }
+
+  gtk_widget_set_visible (self->img_image, surface != NULL);
 
-  g_value_set_object (to_value, image);
+  g_value_take_boxed (to_value, surface);
 
   return TRUE;
 }
 
 
+static void
+on_scale_factor_changed (PhoshNotificationContent *self)
+{
+  /* Re-run set_image () for the new scale */
+  if (self->notification)
+    g_object_notify (G_OBJECT (self->notification), "image");
+}
+
+
 static gboolean
 set_summary (GBinding     *binding,
              const GValue *from_value,
@@ -157,7 +175,7 @@ phosh_notification_content_set_notification (PhoshNotificationContent *self,
 
   // Use the "transform" function to show/hide when set/unset
   g_object_bind_property_full (self->notification, "image",
-                               self->img_image,    "gicon",
+                               self->img_image,    "surface",
                                G_BINDING_SYNC_CREATE,
                                set_image,
                                NULL,
@@ -312,6 +330,9 @@ phosh_notification_content_init (PhoshNotificationContent *self)
                                   G_ACTION_GROUP (map));
 
   gtk_widget_init_template (GTK_WIDGET (self));
+
+  g_signal_connect_swapped (self->img_image, "notify::scale-factor",
+                            G_CALLBACK (on_scale_factor_changed), self);
 }
 
 
@@ -17,6 +17,9 @@ G_BEGIN_DECLS
 
 #define PHOSH_TYPE_NOTIFICATION_CONTENT (phosh_notification_content_get_type ())
 
+/* The pixel size of the image, see notification-content.ui */
+#define PHOSH_NOTIFICATION_CONTENT_IMAGE_SIZE 32
+
 
 G_DECLARE_FINAL_TYPE (PhoshNotificationContent, phosh_notification_content, PHOSH, NOTIFICATION_CONTENT, GtkListBoxRow)
 
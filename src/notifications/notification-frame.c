@@ -9,9 +9,12 @@
 #define G_LOG_DOMAIN "phosh-notification-frame"
 
 #include "config.h"
+#include "icon-cache.h"
 #include "notification-content.h"
 #include "notification-frame.h"
 
+#define APP_ICON_SIZE 16 /* see notification-frame.ui */
+
 /**
  * SECTION:phosh-notification-frame
  * @short_description: A frame containing one or more notifications
@@ -94,6 +97,15 @@ notification_activated (PhoshNotificationFrame *self,
 }
 
 
+static void
+on_scale_factor_changed (PhoshNotificationFrame *self)
+{
+  /* Re-run set_icon () for the new scale */
+  if (self->bind_icon)
+    g_object_notify (g_binding_get_source (self->bind_icon), "app-icon");
+}
+
+
 static void
 phosh_notification_frame_class_init (PhoshNotificationFrameClass *klass)
 {
@@ -129,6 +141,9 @@ static void
 phosh_notification_frame_init (PhoshNotificationFrame *self)
 {
   gtk_widget_init_template (GTK_WIDGET (self));
+
+  g_signal_connect_swapped (self->img_icon, "notify::scale-factor",
+                            G_CALLBACK (on_scale_factor_changed), self);
 }
 
 
@@ -148,6 +163,29 @@ create_row (gpointer item, gpointer data)
 }
 
 
+static gboolean
+set_icon (GBinding     *binding,
+          const GValue *from_value,
+          GValue       *to_value,
+          gpointer      user_data)
+{
+  PhoshNotificationFrame *self = user_data;
+  GIcon *icon = g_value_get_object (from_value);
+  cairo_surface_t *surface = NULL;
+
+  if (icon) {
+    surface = phosh_icon_cache_lookup (phosh_icon_cache_get_default (),
+                                       icon,
+                                       APP_ICON_SIZE,
+                                       gtk_widget_get_scale_factor (self->img_icon));
+  }
+
+  g_value_take_boxed (to_value, surface);
+
+  return TRUE;
+}
+
+
 static void
 items_changed (GListModel             *list,
                guint                   position,
@@ -180,9 +218,13 @@ items_changed (GListModel             *list,
                                             self->lbl_app_name, "label",
                                             G_BINDING_SYNC_CREATE);
 
-  self->bind_icon = g_object_bind_property (notification,   "app-icon",
-                                            self->img_icon, "gicon",
-                                            G_BINDING_SYNC_CREATE);
+  self->bind_icon = g_object_bind_property_full (notification,   "app-icon",
+                                                 self->img_icon, "surface",
+                                                 G_BINDING_SYNC_CREATE,
+                                                 set_icon,
+                                                 NULL,
+                                                 self,
+                                                 NULL);
 }
 
 
@@ -243,8 +285,9 @@ phosh_notification_frame_bind_notification (PhoshNotificationFrame *self,
 
   g_list_store_append (store, notification);
 
-  g_signal_connect_swapped (notification, "closed",
-                            G_CALLBACK (closed), self);
+  g_signal_connect_object (notification, "closed",
+                           G_CALLBACK (closed), self,
+                           G_CONNECT_SWAPPED);
 
   phosh_notification_frame_bind_model (self, G_LIST_MODEL (store));
 }
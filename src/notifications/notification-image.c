@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#define G_LOG_DOMAIN "phosh-notification-image"
+
+#include "notification-content.h"
+#include "notification-image.h"
+
+/**
+ * SECTION:phosh-notification-image
+ * @short_description: Helpers for images sent along with notifications
+ * @Title: Notification images
+ *
+ * Images sent as `image-data` hint are wrapped without copying the
+ * D-Bus payload. Since apps often send album art sized images they're
+ * then scaled down in a thread to what #PhoshNotificationContent
+ * displays.
+ */
+
+typedef struct {
+  GdkPixbuf *pixbuf;
+  int        width;
+  int        height;
+} ScaleData;
+
+
+static void
+scale_data_free (ScaleData *data)
+{
+  g_object_unref (data->pixbuf);
+  g_free (data);
+}
+
+
+/**
+ * phosh_notification_image_new_from_variant:
+ * @variant: The `(iiibiiay)` image data
+ * @max_bytes: The maximum size of the pixel data
+ * @error: Return location for error
+ *
+ * Wraps the pixel data in @variant without copying it. The pixbuf
+ * keeps @variant's data alive.
+ *
+ * Returns: (transfer full) (nullable): The image
+ */
+GdkPixbuf *
+phosh_notification_image_new_from_variant (GVariant *variant, gsize max_bytes, GError **error)
+{
+  g_autoptr (GVariant) wrapped_data = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  int width, height, row_stride, sample_size, channels;
+  gboolean has_alpha;
+  gsize size_should_be;
+
+  g_return_val_if_fail (variant, NULL);
+
+  if (!g_variant_is_of_type (variant, G_VARIANT_TYPE ("(iiibiiay)"))) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                 "Invalid image data type %s", g_variant_get_type_string (variant));
+    return NULL;
+  }
+
+  g_variant_get (variant,
+                 "(iiibii@ay)",
+                 &width,
+                 &height,
+                 &row_stride,
+                 &has_alpha,
+                 &sample_size,
+                 &channels,
+                 &wrapped_data);
+
+  /* That's all GdkPixbuf can handle */
+  if (width <= 0 || height <= 0 || sample_size != 8 ||
+      channels != (has_alpha ? 4 : 3) || row_stride < width * channels) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                 "Unsupported image %dx%d, stride %d, %d bits, %d channels",
+                 width, height, row_stride, sample_size, channels);
+    return NULL;
+  }
+
+  size_should_be = (gsize) (height - 1) * row_stride + (gsize) width * channels;
+  if (size_should_be != g_variant_get_size (wrapped_data)) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                 "Rejecting image, %" G_GSIZE_FORMAT " (expected) != %" G_GSIZE_FORMAT,
+                 size_should_be, g_variant_get_size (wrapped_data));
+    return NULL;
+  }
+
+  if (size_should_be > max_bytes) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+                 "Rejecting image, %" G_GSIZE_FORMAT " bytes exceeds limit of %" G_GSIZE_FORMAT,
+                 size_should_be, max_bytes);
+    return NULL;
+  }
+
+  bytes = g_variant_get_data_as_bytes (wrapped_data);
+  return gdk_pixbuf_new_from_bytes (bytes,
+                                    GDK_COLORSPACE_RGB,
+                                    has_alpha,
+                                    sample_size,
+                                    width,
+                                    height,
+                                    row_stride);
+}
+
+
+/**
+ * phosh_notification_image_get_bytes:
+ * @pixbuf: The image
+ *
+ * Returns: The amount of memory used by @pixbuf's pixel data
+ */
+gsize
+phosh_notification_image_get_bytes (GdkPixbuf *pixbuf)
+{
+  g_return_val_if_fail (GDK_IS_PIXBUF (pixbuf), 0);
+
+  return gdk_pixbuf_get_byte_length (pixbuf);
+}
+
+
+/**
+ * phosh_notification_image_get_max_size:
+ *
+ * Returns: The largest size in pixels an image is displayed at, that
+ * is #PhoshNotificationContent's image size on the monitor with the
+ * highest scale.
+ */
+int
+phosh_notification_image_get_max_size (void)
+{
+  GdkDisplay *display = gdk_display_get_default ();
+  int scale = 1;
+
+  for (int i = 0; display && i < gdk_display_get_n_monitors (display); i++) {
+    GdkMonitor *monitor = gdk_display_get_monitor (display, i);
+
+    scale = MAX (scale, gdk_monitor_get_scale_factor (monitor));
+  }
+
+  return PHOSH_NOTIFICATION_CONTENT_IMAGE_SIZE * scale;
+}
+
+
+/**
+ * phosh_notification_image_scale_to_fit:
+ * @width: The image's width
+ * @height: The image's height
+ * @max_size: The maximum width and height
+ * @scaled_width: (out): The scaled width
+ * @scaled_height: (out): The scaled height
+ *
+ * Calculates the size to fit an image into @max_size by @max_size
+ * keeping the aspect ratio. Images are never scaled up.
+ */
+void
+phosh_notification_image_scale_to_fit (int  width,
+                                       int  height,
+                                       int  max_size,
+                                       int *scaled_width,
+                                       int *scaled_height)
+{
+  g_return_if_fail (scaled_width && scaled_height);
+
+  if (width <= max_size && height <= max_size) {
+    *scaled_width = width;
+    *scaled_height = height;
+  } else if (width >= height) {
+    *scaled_width = max_size;
+    *scaled_height = MAX (1, (gint64) height * max_size / width);
+  } else {
+    *scaled_width = MAX (1, (gint64) width * max_size / height);
+    *scaled_height = max_size;
+  }
+}
+
+
+static void
+scale_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+  ScaleData *data = task_data;
+  GdkPixbuf *scaled;
+
+  scaled = gdk_pixbuf_scale_simple (data->pixbuf, data->width, data->height,
+                                    GDK_INTERP_BILINEAR);
+  if (scaled == NULL) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                             "Failed to scale image to %dx%d", data->width, data->height);
+    return;
+  }
+
+  g_task_return_pointer (task, scaled, g_object_unref);
+}
+
+
+/**
+ * phosh_notification_image_scale_async:
+ * @pixbuf: The image to scale
+ * @max_size: The maximum width and height
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: The callback to invoke when done
+ * @user_data: The data for @callback
+ *
+ * Scales @pixbuf down to fit into @max_size by @max_size in a
+ * thread. Images that already fit are returned as is.
+ */
+void
+phosh_notification_image_scale_async (GdkPixbuf           *pixbuf,
+                                      int                  max_size,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data)
+{
+  g_autoptr (GTask) task = NULL;
+  ScaleData *data;
+  int width, height;
+
+  g_return_if_fail (GDK_IS_PIXBUF (pixbuf));
+  g_return_if_fail (max_size > 0);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, phosh_notification_image_scale_async);
+
+  phosh_notification_image_scale_to_fit (gdk_pixbuf_get_width (pixbuf),
+                                         gdk_pixbuf_get_height (pixbuf),
+                                         max_size, &width, &height);
+
+  if (width == gdk_pixbuf_get_width (pixbuf) && height == gdk_pixbuf_get_height (pixbuf)) {
+    g_task_return_pointer (task, g_object_ref (pixbuf), g_object_unref);
+    return;
+  }
+
+  data = g_new0 (ScaleData, 1);
+  data->pixbuf = g_object_ref (pixbuf);
+  data->width = width;
+  data->height = height;
+  g_task_set_task_data (task, data, (GDestroyNotify) scale_data_free);
+  g_task_run_in_thread (task, scale_thread);
+}
+
+
+/**
+ * phosh_notification_image_scale_finish:
+ * @res: The #GAsyncResult
+ * @error: Return location for error
+ *
+ * Returns: (transfer full) (nullable): The scaled image
+ */
+GdkPixbuf *
+phosh_notification_image_scale_finish (GAsyncResult *res, GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, NULL), NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
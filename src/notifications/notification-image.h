@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+GdkPixbuf *phosh_notification_image_new_from_variant (GVariant            *variant,
+                                                      gsize                max_bytes,
+                                                      GError             **error);
+gsize      phosh_notification_image_get_bytes        (GdkPixbuf           *pixbuf);
+int        phosh_notification_image_get_max_size     (void);
+void       phosh_notification_image_scale_to_fit     (int                  width,
+                                                      int                  height,
+                                                      int                  max_size,
+                                                      int                 *scaled_width,
+                                                      int                 *scaled_height);
+void       phosh_notification_image_scale_async      (GdkPixbuf           *pixbuf,
+                                                      int                  max_size,
+                                                      GCancellable        *cancellable,
+                                                      GAsyncReadyCallback  callback,
+                                                      gpointer             user_data);
+GdkPixbuf *phosh_notification_image_scale_finish     (GAsyncResult        *res,
+                                                      GError             **error);
+
+G_END_DECLS
@@ -0,0 +1,653 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#define G_LOG_DOMAIN "phosh-notification-store"
+
+#include "notification-image.h"
+#include "notification-store.h"
+
+#include <gtk/gtk.h>
+
+/**
+ * SECTION:phosh-notification-store
+ * @short_description: A bounded store for notifications grouped by app
+ * @Title: PhoshNotificationStore
+ *
+ * Keeps notifications around until they're closed. The store is a
+ * #GListModel of per app #GListModel<!-- -->s of #PhoshNotification
+ * suitable for phosh_notification_frame_bind_model().
+ *
+ * Each app can have at most #PhoshNotificationStore:max-per-app
+ * notifications and all apps together at most
+ * #PhoshNotificationStore:max-notifications. When that's exceeded the
+ * least recently added or updated notification is closed with
+ * %PHOSH_NOTIFICATION_REASON_EXPIRED, so a noisy app can't make us
+ * grow without bounds. #PhoshNotificationStore:size estimates the
+ * memory held by the stored notifications.
+ */
+
+enum {
+  PROP_0,
+  PROP_MAX_PER_APP,
+  PROP_MAX_NOTIFICATIONS,
+  PROP_N_NOTIFICATIONS,
+  PROP_SIZE,
+  LAST_PROP
+};
+static GParamSpec *props[LAST_PROP];
+
+typedef struct {
+  PhoshNotificationStore *store;
+  PhoshNotification      *notification;
+  GListStore             *group;
+  gsize                   size;
+  gulong                  notify_id;
+  GList                   link;
+} StoreEntry;
+
+struct _PhoshNotificationStore {
+  GObject     parent;
+
+  guint       max_per_app;
+  guint       max_notifications;
+
+  GHashTable *entries;        /* id → StoreEntry */
+  GQueue      lru;            /* most recently used first */
+  GListStore *groups;         /* GListStore per app */
+  GHashTable *groups_by_app;  /* app name → GListStore */
+  guint64     size;
+  guint       n_evicted;
+};
+
+static void list_iface_init (GListModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (PhoshNotificationStore, phosh_notification_store, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, list_iface_init))
+
+
+static void
+store_entry_free (StoreEntry *entry)
+{
+  g_signal_handler_disconnect (entry->notification, entry->notify_id);
+  g_object_unref (entry->notification);
+  g_free (entry);
+}
+
+
+static const char *
+get_app_key (PhoshNotification *notification)
+{
+  const char *app_name = phosh_notification_get_app_name (notification);
+
+  return app_name ?: "";
+}
+
+
+/* An estimate of the memory held by @notification */
+static gsize
+get_notification_size (PhoshNotification *notification)
+{
+  GStrv actions = phosh_notification_get_actions (notification);
+  GIcon *image = phosh_notification_get_image (notification);
+  gsize size = 0;
+
+  size += strlen (phosh_notification_get_app_name (notification) ?: "");
+  size += strlen (phosh_notification_get_summary (notification) ?: "");
+  size += strlen (phosh_notification_get_body (notification) ?: "");
+
+  for (int i = 0; actions && actions[i]; i++)
+    size += strlen (actions[i]) + sizeof (char *);
+
+  if (GDK_IS_PIXBUF (image))
+    size += phosh_notification_image_get_bytes (GDK_PIXBUF (image));
+
+  return size;
+}
+
+
+static gboolean
+find_position (GListModel *model, gpointer item, guint *position)
+{
+  guint n_items = g_list_model_get_n_items (model);
+
+  for (guint i = 0; i < n_items; i++) {
+    g_autoptr (GObject) other = g_list_model_get_item (model, i);
+
+    if (other == item) {
+      *position = i;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+
+static GListStore *
+get_group (PhoshNotificationStore *self, const char *app_key)
+{
+  GListStore *group = g_hash_table_lookup (self->groups_by_app, app_key);
+
+  if (group)
+    return group;
+
+  group = g_list_store_new (PHOSH_TYPE_NOTIFICATION);
+  g_hash_table_insert (self->groups_by_app, g_strdup (app_key), group);
+  g_list_store_append (self->groups, group);
+
+  return group;
+}
+
+
+static gboolean
+is_group (gpointer key, gpointer value, gpointer user_data)
+{
+  return value == user_data;
+}
+
+
+static void
+remove_from_group (PhoshNotificationStore *self, StoreEntry *entry)
+{
+  GListStore *group = entry->group;
+  guint pos;
+
+  entry->group = NULL;
+  if (!find_position (G_LIST_MODEL (group), entry->notification, &pos))
+    g_return_if_reached ();
+
+  g_list_store_remove (group, pos);
+  if (g_list_model_get_n_items (G_LIST_MODEL (group)))
+    return;
+
+  /* Last notification of that app, the app name might have changed
+     meanwhile so look up the group by value */
+  if (find_position (G_LIST_MODEL (self->groups), group, &pos))
+    g_list_store_remove (self->groups, pos);
+  g_hash_table_foreach_remove (self->groups_by_app, is_group, group);
+}
+
+
+static void
+add_to_group (PhoshNotificationStore *self, StoreEntry *entry)
+{
+  entry->group = get_group (self, get_app_key (entry->notification));
+  g_list_store_append (entry->group, entry->notification);
+}
+
+
+static void
+expire_entry (PhoshNotificationStore *self, StoreEntry *entry)
+{
+  g_autoptr (PhoshNotification) notification = g_object_ref (entry->notification);
+
+  g_debug ("Evicting notification %u of '%s'",
+           phosh_notification_get_id (notification),
+           get_app_key (notification));
+  self->n_evicted++;
+
+  /* Listeners drop it from the store themselves and tell the sender,
+     in case nobody does we remove it here */
+  phosh_notification_close (notification, PHOSH_NOTIFICATION_REASON_EXPIRED);
+  phosh_notification_store_remove (self, notification);
+}
+
+
+static StoreEntry *
+find_lru_in_group (PhoshNotificationStore *self, GListStore *group)
+{
+  for (GList *l = self->lru.tail; l; l = l->prev) {
+    StoreEntry *entry = l->data;
+
+    if (entry->group == group)
+      return entry;
+  }
+
+  g_return_val_if_reached (NULL);
+}
+
+
+static void
+evict_group (PhoshNotificationStore *self, GListStore *group)
+{
+  while (g_list_model_get_n_items (G_LIST_MODEL (group)) > self->max_per_app) {
+    StoreEntry *entry = find_lru_in_group (self, group);
+
+    if (entry == NULL)
+      break;
+    expire_entry (self, entry);
+  }
+}
+
+
+static void
+evict (PhoshNotificationStore *self)
+{
+  guint n_groups = g_list_model_get_n_items (G_LIST_MODEL (self->groups));
+
+  /* Groups over the limit keep at least one notification so don't go away */
+  for (guint i = 0; i < n_groups; i++) {
+    g_autoptr (GListStore) group = g_list_model_get_item (G_LIST_MODEL (self->groups), i);
+
+    evict_group (self, group);
+  }
+
+  while (g_hash_table_size (self->entries) > self->max_notifications && self->lru.tail)
+    expire_entry (self, self->lru.tail->data);
+}
+
+
+static void
+on_notification_notify (StoreEntry *entry, GParamSpec *pspec)
+{
+  PhoshNotificationStore *self = entry->store;
+  gsize size;
+
+  /* Updated notifications are used again */
+  g_queue_unlink (&self->lru, &entry->link);
+  g_queue_push_head_link (&self->lru, &entry->link);
+
+  if (g_strcmp0 (g_param_spec_get_name (pspec), "app-name") == 0) {
+    const char *app_key = get_app_key (entry->notification);
+
+    if (g_hash_table_lookup (self->groups_by_app, app_key) != entry->group) {
+      g_autoptr (GListStore) group = NULL;
+
+      remove_from_group (self, entry);
+      add_to_group (self, entry);
+      group = g_object_ref (entry->group);
+      evict_group (self, group);
+    }
+  }
+
+  size = get_notification_size (entry->notification);
+  if (size == entry->size)
+    return;
+
+  self->size -= entry->size;
+  entry->size = size;
+  self->size += entry->size;
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_SIZE]);
+}
+
+
+static void
+phosh_notification_store_set_property (GObject      *object,
+                                       guint         property_id,
+                                       const GValue *value,
+                                       GParamSpec   *pspec)
+{
+  PhoshNotificationStore *self = PHOSH_NOTIFICATION_STORE (object);
+
+  switch (property_id) {
+  case PROP_MAX_PER_APP:
+    self->max_per_app = g_value_get_uint (value);
+    evict (self);
+    break;
+  case PROP_MAX_NOTIFICATIONS:
+    self->max_notifications = g_value_get_uint (value);
+    evict (self);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
+}
+
+
+static void
+phosh_notification_store_get_property (GObject    *object,
+                                       guint       property_id,
+                                       GValue     *value,
+                                       GParamSpec *pspec)
+{
+  PhoshNotificationStore *self = PHOSH_NOTIFICATION_STORE (object);
+
+  switch (property_id) {
+  case PROP_MAX_PER_APP:
+    g_value_set_uint (value, self->max_per_app);
+    break;
+  case PROP_MAX_NOTIFICATIONS:
+    g_value_set_uint (value, self->max_notifications);
+    break;
+  case PROP_N_NOTIFICATIONS:
+    g_value_set_uint (value, g_hash_table_size (self->entries));
+    break;
+  case PROP_SIZE:
+    g_value_set_uint64 (value, self->size);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
+}
+
+
+static void
+on_groups_changed (PhoshNotificationStore *self,
+                   guint                   position,
+                   guint                   removed,
+                   guint                   added,
+                   GListModel             *groups)
+{
+  g_list_model_items_changed (G_LIST_MODEL (self), position, removed, added);
+}
+
+
+static void
+phosh_notification_store_dispose (GObject *object)
+{
+  PhoshNotificationStore *self = PHOSH_NOTIFICATION_STORE (object);
+
+  g_queue_init (&self->lru);
+  g_clear_pointer (&self->entries, g_hash_table_destroy);
+  g_clear_pointer (&self->groups_by_app, g_hash_table_destroy);
+  g_clear_object (&self->groups);
+
+  G_OBJECT_CLASS (phosh_notification_store_parent_class)->dispose (object);
+}
+
+
+static void
+phosh_notification_store_class_init (PhoshNotificationStoreClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = phosh_notification_store_dispose;
+  object_class->set_property = phosh_notification_store_set_property;
+  object_class->get_property = phosh_notification_store_get_property;
+
+  /**
+   * PhoshNotificationStore:max-per-app:
+   *
+   * The maximum number of notifications kept per app
+   */
+  props[PROP_MAX_PER_APP] =
+    g_param_spec_uint ("max-per-app",
+                       "Max per app",
+                       "Maximum number of notifications per app",
+                       1, G_MAXUINT, 20,
+                       G_PARAM_READWRITE | G_PARAM_CONSTRUCT |
+                       G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  /**
+   * PhoshNotificationStore:max-notifications:
+   *
+   * The maximum number of notifications kept for all apps together
+   */
+  props[PROP_MAX_NOTIFICATIONS] =
+    g_param_spec_uint ("max-notifications",
+                       "Max notifications",
+                       "Maximum number of notifications",
+                       1, G_MAXUINT, 100,
+                       G_PARAM_READWRITE | G_PARAM_CONSTRUCT |
+                       G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  /**
+   * PhoshNotificationStore:n-notifications:
+   *
+   * The number of stored notifications
+   */
+  props[PROP_N_NOTIFICATIONS] =
+    g_param_spec_uint ("n-notifications",
+                       "Number of notifications",
+                       "The number of stored notifications",
+                       0, G_MAXUINT, 0,
+                       G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  /**
+   * PhoshNotificationStore:size:
+   *
+   * Estimate of the memory in bytes held by the stored notifications'
+   * texts, actions and images
+   */
+  props[PROP_SIZE] =
+    g_param_spec_uint64 ("size",
+                         "Size",
+                         "Estimated memory used by the notifications",
+                         0, G_MAXUINT64, 0,
+                         G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, LAST_PROP, props);
+}
+
+
+static GType
+list_get_item_type (GListModel *list)
+{
+  return G_TYPE_LIST_MODEL;
+}
+
+
+static gpointer
+list_get_item (GListModel *list, guint position)
+{
+  PhoshNotificationStore *self = PHOSH_NOTIFICATION_STORE (list);
+
+  return g_list_model_get_item (G_LIST_MODEL (self->groups), position);
+}
+
+
+static guint
+list_get_n_items (GListModel *list)
+{
+  PhoshNotificationStore *self = PHOSH_NOTIFICATION_STORE (list);
+
+  return g_list_model_get_n_items (G_LIST_MODEL (self->groups));
+}
+
+
+static void
+list_iface_init (GListModelInterface *iface)
+{
+  iface->get_item_type = list_get_item_type;
+  iface->get_item = list_get_item;
+  iface->get_n_items = list_get_n_items;
+}
+
+
+static void
+phosh_notification_store_init (PhoshNotificationStore *self)
+{
+  self->entries = g_hash_table_new_full (g_direct_hash,
+                                         g_direct_equal,
+                                         NULL,
+                                         (GDestroyNotify) store_entry_free);
+  self->groups_by_app = g_hash_table_new_full (g_str_hash,
+                                               g_str_equal,
+                                               g_free,
+                                               g_object_unref);
+  self->groups = g_list_store_new (G_TYPE_LIST_MODEL);
+  g_signal_connect_object (self->groups, "items-changed",
+                           G_CALLBACK (on_groups_changed),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_queue_init (&self->lru);
+}
+
+
+/**
+ * phosh_notification_store_new:
+ * @max_per_app: The maximum number of notifications per app
+ * @max_notifications: The maximum number of notifications
+ *
+ * Returns: A new #PhoshNotificationStore
+ */
+PhoshNotificationStore *
+phosh_notification_store_new (guint max_per_app, guint max_notifications)
+{
+  return g_object_new (PHOSH_TYPE_NOTIFICATION_STORE,
+                       "max-per-app", max_per_app,
+                       "max-notifications", max_notifications,
+                       NULL);
+}
+
+
+/**
+ * phosh_notification_store_add:
+ * @self: The #PhoshNotificationStore
+ * @notification: The notification to add
+ *
+ * Adds @notification to the group of its app. Adding a notification
+ * that is already stored marks it as recently used. This can close
+ * older notifications to stay within the store's limits.
+ */
+void
+phosh_notification_store_add (PhoshNotificationStore *self,
+                              PhoshNotification      *notification)
+{
+  guint id;
+  StoreEntry *entry;
+  g_autoptr (GListStore) group = NULL;
+
+  g_return_if_fail (PHOSH_IS_NOTIFICATION_STORE (self));
+  g_return_if_fail (PHOSH_IS_NOTIFICATION (notification));
+  id = phosh_notification_get_id (notification);
+  g_return_if_fail (id);
+
+  entry = g_hash_table_lookup (self->entries, GUINT_TO_POINTER (id));
+  if (entry) {
+    g_return_if_fail (entry->notification == notification);
+    g_queue_unlink (&self->lru, &entry->link);
+    g_queue_push_head_link (&self->lru, &entry->link);
+    return;
+  }
+
+  entry = g_new0 (StoreEntry, 1);
+  entry->store = self;
+  entry->notification = g_object_ref (notification);
+  entry->size = get_notification_size (notification);
+  entry->link.data = entry;
+  entry->notify_id = g_signal_connect_swapped (notification, "notify",
+                                               G_CALLBACK (on_notification_notify),
+                                               entry);
+
+  g_hash_table_insert (self->entries, GUINT_TO_POINTER (id), entry);
+  g_queue_push_head_link (&self->lru, &entry->link);
+  self->size += entry->size;
+  add_to_group (self, entry);
+
+  group = g_object_ref (entry->group);
+  evict_group (self, group);
+  evict (self);
+
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_N_NOTIFICATIONS]);
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_SIZE]);
+}
+
+
+/**
+ * phosh_notification_store_remove:
+ * @self: The #PhoshNotificationStore
+ * @notification: The notification to remove
+ *
+ * Removes @notification from the store without closing it.
+ *
+ * Returns: %TRUE if @notification was stored
+ */
+gboolean
+phosh_notification_store_remove (PhoshNotificationStore *self,
+                                 PhoshNotification      *notification)
+{
+  guint id;
+  StoreEntry *entry;
+
+  g_return_val_if_fail (PHOSH_IS_NOTIFICATION_STORE (self), FALSE);
+  g_return_val_if_fail (PHOSH_IS_NOTIFICATION (notification), FALSE);
+
+  id = phosh_notification_get_id (notification);
+  entry = g_hash_table_lookup (self->entries, GUINT_TO_POINTER (id));
+  if (entry == NULL || entry->notification != notification)
+    return FALSE;
+
+  g_queue_unlink (&self->lru, &entry->link);
+  self->size -= entry->size;
+  remove_from_group (self, entry);
+  g_hash_table_remove (self->entries, GUINT_TO_POINTER (id));
+
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_N_NOTIFICATIONS]);
+  g_object_notify_by_pspec (G_OBJECT (self), props[PROP_SIZE]);
+
+  return TRUE;
+}
+
+
+/**
+ * phosh_notification_store_lookup:
+ * @self: The #PhoshNotificationStore
+ * @id: The notification's id
+ *
+ * Returns: (transfer none) (nullable): The notification with @id
+ */
+PhoshNotification *
+phosh_notification_store_lookup (PhoshNotificationStore *self, guint id)
+{
+  StoreEntry *entry;
+
+  g_return_val_if_fail (PHOSH_IS_NOTIFICATION_STORE (self), NULL);
+
+  entry = g_hash_table_lookup (self->entries, GUINT_TO_POINTER (id));
+  return entry ? entry->notification : NULL;
+}
+
+
+/**
+ * phosh_notification_store_get_app_model:
+ * @self: The #PhoshNotificationStore
+ * @app_name: (nullable): The app's name
+ *
+ * Returns: (transfer none) (nullable): The notifications of @app_name
+ * oldest first or %NULL if there are none
+ */
+GListModel *
+phosh_notification_store_get_app_model (PhoshNotificationStore *self,
+                                        const char             *app_name)
+{
+  g_return_val_if_fail (PHOSH_IS_NOTIFICATION_STORE (self), NULL);
+
+  return g_hash_table_lookup (self->groups_by_app, app_name ?: "");
+}
+
+
+/**
+ * phosh_notification_store_get_n_notifications:
+ * @self: The #PhoshNotificationStore
+ *
+ * Returns: The number of stored notifications
+ */
+guint
+phosh_notification_store_get_n_notifications (PhoshNotificationStore *self)
+{
+  g_return_val_if_fail (PHOSH_IS_NOTIFICATION_STORE (self), 0);
+
+  return g_hash_table_size (self->entries);
+}
+
+
+/**
+ * phosh_notification_store_get_size:
+ * @self: The #PhoshNotificationStore
+ *
+ * Returns: The estimated memory used by the stored notifications in bytes
+ */
+guint64
+phosh_notification_store_get_size (PhoshNotificationStore *self)
+{
+  g_return_val_if_fail (PHOSH_IS_NOTIFICATION_STORE (self), 0);
+
+  return self->size;
+}
+
+
+/**
+ * phosh_notification_store_get_n_evicted:
+ * @self: The #PhoshNotificationStore
+ *
+ * Returns: How many notifications were closed to stay within the limits
+ */
+guint
+phosh_notification_store_get_n_evicted (PhoshNotificationStore *self)
+{
+  g_return_val_if_fail (PHOSH_IS_NOTIFICATION_STORE (self), 0);
+
+  return self->n_evicted;
+}
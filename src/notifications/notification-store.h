@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#pragma once
+
+#include "notification.h"
+
+G_BEGIN_DECLS
+
+#define PHOSH_TYPE_NOTIFICATION_STORE (phosh_notification_store_get_type ())
+
+G_DECLARE_FINAL_TYPE (PhoshNotificationStore,
+                      phosh_notification_store,
+                      PHOSH,
+                      NOTIFICATION_STORE,
+                      GObject)
+
+PhoshNotificationStore *phosh_notification_store_new                 (guint                   max_per_app,
+                                                                      guint                   max_notifications);
+void                    phosh_notification_store_add                 (PhoshNotificationStore *self,
+                                                                      PhoshNotification      *notification);
+gboolean                phosh_notification_store_remove              (PhoshNotificationStore *self,
+                                                                      PhoshNotification      *notification);
+PhoshNotification      *phosh_notification_store_lookup              (PhoshNotificationStore *self,
+                                                                      guint                   id);
+GListModel             *phosh_notification_store_get_app_model       (PhoshNotificationStore *self,
+                                                                      const char             *app_name);
+guint                   phosh_notification_store_get_n_notifications (PhoshNotificationStore *self);
+guint64                 phosh_notification_store_get_size            (PhoshNotificationStore *self);
+guint                   phosh_notification_store_get_n_evicted       (PhoshNotificationStore *self);
+
+G_END_DECLS
@@ -8,9 +8,10 @@
 
 #include "../config.h"
 
-#include <gio/gdesktopappinfo.h>
-
+#include "app-list-model.h"
 #include "notification-banner.h"
+#include "notification-image.h"
+#include "notification-store.h"
 #include "notify-manager.h"
 #include "shell.h"
 #include "phosh-enums.h"
@@ -21,11 +22,49 @@
 #define NOTIFICATIONS_SCHEMA_ID "org.gnome.desktop.notifications"
 #define NOTIFICATIONS_KEY_SHOW_BANNERS "show-banners"
 
+/* Banners per app within BANNER_RATE_INTERVAL */
+#define BANNER_RATE_MAX 5
+#define BANNER_RATE_INTERVAL (10 * G_USEC_PER_SEC)
+/* Queued notifications replace the shown banner after that long */
+#define BANNER_DISPLAY_TIME 5000 /* ms */
+
+/* Larger image-data payloads are rejected right away */
+#define NOTIFICATION_IMAGE_MAX_INPUT_BYTES (32 * 1024 * 1024)
+/* Budget for a single notification's scaled image */
+#define NOTIFICATION_IMAGE_MAX_BYTES (256 * 1024)
+/* Budget for the images of all notifications */
+#define NOTIFICATION_IMAGES_MAX_BYTES (8 * 1024 * 1024)
+
+/* Notifications kept until closed */
+#define NOTIFICATIONS_MAX_PER_APP 20
+#define NOTIFICATIONS_MAX 100
+
 /**
  * SECTION:phosh-notify-manager
  * @short_description: Provides the org.freedesktop.Notification DBus interface
  * @Title: PhoshNotifyManager
  * See https://developer.gnome.org/notification-spec/
+ *
+ * Banners are shown one at a time using a single #PhoshNotificationBanner.
+ * Notifications arriving while a banner is up are queued. The next
+ * queued notification replaces the shown one once that expired, got
+ * closed or was shown for %BANNER_DISPLAY_TIME so notifications that
+ * never expire don't hold up the queue. Expiry of queued notifications
+ * starts once they're shown. Notifications of the same app are folded
+ * into the shown banner. Each app can only get %BANNER_RATE_MAX banners
+ * per %BANNER_RATE_INTERVAL, further notifications don't get a banner
+ * so a misbehaving client can't make us map and unmap surfaces in a
+ * tight loop.
+ *
+ * Images sent as image data are scaled down to the displayed size off
+ * the main thread. Each scaled image must fit into
+ * %NOTIFICATION_IMAGE_MAX_BYTES and all of them together into
+ * %NOTIFICATION_IMAGES_MAX_BYTES, images exceeding that are dropped.
+ *
+ * Notifications are kept in a #PhoshNotificationStore grouped by app
+ * until closed. Once an app has more than %NOTIFICATIONS_MAX_PER_APP
+ * or all apps together more than %NOTIFICATIONS_MAX the oldest ones
+ * are closed as expired.
  */
 
 #define NOTIFY_DBUS_NAME "org.freedesktop.Notifications"
@@ -33,6 +72,21 @@
 static void phosh_notify_manager_notify_iface_init (
   PhoshNotifyDbusNotificationsIface *iface);
 
+typedef struct {
+  PhoshNotification *notification;
+  int                expire_timeout;
+} BannerItem;
+
+typedef struct {
+  gint64 start;
+  guint  count;
+} BannerRate;
+
+typedef struct {
+  PhoshNotifyManager *self;
+  guint               id;
+} ImageJob;
+
 typedef struct _PhoshNotifyManager
 {
   PhoshNotifyDbusNotificationsSkeleton parent;
@@ -41,8 +95,18 @@ typedef struct _PhoshNotifyManager
   guint next_id;
   gboolean show_banners;
 
-  GHashTable *notifications;
+  PhoshNotificationStore *store;
   GSettings *settings;
+
+  GtkWidget  *banner;
+  guint       banner_timeout_id; /* 0 once the shown banner had its time */
+  GQueue      banner_queue;   /* BannerItem */
+  GHashTable *banner_rates;   /* app name → BannerRate */
+  gint64      banner_rates_pruned;
+
+  GHashTable *image_jobs;     /* id → GCancellable of the scaling image */
+  GHashTable *image_bytes;    /* id → size of the notification's image */
+  gsize       images_size;
 } PhoshNotifyManager;
 
 G_DEFINE_TYPE_WITH_CODE (PhoshNotifyManager,
@@ -52,6 +116,8 @@ G_DEFINE_TYPE_WITH_CODE (PhoshNotifyManager,
                            PHOSH_NOTIFY_DBUS_TYPE_NOTIFICATIONS,
                            phosh_notify_manager_notify_iface_init));
 
+static void drop_image (PhoshNotifyManager *self, guint id);
+
 static void
 phosh_notify_manager_set_property (GObject *object,
                                          guint property_id,
@@ -91,8 +157,7 @@ handle_close_notification (PhoshNotifyDbusNotifications *skeleton,
   g_return_val_if_fail (PHOSH_IS_NOTIFY_MANAGER (self), FALSE);
   g_debug ("DBus call CloseNotification %u", arg_id);
 
-  notification = g_hash_table_lookup (self->notifications,
-                                      GUINT_TO_POINTER (arg_id));
+  notification = phosh_notification_store_lookup (self->store, arg_id);
 
   /*
    * ignore errors when closing non-existent notifcation, at least qt 5.11 is not
@@ -140,6 +205,270 @@ handle_get_server_information (PhoshNotifyDbusNotifications *skeleton,
 }
 
 
+static void
+banner_item_free (BannerItem *item)
+{
+  g_object_unref (item->notification);
+  g_free (item);
+}
+
+
+static void
+start_expiry (PhoshNotification *notification, int expire_timeout)
+{
+  if (expire_timeout)
+    phosh_notification_expires (notification, expire_timeout);
+}
+
+
+static gboolean
+same_app (PhoshNotification *a, PhoshNotification *b)
+{
+  return g_strcmp0 (phosh_notification_get_app_name (a),
+                    phosh_notification_get_app_name (b)) == 0;
+}
+
+
+static void
+remove_from_banner_queue (PhoshNotifyManager *self,
+                          PhoshNotification  *notification)
+{
+  for (GList *l = self->banner_queue.head; l; l = l->next) {
+    BannerItem *item = l->data;
+
+    if (item->notification == notification) {
+      g_queue_delete_link (&self->banner_queue, l);
+      banner_item_free (item);
+      return;
+    }
+  }
+}
+
+
+static void
+clear_banner_queue (PhoshNotifyManager *self)
+{
+  BannerItem *item;
+
+  /* Notifications that never got their banner still need to expire */
+  while ((item = g_queue_pop_head (&self->banner_queue))) {
+    start_expiry (item->notification, item->expire_timeout);
+    banner_item_free (item);
+  }
+}
+
+
+static gboolean
+banner_rate_expired (gpointer key, gpointer value, gpointer user_data)
+{
+  BannerRate *rate = value;
+  gint64 now = *(gint64 *) user_data;
+
+  return now - rate->start > BANNER_RATE_INTERVAL;
+}
+
+
+static gboolean
+banner_rate_limited (PhoshNotifyManager *self,
+                     PhoshNotification  *notification)
+{
+  const char *app_name = phosh_notification_get_app_name (notification);
+  gint64 now = g_get_monotonic_time ();
+  BannerRate *rate;
+
+  if (app_name == NULL)
+    app_name = "";
+
+  /* Forget about apps that were quiet for a while */
+  if (now - self->banner_rates_pruned > BANNER_RATE_INTERVAL) {
+    g_hash_table_foreach_remove (self->banner_rates, banner_rate_expired, &now);
+    self->banner_rates_pruned = now;
+  }
+
+  rate = g_hash_table_lookup (self->banner_rates, app_name);
+  if (rate == NULL) {
+    rate = g_new0 (BannerRate, 1);
+    g_hash_table_insert (self->banner_rates, g_strdup (app_name), rate);
+  }
+
+  if (now - rate->start > BANNER_RATE_INTERVAL) {
+    rate->start = now;
+    rate->count = 0;
+  }
+
+  if (rate->count >= BANNER_RATE_MAX)
+    return TRUE;
+
+  rate->count++;
+  return FALSE;
+}
+
+
+static gboolean on_banner_display_timeout (gpointer user_data);
+
+static void
+restart_banner_timeout (PhoshNotifyManager *self)
+{
+  g_clear_handle_id (&self->banner_timeout_id, g_source_remove);
+  self->banner_timeout_id = g_timeout_add (BANNER_DISPLAY_TIME,
+                                           on_banner_display_timeout,
+                                           self);
+}
+
+
+/* Moves the next queued notification into the banner */
+static gboolean
+advance_banner (PhoshNotifyManager *self)
+{
+  PhoshNotificationBanner *banner = PHOSH_NOTIFICATION_BANNER (self->banner);
+  BannerItem *item;
+  guint coalesced = 0;
+  GList *l;
+
+  item = g_queue_pop_head (&self->banner_queue);
+  if (item == NULL)
+    return FALSE;
+
+  /* Fold further queued notifications of that app into one banner showing
+     the latest of them */
+  l = self->banner_queue.head;
+  while (l) {
+    GList *next = l->next;
+    BannerItem *other = l->data;
+
+    if (same_app (item->notification, other->notification)) {
+      g_queue_delete_link (&self->banner_queue, l);
+      start_expiry (item->notification, item->expire_timeout);
+      banner_item_free (item);
+      item = other;
+      coalesced++;
+    }
+    l = next;
+  }
+
+  g_debug ("Reusing banner for notification %u, %u coalesced",
+           phosh_notification_get_id (item->notification), coalesced);
+
+  phosh_notification_banner_set_notification (banner, item->notification);
+  phosh_notification_banner_set_coalesced (banner, coalesced);
+  start_expiry (item->notification, item->expire_timeout);
+  banner_item_free (item);
+
+  restart_banner_timeout (self);
+  return TRUE;
+}
+
+
+static gboolean
+on_banner_display_timeout (gpointer user_data)
+{
+  PhoshNotifyManager *self = PHOSH_NOTIFY_MANAGER (user_data);
+
+  self->banner_timeout_id = 0;
+  /* With nothing queued the banner stays until its notification is done */
+  advance_banner (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+static void
+on_banner_notification_done (PhoshNotifyManager      *self,
+                             PhoshNotification       *done,
+                             PhoshNotificationBanner *banner)
+{
+  g_return_if_fail (PHOSH_IS_NOTIFY_MANAGER (self));
+  g_return_if_fail (PHOSH_IS_NOTIFICATION_BANNER (banner));
+
+  g_clear_handle_id (&self->banner_timeout_id, g_source_remove);
+  /* Nothing left, the banner goes away */
+  advance_banner (self);
+}
+
+
+static void
+on_banner_destroyed (PhoshNotifyManager *self)
+{
+  g_return_if_fail (PHOSH_IS_NOTIFY_MANAGER (self));
+
+  self->banner = NULL;
+  g_clear_handle_id (&self->banner_timeout_id, g_source_remove);
+  clear_banner_queue (self);
+}
+
+
+static GtkWidget *
+create_banner (PhoshNotifyManager *self, PhoshNotification *notification)
+{
+  GtkWidget *banner = phosh_notification_banner_new (notification);
+
+  g_signal_connect_object (banner,
+                           "notification-done",
+                           G_CALLBACK (on_banner_notification_done),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_signal_connect_object (banner,
+                           "destroy",
+                           G_CALLBACK (on_banner_destroyed),
+                           self,
+                           G_CONNECT_SWAPPED);
+  return banner;
+}
+
+
+static void
+show_banner (PhoshNotifyManager *self,
+             PhoshNotification  *notification,
+             int                 expire_timeout)
+{
+  PhoshNotificationBanner *banner;
+  PhoshNotification *shown;
+
+  if (banner_rate_limited (self, notification)) {
+    g_debug ("Not showing banner for %u, too many from '%s'",
+             phosh_notification_get_id (notification),
+             phosh_notification_get_app_name (notification));
+    start_expiry (notification, expire_timeout);
+    return;
+  }
+
+  if (self->banner) {
+    banner = PHOSH_NOTIFICATION_BANNER (self->banner);
+    shown = phosh_notification_banner_get_notification (banner);
+
+    /* Same app: fold it into the shown banner */
+    if (same_app (shown, notification)) {
+      guint coalesced = phosh_notification_banner_get_coalesced (banner);
+
+      phosh_notification_banner_set_notification (banner, notification);
+      phosh_notification_banner_set_coalesced (banner, coalesced + 1);
+      start_expiry (notification, expire_timeout);
+      restart_banner_timeout (self);
+      return;
+    }
+  }
+
+  if (self->banner) {
+    BannerItem *item = g_new0 (BannerItem, 1);
+
+    /* Expiry starts once the banner is shown */
+    item->notification = g_object_ref (notification);
+    item->expire_timeout = expire_timeout;
+    g_queue_push_tail (&self->banner_queue, item);
+
+    /* The shown banner had its time already */
+    if (self->banner_timeout_id == 0)
+      advance_banner (self);
+    return;
+  }
+
+  self->banner = create_banner (self, notification);
+  gtk_widget_show (self->banner);
+  start_expiry (notification, expire_timeout);
+  restart_banner_timeout (self);
+}
+
+
 static void
 on_notification_expired (PhoshNotifyManager *self,
                          PhoshNotification  *notification)
@@ -191,7 +520,10 @@ on_notification_closed (PhoshNotifyManager      *self,
 
   id = phosh_notification_get_id (notification);
 
-  if (!g_hash_table_remove (self->notifications, GUINT_TO_POINTER (id)))
+  remove_from_banner_queue (self, notification);
+  drop_image (self, id);
+
+  if (!phosh_notification_store_remove (self->store, notification))
     return;
 
   g_debug ("Emitting NotificationClosed: %d, %d", id, reason);
@@ -201,59 +533,112 @@ on_notification_closed (PhoshNotifyManager      *self,
 }
 
 
-static GIcon *
+static GdkPixbuf *
 parse_icon_data (GVariant *variant)
 {
-  GVariant *wrapped_data = NULL;
-  guchar *data = NULL;
-  GIcon *icon = NULL;
-  int width = 0;
-  int height = 0;
-  int row_stride = 0;
-  int has_alpha = 0;
-  int sample_size = 0;
-  int channels = 0;
-  gsize size_should_be = 0;
-
-  if (g_variant_is_of_type (variant, G_VARIANT_TYPE ("(iiibiiay)"))) {
-    g_variant_get (variant,
-                   "(iiibii@ay)",
-                   &width,
-                   &height,
-                   &row_stride,
-                   &has_alpha,
-                   &sample_size,
-                   &channels,
-                   &wrapped_data);
-
-    size_should_be = (height - 1) * row_stride + width * ((channels * sample_size + 7) / 8);
-
-    if (size_should_be != g_variant_get_size (wrapped_data)) {
-      g_warning ("Rejecting image, %" G_GSIZE_FORMAT
-                 " (expected) != %" G_GSIZE_FORMAT,
-                 size_should_be, g_variant_get_size (wrapped_data));
-
-      return NULL;
-    }
+  g_autoptr (GError) err = NULL;
+  GdkPixbuf *pixbuf;
+
+  pixbuf = phosh_notification_image_new_from_variant (variant,
+                                                      NOTIFICATION_IMAGE_MAX_INPUT_BYTES,
+                                                      &err);
+  if (pixbuf == NULL)
+    g_warning ("%s", err->message);
+
+  return pixbuf;
+}
+
+
+/* Forget about the image of notification @id and stop scaling it */
+static void
+drop_image (PhoshNotifyManager *self, guint id)
+{
+  GCancellable *cancellable;
+  gsize size;
 
-    // Extract a copy of the raw data
-    data = (guchar *) g_memdup (g_variant_get_data (wrapped_data),
-                                size_should_be);
-
-    icon = G_ICON (gdk_pixbuf_new_from_data (data,
-                                             GDK_COLORSPACE_RGB,
-                                             has_alpha,
-                                             sample_size,
-                                             width,
-                                             height,
-                                             row_stride,
-                                             (GdkPixbufDestroyNotify) g_free,
-                                             NULL));
+  cancellable = g_hash_table_lookup (self->image_jobs, GUINT_TO_POINTER (id));
+  if (cancellable) {
+    g_cancellable_cancel (cancellable);
+    g_hash_table_remove (self->image_jobs, GUINT_TO_POINTER (id));
   }
 
-  return icon;
+  size = GPOINTER_TO_SIZE (g_hash_table_lookup (self->image_bytes, GUINT_TO_POINTER (id)));
+  self->images_size -= size;
+  g_hash_table_remove (self->image_bytes, GUINT_TO_POINTER (id));
+}
+
+
+static void
+set_image (PhoshNotifyManager *self, PhoshNotification *notification, GdkPixbuf *pixbuf)
+{
+  guint id = phosh_notification_get_id (notification);
+  gsize size = phosh_notification_image_get_bytes (pixbuf);
+
+  if (size > NOTIFICATION_IMAGE_MAX_BYTES ||
+      self->images_size + size > NOTIFICATION_IMAGES_MAX_BYTES) {
+    g_debug ("Dropping image of notification %u, %" G_GSIZE_FORMAT " bytes exceed budget",
+             id, size);
+    return;
+  }
+
+  self->images_size += size;
+  g_hash_table_insert (self->image_bytes, GUINT_TO_POINTER (id), GSIZE_TO_POINTER (size));
+  g_object_set (notification, "image", pixbuf, NULL);
+}
+
+
+static void
+on_image_scaled (GObject      *source_object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+  ImageJob *job = user_data;
+  PhoshNotifyManager *self = job->self;
+  guint id = job->id;
+  PhoshNotification *notification;
+  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  g_autoptr (GError) err = NULL;
+
+  g_free (job);
+  pixbuf = phosh_notification_image_scale_finish (res, &err);
+  if (pixbuf == NULL) {
+    if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      g_warning ("Failed to scale image of notification %u: %s", id, err->message);
+      g_hash_table_remove (self->image_jobs, GUINT_TO_POINTER (id));
+    }
+    /* Cancelled jobs were dropped already and self might be gone */
+    return;
+  }
+
+  g_hash_table_remove (self->image_jobs, GUINT_TO_POINTER (id));
+
+  notification = phosh_notification_store_lookup (self->store, id);
+  g_return_if_fail (notification);
+
+  g_debug ("Scaled image of notification %u to %dx%d", id,
+           gdk_pixbuf_get_width (pixbuf), gdk_pixbuf_get_height (pixbuf));
+  set_image (self, notification, pixbuf);
+}
+
+
+/* Scales the image down to the displayed size and attaches it */
+static void
+process_image_data (PhoshNotifyManager *self, PhoshNotification *notification, GdkPixbuf *pixbuf)
+{
+  GCancellable *cancellable = g_cancellable_new ();
+  ImageJob *job = g_new0 (ImageJob, 1);
+
+  job->self = self;
+  job->id = phosh_notification_get_id (notification);
+  g_hash_table_insert (self->image_jobs, GUINT_TO_POINTER (job->id), cancellable);
+  phosh_notification_image_scale_async (pixbuf,
+                                        phosh_notification_image_get_max_size (),
+                                        cancellable,
+                                        on_image_scaled,
+                                        job);
 }
 
+
 static GIcon *
 parse_icon_string (const char *string)
 {
@@ -291,19 +676,21 @@ handle_notify (PhoshNotifyDbusNotifications *skeleton,
 {
   PhoshNotifyManager *self = PHOSH_NOTIFY_MANAGER (skeleton);
   PhoshNotification *notification = NULL;
+  g_autoptr (PhoshNotification) new_notification = NULL;
   GVariant *item;
   GVariantIter iter;
   guint id;
   g_autofree gchar *desktop_id = NULL;
   g_autoptr (GAppInfo) info = NULL;
   PhoshNotificationUrgency urgency = PHOSH_NOTIFICATION_URGENCY_NORMAL;
-  g_autoptr (GIcon) data_gicon = NULL;
+  g_autoptr (GdkPixbuf) data_pixbuf = NULL;
   g_autoptr (GIcon) path_gicon = NULL;
   g_autoptr (GIcon) app_gicon = NULL;
-  g_autoptr (GIcon) old_data_gicon = NULL;
+  g_autoptr (GdkPixbuf) old_data_pixbuf = NULL;
   g_autoptr (GIcon) fallback_gicon = NULL;
   GIcon *icon = NULL;
   GIcon *image = NULL;
+  GdkPixbuf *image_data = NULL;
 
   g_return_val_if_fail (PHOSH_IS_NOTIFY_MANAGER (self), FALSE);
 
@@ -325,14 +712,14 @@ handle_notify (PhoshNotifyDbusNotifications *skeleton,
       }
     } else if ((g_strcmp0 (key, "image-data") == 0) ||
                (g_strcmp0 (key, "image_data") == 0)) {
-      data_gicon = parse_icon_data (value);
+      data_pixbuf = parse_icon_data (value);
     } else if ((g_strcmp0 (key, "image-path") == 0) ||
                (g_strcmp0 (key, "image_path") == 0)) {
       if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING)) {
         path_gicon = parse_icon_string (g_variant_get_string (value, NULL));
       }
     } else if (g_strcmp0 (key, "icon_data") == 0) {
-      old_data_gicon = parse_icon_data (value);
+      old_data_pixbuf = parse_icon_data (value);
     } else if ((g_strcmp0 (key, "desktop_entry") == 0) ||
                (g_strcmp0 (key, "desktop-entry") == 0)) {
       if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING))
@@ -341,12 +728,13 @@ handle_notify (PhoshNotifyDbusNotifications *skeleton,
     g_variant_unref(item);
   }
 
-  if (data_gicon) {
-    image = data_gicon;
+  /* Image data is attached once scaled */
+  if (data_pixbuf) {
+    image_data = data_pixbuf;
   } else if (path_gicon) {
     image = path_gicon;
-  } else if (old_data_gicon) {
-    image = old_data_gicon;
+  } else if (old_data_pixbuf) {
+    image_data = old_data_pixbuf;
   } else if (urgency == PHOSH_NOTIFICATION_URGENCY_CRITICAL) {
     fallback_gicon = g_themed_icon_new ("dialog-error");
     image = fallback_gicon;
@@ -357,24 +745,19 @@ handle_notify (PhoshNotifyDbusNotifications *skeleton,
   icon = app_gicon;
 
   if (desktop_id) {
-    GDesktopAppInfo *desktop_info;
-    g_autofree char *full_id = g_strdup_printf ("%s.desktop", desktop_id);
-
-    desktop_info = g_desktop_app_info_new (full_id);
-
-    if (desktop_info) {
-      info = G_APP_INFO (desktop_info);
-    }
+    info = phosh_app_list_model_lookup_app_id (phosh_app_list_model_get_default (),
+                                               desktop_id);
   }
 
   if (expire_timeout == -1)
     expire_timeout = NOTIFICATION_DEFAULT_TIMEOUT;
 
   if (replaces_id)
-    notification = g_hash_table_lookup (self->notifications, GUINT_TO_POINTER (replaces_id));
+    notification = phosh_notification_store_lookup (self->store, replaces_id);
 
   if (notification) {
     id = replaces_id;
+    drop_image (self, id);
 
     g_object_set (notification,
                   "app_name", app_name,
@@ -385,23 +768,21 @@ handle_notify (PhoshNotifyDbusNotifications *skeleton,
                   "image", image,
                   "actions", actions,
                   NULL);
+    phosh_notification_store_add (self->store, notification);
   } else {
     id = self->next_id++;
 
-    notification = phosh_notification_new (app_name,
-                                           info,
-                                           summary,
-                                           body,
-                                           icon,
-                                           image,
-                                           (GStrv) actions);
+    new_notification = phosh_notification_new (app_name,
+                                               info,
+                                               summary,
+                                               body,
+                                               icon,
+                                               image,
+                                               (GStrv) actions);
+    notification = new_notification;
 
     phosh_notification_set_id (notification, id);
 
-    g_hash_table_insert (self->notifications,
-                         GUINT_TO_POINTER (id),
-                         notification);
-
     g_signal_connect_object (notification,
                              "expired",
                              G_CALLBACK (on_notification_expired),
@@ -418,19 +799,18 @@ handle_notify (PhoshNotifyDbusNotifications *skeleton,
                              self,
                              G_CONNECT_SWAPPED);
 
-    if (expire_timeout) {
-      phosh_notification_expires (notification, expire_timeout);
-    }
-
-    if (self->show_banners) {
-      GtkWidget *banner = NULL;
+    /* Might close older notifications to make room */
+    phosh_notification_store_add (self->store, notification);
 
-      banner = phosh_notification_banner_new (notification);
-
-      gtk_widget_show (GTK_WIDGET (banner));
-    }
+    if (self->show_banners)
+      show_banner (self, notification, expire_timeout);
+    else
+      start_expiry (notification, expire_timeout);
   }
 
+  if (image_data)
+    process_image_data (self, notification, image_data);
+
   phosh_notify_dbus_notifications_complete_notify (
     skeleton, invocation, id);
 
@@ -501,7 +881,20 @@ phosh_notify_manager_dispose (GObject *object)
   PhoshNotifyManager *self = PHOSH_NOTIFY_MANAGER (object);
 
   g_clear_object (&self->settings);
-  g_clear_pointer (&self->notifications, g_hash_table_destroy);
+  g_clear_handle_id (&self->banner_timeout_id, g_source_remove);
+  clear_banner_queue (self);
+  g_clear_pointer (&self->banner_rates, g_hash_table_destroy);
+  if (self->image_jobs) {
+    GHashTableIter iter;
+    GCancellable *cancellable;
+
+    g_hash_table_iter_init (&iter, self->image_jobs);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer) &cancellable))
+      g_cancellable_cancel (cancellable);
+  }
+  g_clear_pointer (&self->image_jobs, g_hash_table_destroy);
+  g_clear_pointer (&self->image_bytes, g_hash_table_destroy);
+  g_clear_object (&self->store);
 
   G_OBJECT_CLASS (phosh_notify_manager_parent_class)->dispose (object);
 }
@@ -545,10 +938,18 @@ phosh_notify_manager_class_init (PhoshNotifyManagerClass *klass)
 static void
 phosh_notify_manager_init (PhoshNotifyManager *self)
 {
-  self->notifications = g_hash_table_new_full (g_direct_hash,
-                                               g_direct_equal,
-                                               NULL,
-                                               (GDestroyNotify) g_object_unref);
+  self->store = phosh_notification_store_new (NOTIFICATIONS_MAX_PER_APP, NOTIFICATIONS_MAX);
+  self->banner_rates = g_hash_table_new_full (g_str_hash,
+                                              g_str_equal,
+                                              g_free,
+                                              g_free);
+  self->banner_rates_pruned = g_get_monotonic_time ();
+  self->image_jobs = g_hash_table_new_full (g_direct_hash,
+                                            g_direct_equal,
+                                            NULL,
+                                            g_object_unref);
+  self->image_bytes = g_hash_table_new (g_direct_hash, g_direct_equal);
+  g_queue_init (&self->banner_queue);
   self->next_id = 1;
 }
 
@@ -565,3 +966,18 @@ phosh_notify_manager_get_default (void)
 
   return instance;
 }
+
+
+/**
+ * phosh_notify_manager_get_store:
+ * @self: The #PhoshNotifyManager
+ *
+ * Returns: (transfer none): The currently open notifications
+ */
+PhoshNotificationStore *
+phosh_notify_manager_get_store (PhoshNotifyManager *self)
+{
+  g_return_val_if_fail (PHOSH_IS_NOTIFY_MANAGER (self), NULL);
+
+  return self->store;
+}
@@ -5,7 +5,7 @@
  */
 #pragma once
 
-#include "notify-manager.h"
+#include "notification-store.h"
 #include "dbus/notify-dbus.h"
 #include <glib-object.h>
 
@@ -15,7 +15,8 @@ G_BEGIN_DECLS
 G_DECLARE_FINAL_TYPE (PhoshNotifyManager, phosh_notify_manager, PHOSH, NOTIFY_MANAGER,
                       PhoshNotifyDbusNotificationsSkeleton)
 
-PhoshNotifyManager * phosh_notify_manager_get_default        (void);
+PhoshNotifyManager     *phosh_notify_manager_get_default (void);
+PhoshNotificationStore *phosh_notify_manager_get_store   (PhoshNotifyManager *self);
 
 
 G_END_DECLS
@@ -13,6 +13,7 @@
 #include "app-grid.h"
 #include "app-grid-button.h"
 #include "shell.h"
+#include "thumbnailer.h"
 #include "util.h"
 #include "toplevel-manager.h"
 #include "phosh-private-client-protocol.h"
@@ -20,10 +21,14 @@
 
 #include <gio/gdesktopappinfo.h>
 
+#include <math.h>
+
 #define HANDY_USE_UNSTABLE_API
 #include <handy.h>
 
 #define OVERVIEW_ICON_SIZE 64
+/* How often to refresh the thumbnails of visible activities */
+#define THUMBNAIL_REFRESH_MS 500
 
 enum {
   ACTIVITY_LAUNCHED,
@@ -39,6 +44,19 @@ typedef struct
   /* Running activities */
   GtkWidget *paginator_running_activities;
   GtkWidget *app_grid;
+
+  /* Activities in the order of the toplevel manager's items */
+  GPtrArray  *activities;
+  /* PhoshToplevel → PhoshActivity */
+  GHashTable *activity_by_toplevel;
+
+  /* PhoshToplevel → PhoshToplevelChanges not yet applied */
+  GHashTable *pending_changes;
+  guint       apply_changes_id;
+
+  /* Live thumbnails */
+  PhoshThumbnailer *thumbnailer;
+  guint             thumbnail_refresh_id;
 } PhoshOverviewPrivate;
 
 
@@ -87,14 +105,6 @@ on_activity_close_clicked (PhoshOverview *self, PhoshActivity *activity)
   g_signal_emit (self, signals[ACTIVITY_CLOSED], 0);
 }
 
-static void
-on_toplevel_closed (PhoshToplevel *toplevel, PhoshActivity *activity)
-{
-  g_return_if_fail (PHOSH_IS_TOPLEVEL (toplevel));
-  g_return_if_fail (PHOSH_IS_ACTIVITY (activity));
-  gtk_widget_destroy (GTK_WIDGET (activity));
-}
-
 static void
 on_toplevel_activated_changed (PhoshToplevel *toplevel, GParamSpec *pspec, PhoshOverview *overview)
 {
@@ -104,7 +114,7 @@ on_toplevel_activated_changed (PhoshToplevel *toplevel, GParamSpec *pspec, Phosh
   g_return_if_fail (PHOSH_IS_TOPLEVEL (toplevel));
   priv = phosh_overview_get_instance_private (overview);
 
-  activity =  g_object_get_data(G_OBJECT(toplevel), "activity");
+  activity = g_hash_table_lookup (priv->activity_by_toplevel, toplevel);
   g_return_if_fail (PHOSH_IS_ACTIVITY (activity));
   if (phosh_toplevel_is_activated (toplevel))
     hdy_paginator_scroll_to (HDY_PAGINATOR (priv->paginator_running_activities), GTK_WIDGET (activity));
@@ -112,7 +122,7 @@ on_toplevel_activated_changed (PhoshToplevel *toplevel, GParamSpec *pspec, Phosh
 
 
 static void
-add_activity (PhoshOverview *self, PhoshToplevel *toplevel)
+add_activity (PhoshOverview *self, PhoshToplevel *toplevel, guint position)
 {
   PhoshMonitor *monitor = phosh_shell_get_primary_monitor (phosh_shell_get_default ());
   PhoshOverviewPrivate *priv;
@@ -132,16 +142,16 @@ add_activity (PhoshOverview *self, PhoshToplevel *toplevel)
                 "win-height", monitor->height,
                 NULL);
   g_object_set_data (G_OBJECT (activity), "toplevel", toplevel);
-  g_object_set_data (G_OBJECT (toplevel), "activity", activity);
+  g_hash_table_insert (priv->activity_by_toplevel, toplevel, activity);
+  g_ptr_array_insert (priv->activities, position, activity);
 
-  gtk_container_add (GTK_CONTAINER (priv->paginator_running_activities), activity);
+  hdy_paginator_insert (HDY_PAGINATOR (priv->paginator_running_activities), activity, position);
   gtk_widget_show (activity);
 
   g_signal_connect_swapped (activity, "clicked", G_CALLBACK (on_activity_clicked), self);
   g_signal_connect_swapped (activity, "close-clicked",
                             G_CALLBACK (on_activity_close_clicked), self);
 
-  g_signal_connect_object (toplevel, "closed", G_CALLBACK (on_toplevel_closed), activity, 0);
   g_signal_connect_object (toplevel, "notify::activated", G_CALLBACK (on_toplevel_activated_changed), self, 0);
 
   if (phosh_toplevel_is_activated (toplevel))
@@ -149,75 +159,169 @@ add_activity (PhoshOverview *self, PhoshToplevel *toplevel)
 }
 
 static void
-get_running_activities (PhoshOverview *self)
+toplevels_changed_cb (PhoshOverview *self,
+                      guint          position,
+                      guint          removed,
+                      guint          added,
+                      GListModel    *toplevels)
 {
   PhoshOverviewPrivate *priv;
-  PhoshToplevelManager *toplevel_manager = phosh_shell_get_toplevel_manager (phosh_shell_get_default ());
-  guint toplevels_num = phosh_toplevel_manager_get_num_toplevels (toplevel_manager);
+
   g_return_if_fail (PHOSH_IS_OVERVIEW (self));
+  g_return_if_fail (G_IS_LIST_MODEL (toplevels));
   priv = phosh_overview_get_instance_private (self);
 
-  if (toplevels_num == 0)
-    gtk_widget_hide (priv->paginator_running_activities);
+  if (priv->activities == NULL)
+    return;
+
+  for (guint i = 0; i < removed; i++) {
+    GtkWidget *activity = g_ptr_array_index (priv->activities, position);
+    PhoshToplevel *toplevel = g_object_get_data (G_OBJECT (activity), "toplevel");
+
+    g_hash_table_remove (priv->activity_by_toplevel, toplevel);
+    g_hash_table_remove (priv->pending_changes, toplevel);
+    g_signal_handlers_disconnect_by_data (toplevel, self);
+    g_ptr_array_remove_index (priv->activities, position);
+    gtk_widget_destroy (activity);
+  }
+
+  for (guint i = 0; i < added; i++) {
+    g_autoptr (PhoshToplevel) toplevel = g_list_model_get_item (toplevels, position + i);
 
-  for (guint i = 0; i < toplevels_num; i++) {
-    PhoshToplevel *toplevel = phosh_toplevel_manager_get_toplevel (toplevel_manager, i);
-    add_activity (self, toplevel);
+    add_activity (self, toplevel, position + i);
   }
 }
 
 static void
-toplevel_added_cb (PhoshOverview        *self,
-                   PhoshToplevel        *toplevel,
-                   PhoshToplevelManager *manager)
+get_running_activities (PhoshOverview *self)
 {
+  PhoshOverviewPrivate *priv;
+  PhoshToplevelManager *toplevel_manager = phosh_shell_get_toplevel_manager (phosh_shell_get_default ());
+  guint toplevels_num = g_list_model_get_n_items (G_LIST_MODEL (toplevel_manager));
   g_return_if_fail (PHOSH_IS_OVERVIEW (self));
-  g_return_if_fail (PHOSH_IS_TOPLEVEL (toplevel));
-  g_return_if_fail (PHOSH_IS_TOPLEVEL_MANAGER (manager));
-  add_activity (self, toplevel);
-}
+  priv = phosh_overview_get_instance_private (self);
 
+  if (toplevels_num == 0)
+    gtk_widget_hide (priv->paginator_running_activities);
 
-static GtkWidget *
-find_activity_by_toplevel (PhoshOverview        *self,
-                           PhoshToplevel        *needle,
-                           PhoshToplevelManager *manager)
+  toplevels_changed_cb (self, 0, 0, toplevels_num, G_LIST_MODEL (toplevel_manager));
+}
+
+static gboolean
+apply_toplevel_changes_cb (GtkWidget     *widget,
+                           GdkFrameClock *frame_clock,
+                           gpointer       user_data)
 {
-  GList *children;
-  GtkWidget *activity = NULL;
+  PhoshOverview *self = PHOSH_OVERVIEW (widget);
   PhoshOverviewPrivate *priv = phosh_overview_get_instance_private (self);
+  GHashTableIter iter;
+  gpointer toplevel, changes;
 
-  children = gtk_container_get_children (GTK_CONTAINER (priv->paginator_running_activities));
-  for (GList *l = children; l; l = l->next) {
-    PhoshToplevel *toplevel;
+  g_hash_table_iter_init (&iter, priv->pending_changes);
+  while (g_hash_table_iter_next (&iter, &toplevel, &changes)) {
+    GtkWidget *activity = g_hash_table_lookup (priv->activity_by_toplevel, toplevel);
 
-    activity = l->data;
-    toplevel = g_object_get_data (G_OBJECT (activity), "toplevel");
-    if (toplevel == needle)
-      break;
+    if (activity == NULL)
+      continue;
+
+    /* TODO: update other properties */
+    if (GPOINTER_TO_UINT (changes) & PHOSH_TOPLEVEL_CHANGES_TITLE) {
+      phosh_activity_set_title (PHOSH_ACTIVITY (activity),
+                                phosh_toplevel_get_title (toplevel));
+    }
   }
+  g_hash_table_remove_all (priv->pending_changes);
 
-  g_list_free (children);
-  return activity;
+  priv->apply_changes_id = 0;
+  return G_SOURCE_REMOVE;
 }
 
 static void
 toplevel_changed_cb (PhoshOverview        *self,
                      PhoshToplevel        *toplevel,
+                     PhoshToplevelChanges  changes,
                      PhoshToplevelManager *manager)
 {
-  GtkWidget *activity;
+  PhoshOverviewPrivate *priv;
+  guint pending;
 
   g_return_if_fail (PHOSH_IS_OVERVIEW (self));
   g_return_if_fail (PHOSH_IS_TOPLEVEL (toplevel));
   g_return_if_fail (PHOSH_IS_TOPLEVEL_MANAGER (manager));
+  priv = phosh_overview_get_instance_private (self);
+
+  if (priv->pending_changes == NULL)
+    return;
 
-  activity = find_activity_by_toplevel (self, toplevel, manager);
-  g_return_if_fail (GTK_IS_WIDGET (activity));
+  /* Fold all changes until the next frame */
+  pending = GPOINTER_TO_UINT (g_hash_table_lookup (priv->pending_changes, toplevel));
+  g_hash_table_insert (priv->pending_changes, toplevel, GUINT_TO_POINTER (pending | changes));
 
-  /* TODO: update other properties */
-  phosh_activity_set_title (PHOSH_ACTIVITY (activity),
-                            phosh_toplevel_get_title (toplevel));
+  if (priv->apply_changes_id == 0) {
+    priv->apply_changes_id = gtk_widget_add_tick_callback (GTK_WIDGET (self),
+                                                           apply_toplevel_changes_cb,
+                                                           NULL, NULL);
+  }
+}
+
+static void
+on_thumbnail_ready (PhoshOverview    *self,
+                    PhoshToplevel    *toplevel,
+                    cairo_surface_t  *surface,
+                    PhoshThumbnailer *thumbnailer)
+{
+  PhoshOverviewPrivate *priv;
+  GtkWidget *activity;
+
+  g_return_if_fail (PHOSH_IS_OVERVIEW (self));
+  priv = phosh_overview_get_instance_private (self);
+
+  activity = g_hash_table_lookup (priv->activity_by_toplevel, toplevel);
+  if (activity == NULL)
+    return;
+
+  phosh_activity_set_thumbnail (PHOSH_ACTIVITY (activity), surface);
+}
+
+static void
+capture_thumbnail (PhoshOverview *self, guint index)
+{
+  PhoshOverviewPrivate *priv = phosh_overview_get_instance_private (self);
+  GtkWidget *activity;
+  PhoshToplevel *toplevel;
+  int scale, width, height;
+
+  if (index >= priv->activities->len)
+    return;
+
+  activity = g_ptr_array_index (priv->activities, index);
+  toplevel = g_object_get_data (G_OBJECT (activity), "toplevel");
+  scale = gtk_widget_get_scale_factor (activity);
+  width = gtk_widget_get_allocated_width (activity) * scale;
+  height = gtk_widget_get_allocated_height (activity) * scale;
+  if (width <= 1 || height <= 1)
+    return;
+
+  phosh_thumbnailer_capture (priv->thumbnailer, toplevel, width, height);
+}
+
+static gboolean
+refresh_thumbnails_cb (PhoshOverview *self)
+{
+  PhoshOverviewPrivate *priv = phosh_overview_get_instance_private (self);
+  HdyPaginator *paginator = HDY_PAGINATOR (priv->paginator_running_activities);
+  gdouble position;
+
+  if (priv->activities->len == 0 || !gtk_widget_get_mapped (GTK_WIDGET (paginator)))
+    return G_SOURCE_CONTINUE;
+
+  /* Only the pages that are (partially) on screen */
+  position = hdy_paginator_get_position (paginator);
+  capture_thumbnail (self, (guint) floor (position));
+  if (ceil (position) != floor (position))
+    capture_thumbnail (self, (guint) ceil (position));
+
+  return G_SOURCE_CONTINUE;
 }
 
 static void
@@ -243,19 +347,14 @@ phosh_overview_size_allocate (GtkWidget     *widget,
 {
   PhoshOverview *self = PHOSH_OVERVIEW (widget);
   PhoshOverviewPrivate *priv = phosh_overview_get_instance_private (self);
-  GList *children, *l;
-
-  children = gtk_container_get_children (GTK_CONTAINER (priv->paginator_running_activities));
 
-  for (l = children; l; l = l->next) {
-    g_object_set (l->data,
+  for (guint i = 0; priv->activities && i < priv->activities->len; i++) {
+    g_object_set (g_ptr_array_index (priv->activities, i),
                   "win-width", alloc->width,
                   "win-height", alloc->height,
                   NULL);
   }
 
-  g_list_free (children);
-
   GTK_WIDGET_CLASS (phosh_overview_parent_class)->size_allocate (widget, alloc);
 }
 
@@ -280,8 +379,8 @@ phosh_overview_constructed (GObject *object)
 
   G_OBJECT_CLASS (phosh_overview_parent_class)->constructed (object);
 
-  g_signal_connect_object (toplevel_manager, "toplevel-added",
-                           G_CALLBACK (toplevel_added_cb),
+  g_signal_connect_object (toplevel_manager, "items-changed",
+                           G_CALLBACK (toplevels_changed_cb),
                            self,
                            G_CONNECT_SWAPPED);
 
@@ -299,6 +398,33 @@ phosh_overview_constructed (GObject *object)
 
   g_signal_connect_swapped (priv->app_grid, "app-launched",
                             G_CALLBACK (app_launched_cb), self);
+
+  priv->thumbnailer = phosh_thumbnailer_new ();
+  g_signal_connect_swapped (priv->thumbnailer, "thumbnail-ready",
+                            G_CALLBACK (on_thumbnail_ready), self);
+}
+
+
+static void
+phosh_overview_dispose (GObject *object)
+{
+  PhoshOverview *self = PHOSH_OVERVIEW (object);
+  PhoshOverviewPrivate *priv = phosh_overview_get_instance_private (self);
+
+  if (priv->apply_changes_id) {
+    gtk_widget_remove_tick_callback (GTK_WIDGET (self), priv->apply_changes_id);
+    priv->apply_changes_id = 0;
+  }
+  g_clear_handle_id (&priv->thumbnail_refresh_id, g_source_remove);
+  if (priv->thumbnailer) {
+    g_signal_handlers_disconnect_by_data (priv->thumbnailer, self);
+    g_clear_object (&priv->thumbnailer);
+  }
+  g_clear_pointer (&priv->pending_changes, g_hash_table_destroy);
+  g_clear_pointer (&priv->activity_by_toplevel, g_hash_table_destroy);
+  g_clear_pointer (&priv->activities, g_ptr_array_unref);
+
+  G_OBJECT_CLASS (phosh_overview_parent_class)->dispose (object);
 }
 
 
@@ -309,6 +435,7 @@ phosh_overview_class_init (PhoshOverviewClass *klass)
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
   object_class->constructed = phosh_overview_constructed;
+  object_class->dispose = phosh_overview_dispose;
   widget_class->size_allocate = phosh_overview_size_allocate;
 
   gtk_widget_class_set_css_name (widget_class, "phosh-overview");
@@ -341,6 +468,12 @@ phosh_overview_class_init (PhoshOverviewClass *klass)
 static void
 phosh_overview_init (PhoshOverview *self)
 {
+  PhoshOverviewPrivate *priv = phosh_overview_get_instance_private (self);
+
+  priv->activities = g_ptr_array_new ();
+  priv->activity_by_toplevel = g_hash_table_new (g_direct_hash, g_direct_equal);
+  priv->pending_changes = g_hash_table_new (g_direct_hash, g_direct_equal);
+
   gtk_widget_init_template (GTK_WIDGET (self));
 }
 
@@ -360,3 +493,43 @@ phosh_overview_new (void)
 {
   return g_object_new (PHOSH_TYPE_OVERVIEW, NULL);
 }
+
+
+/**
+ * phosh_overview_set_live_thumbnails:
+ * @self: The #PhoshOverview
+ * @live: Whether to refresh thumbnails
+ *
+ * Starts or stops refreshing the thumbnails of the running activities.
+ * Only activities currently visible are refreshed and at a limited
+ * rate so this should only be enabled while the overview is shown.
+ */
+void
+phosh_overview_set_live_thumbnails (PhoshOverview *self, gboolean live)
+{
+  PhoshOverviewPrivate *priv;
+
+  g_return_if_fail (PHOSH_IS_OVERVIEW (self));
+  priv = phosh_overview_get_instance_private (self);
+
+  if (!!live == !!priv->thumbnail_refresh_id)
+    return;
+
+  if (!live) {
+    g_clear_handle_id (&priv->thumbnail_refresh_id, g_source_remove);
+    phosh_thumbnailer_stop (priv->thumbnailer);
+    g_debug ("Stopped thumbnails: %.1f fps, %" G_GSIZE_FORMAT " bytes/capture",
+             phosh_thumbnailer_get_fps (priv->thumbnailer),
+             phosh_thumbnailer_get_bytes_per_capture (priv->thumbnailer));
+    return;
+  }
+
+  if (!phosh_thumbnailer_is_supported (priv->thumbnailer))
+    return;
+
+  priv->thumbnail_refresh_id = g_timeout_add (THUMBNAIL_REFRESH_MS,
+                                              (GSourceFunc) refresh_thumbnails_cb,
+                                              self);
+  g_source_set_name_by_id (priv->thumbnail_refresh_id, "[phosh] refresh_thumbnails");
+  refresh_thumbnails_cb (self);
+}
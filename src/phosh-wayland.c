@@ -35,6 +35,7 @@ typedef struct {
   struct wl_display *display;
   struct wl_registry *registry;
   struct wl_seat *wl_seat;
+  struct wl_shm *wl_shm;
   struct xdg_wm_base *xdg_wm_base;
   struct zwlr_foreign_toplevel_manager_v1 *zwlr_foreign_toplevel_manager_v1;
   struct zwlr_input_inhibit_manager_v1 *input_inhibit_manager;
@@ -70,7 +71,7 @@ registry_handle_global (void *data,
         registry,
         name,
         &phosh_private_interface,
-        3);
+        MIN (version, 4));
   } else  if (!strcmp (interface, zwlr_layer_shell_v1_interface.name)) {
       priv->layer_shell = wl_registry_bind (
         registry,
@@ -95,6 +96,12 @@ registry_handle_global (void *data,
     priv->wl_seat = wl_registry_bind(
       registry, name, &wl_seat_interface,
       1);
+  } else if (!strcmp (interface, wl_shm_interface.name)) {
+    priv->wl_shm = wl_registry_bind (
+      registry,
+      name,
+      &wl_shm_interface,
+      1);
   } else if (!strcmp(interface, zwlr_input_inhibit_manager_v1_interface.name)) {
     priv->input_inhibit_manager = wl_registry_bind(
       registry,
@@ -325,6 +332,18 @@ phosh_wayland_get_wl_seat (PhoshWayland *self)
 }
 
 
+struct wl_shm*
+phosh_wayland_get_wl_shm (PhoshWayland *self)
+{
+  PhoshWaylandPrivate *priv;
+
+  g_return_val_if_fail (PHOSH_IS_WAYLAND (self), NULL);
+  priv = phosh_wayland_get_instance_private (self);
+
+  return priv->wl_shm;
+}
+
+
 struct xdg_wm_base*
 phosh_wayland_get_xdg_wm_base (PhoshWayland *self)
 {
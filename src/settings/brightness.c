@@ -12,9 +12,23 @@
 
 #include "settings/brightness.h"
 
+/*
+ * Brightness writes are coalesced: There's at most one call in flight
+ * and only the latest value set meanwhile is sent once it completes.
+ * Writes are further throttled to the scale's frame clock. Since
+ * there are no frames once the scale is unmapped or gone a pending
+ * value is sent right away then.
+ */
 
 GDBusProxy *brightness_proxy;
-gboolean setting_brightness;
+gboolean setting_brightness;        /* a Set call is in flight */
+static gint pending_brightness = -1; /* latest value not sent yet */
+static GtkWidget *brightness_scale;
+static guint brightness_tick_id;
+static gboolean syncing_brightness; /* updating the scale from the proxy */
+
+static void brightness_send (void);
+static void brightness_flush (void);
 
 
 static void
@@ -27,7 +41,8 @@ brightness_changed_cb (GDBusProxy *proxy,
   gint value;
   gboolean ret;
 
-  if (setting_brightness)
+  /* Don't move the slider back while the user's value isn't written yet */
+  if (setting_brightness || pending_brightness >= 0)
     return;
 
   ret = g_variant_lookup (changed_props,
@@ -36,7 +51,26 @@ brightness_changed_cb (GDBusProxy *proxy,
   g_return_if_fail (ret);
   if (value < 0 || value > 100)
     value = 100.0;
+  syncing_brightness = TRUE;
   gtk_range_set_value (GTK_RANGE (scale), value);
+  syncing_brightness = FALSE;
+}
+
+
+static void
+brightness_scale_unmap_cb (GtkWidget *scale, gpointer unused)
+{
+  brightness_flush ();
+}
+
+
+static void
+brightness_scale_finalized_cb (gpointer unused, GObject *where_the_object_was)
+{
+  /* Its tick callback went away with it */
+  brightness_scale = NULL;
+  brightness_tick_id = 0;
+  brightness_send ();
 }
 
 
@@ -74,9 +108,9 @@ brightness_init (GtkScale *scale)
   var = g_dbus_proxy_get_cached_property (proxy, "Brightness");
   if (var) {
     g_variant_get (var, "i", &value);
-    setting_brightness = TRUE;
+    syncing_brightness = TRUE;
     gtk_range_set_value (GTK_RANGE (scale), value);
-    setting_brightness = FALSE;
+    syncing_brightness = FALSE;
     g_variant_unref (var);
   }
 
@@ -86,10 +120,52 @@ brightness_init (GtkScale *scale)
                     scale);
 
   brightness_proxy = proxy;
+  brightness_scale = GTK_WIDGET (scale);
+  g_signal_connect (brightness_scale, "unmap", G_CALLBACK (brightness_scale_unmap_cb), NULL);
+  g_object_weak_ref (G_OBJECT (brightness_scale), brightness_scale_finalized_cb, NULL);
 }
 
 
 
+static gboolean
+brightness_tick_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer unused)
+{
+  brightness_tick_id = 0;
+  brightness_send ();
+  return G_SOURCE_REMOVE;
+}
+
+
+/* Send the pending value now instead of waiting for the next frame */
+static void
+brightness_flush (void)
+{
+  if (brightness_tick_id) {
+    gtk_widget_remove_tick_callback (brightness_scale, brightness_tick_id);
+    brightness_tick_id = 0;
+  }
+  brightness_send ();
+}
+
+
+/* Send the pending value with the next frame */
+static void
+brightness_queue_send (void)
+{
+  if (brightness_tick_id)
+    return;
+
+  if (brightness_scale && gtk_widget_get_mapped (brightness_scale)) {
+    brightness_tick_id = gtk_widget_add_tick_callback (brightness_scale,
+                                                       brightness_tick_cb,
+                                                       NULL, NULL);
+  } else {
+    /* No frame clock to throttle to */
+    brightness_send ();
+  }
+}
+
+
 static void
 brightness_set_cb (GDBusProxy *proxy, GAsyncResult *res, gpointer unused)
 {
@@ -97,29 +173,31 @@ brightness_set_cb (GDBusProxy *proxy, GAsyncResult *res, gpointer unused)
   GVariant *var;
 
   var = g_dbus_proxy_call_finish (proxy, res, &err);
+  setting_brightness = FALSE;
 
   if (err) {
     g_warning("Could not set brightness %s", err->message);
     g_error_free(err);
-    return;
   }
 
   if (var)
     g_variant_unref (var);
 
-  setting_brightness = FALSE;
+  /* Values set meanwhile */
+  if (pending_brightness >= 0)
+    brightness_queue_send ();
 }
 
 
-void
-brightness_set (int brightness)
+static void
+brightness_send (void)
 {
-  if (!brightness_proxy)
-    return;
+  gint brightness = pending_brightness;
 
-  if (setting_brightness)
+  if (!brightness_proxy || setting_brightness || brightness < 0)
     return;
 
+  pending_brightness = -1;
   setting_brightness = TRUE;
   g_dbus_proxy_call (brightness_proxy,
                      "org.freedesktop.DBus.Properties.Set",
@@ -136,8 +214,33 @@ brightness_set (int brightness)
 }
 
 
+void
+brightness_set (int brightness)
+{
+  if (!brightness_proxy)
+    return;
+
+  if (syncing_brightness)
+    return;
+
+  /* Latest value wins, it's sent once the call in flight completes */
+  pending_brightness = brightness;
+  if (!setting_brightness)
+    brightness_queue_send ();
+}
+
+
 void
 brightness_dispose (void)
 {
+  if (brightness_scale) {
+    if (brightness_tick_id)
+      gtk_widget_remove_tick_callback (brightness_scale, brightness_tick_id);
+    g_signal_handlers_disconnect_by_func (brightness_scale, brightness_scale_unmap_cb, NULL);
+    g_object_weak_unref (G_OBJECT (brightness_scale), brightness_scale_finalized_cb, NULL);
+    brightness_scale = NULL;
+  }
+  brightness_tick_id = 0;
+  pending_brightness = -1;
   g_clear_pointer (&brightness_proxy, g_object_unref);
 }
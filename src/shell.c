@@ -41,10 +41,15 @@
 #include "screen-saver-manager.h"
 #include "session.h"
 #include "settings.h"
+#include "startup-tracer.h"
 #include "system-prompter.h"
 #include "util.h"
 #include "wifiinfo.h"
 #include "wwaninfo.h"
+#include "wwan/phosh-wwan-mm.h"
+
+/* Run deferred initialization even if we never see a first frame */
+#define DEFERRED_INIT_TIMEOUT_MS 2000
 
 
 enum {
@@ -52,6 +57,7 @@ enum {
   PHOSH_SHELL_PROP_ROTATION,
   PHOSH_SHELL_PROP_LOCKED,
   PHOSH_SHELL_PROP_PRIMARY_MONITOR,
+  PHOSH_SHELL_PROP_WWAN,
   PHOSH_SHELL_PROP_LAST_PROP
 };
 static GParamSpec *props[PHOSH_SHELL_PROP_LAST_PROP];
@@ -82,10 +88,18 @@ typedef struct
   PhoshScreenSaverManager *screen_saver_manager;
   PhoshNotifyManager *notify_manager;
   PhoshFeedbackManager *feedback_manager;
+  PhoshWWan *wwan;
 
   /* sensors */
   PhoshSensorProxyManager *sensor_proxy_manager;
   PhoshProximity *proximity;
+
+  /* startup */
+  PhoshStartupTracer *startup_tracer;
+  guint deferred_init_pos;        /* next entry in deferred_inits */
+  guint deferred_init_id;
+  guint deferred_init_timeout_id;
+  gboolean deferred_init_started;
 } PhoshShellPrivate;
 
 
@@ -284,6 +298,132 @@ on_home_state_changed (PhoshShell *self, GParamSpec *pspec, PhoshHome *home)
 }
 
 
+static void
+init_notify_manager (PhoshShell *self)
+{
+  PhoshShellPrivate *priv = phosh_shell_get_instance_private (self);
+
+  priv->notify_manager = phosh_notify_manager_get_default ();
+}
+
+
+static void
+init_wwan (PhoshShell *self)
+{
+  PhoshShellPrivate *priv = phosh_shell_get_instance_private (self);
+
+  priv->wwan = PHOSH_WWAN (phosh_wwan_mm_new ());
+  g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_SHELL_PROP_WWAN]);
+}
+
+
+static void
+init_polkit_auth_agent (PhoshShell *self)
+{
+  PhoshShellPrivate *priv = phosh_shell_get_instance_private (self);
+
+  priv->polkit_auth_agent = phosh_polkit_auth_agent_new ();
+}
+
+
+static void
+init_system_prompter (PhoshShell *self)
+{
+  phosh_system_prompter_register ();
+}
+
+
+static void
+on_lockscreen_first_frame (PhoshShell *self, GParamSpec *pspec, PhoshLockscreenManager *manager)
+{
+  PhoshShellPrivate *priv = phosh_shell_get_instance_private (self);
+  gint64 latency = phosh_lockscreen_manager_get_lock_latency (manager);
+
+  g_signal_handlers_disconnect_by_func (manager, on_lockscreen_first_frame, self);
+  phosh_startup_tracer_mark (priv->startup_tracer, "lockscreen-first-frame",
+                             g_get_monotonic_time () - latency);
+}
+
+
+/* Not needed for the first frame, initialized in this order afterwards */
+static const struct {
+  const char *name;
+  void (*init) (PhoshShell *self);
+} deferred_inits[] = {
+  { "notify-manager", init_notify_manager },
+  { "wwan", init_wwan },
+  { "polkit-auth-agent", init_polkit_auth_agent },
+  { "system-prompter", init_system_prompter },
+};
+
+
+static gboolean
+on_deferred_init_idle (PhoshShell *self)
+{
+  PhoshShellPrivate *priv = phosh_shell_get_instance_private (self);
+  gint64 begin = g_get_monotonic_time ();
+  guint pos = priv->deferred_init_pos++;
+
+  /* One per main loop iteration so we don't block frames */
+  deferred_inits[pos].init (self);
+  phosh_startup_tracer_mark (priv->startup_tracer, deferred_inits[pos].name, begin);
+
+  if (priv->deferred_init_pos < G_N_ELEMENTS (deferred_inits))
+    return G_SOURCE_CONTINUE;
+
+  priv->deferred_init_id = 0;
+  /* Only interested in the lock screen if it's up during startup */
+  g_signal_handlers_disconnect_by_func (priv->lockscreen_manager, on_lockscreen_first_frame, self);
+  phosh_startup_tracer_finish (priv->startup_tracer);
+  return G_SOURCE_REMOVE;
+}
+
+
+static void
+start_deferred_init (PhoshShell *self)
+{
+  PhoshShellPrivate *priv = phosh_shell_get_instance_private (self);
+
+  if (priv->deferred_init_started)
+    return;
+
+  priv->deferred_init_started = TRUE;
+  g_clear_handle_id (&priv->deferred_init_timeout_id, g_source_remove);
+  priv->deferred_init_id = g_idle_add_full (G_PRIORITY_LOW,
+                                            (GSourceFunc) on_deferred_init_idle,
+                                            self,
+                                            NULL);
+  g_source_set_name_by_id (priv->deferred_init_id, "[phosh] deferred_init");
+}
+
+
+static gboolean
+on_deferred_init_timeout (PhoshShell *self)
+{
+  PhoshShellPrivate *priv = phosh_shell_get_instance_private (self);
+
+  priv->deferred_init_timeout_id = 0;
+  g_debug ("No first frame yet, starting deferred init");
+  start_deferred_init (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+static gboolean
+on_panel_first_frame (PhoshShell *self, cairo_t *cr, GtkWidget *panel)
+{
+  PhoshShellPrivate *priv = phosh_shell_get_instance_private (self);
+
+  g_signal_handlers_disconnect_by_func (panel, on_panel_first_frame, self);
+  phosh_startup_tracer_mark (priv->startup_tracer, "panel-first-frame",
+                             phosh_startup_tracer_get_start (priv->startup_tracer));
+  start_deferred_init (self);
+
+  return GDK_EVENT_PROPAGATE;
+}
+
+
 static void
 panels_create (PhoshShell *self)
 {
@@ -296,6 +436,12 @@ panels_create (PhoshShell *self)
 
   priv->panel = PHOSH_LAYER_SURFACE(phosh_panel_new (phosh_wayland_get_zwlr_layer_shell_v1(wl),
                                                      monitor->wl_output));
+  if (!priv->deferred_init_started) {
+    g_signal_connect_object (priv->panel, "draw",
+                             G_CALLBACK (on_panel_first_frame),
+                             self,
+                             G_CONNECT_SWAPPED);
+  }
   gtk_widget_show (GTK_WIDGET (priv->panel));
 
   priv->home = PHOSH_LAYER_SURFACE(phosh_home_new (phosh_wayland_get_zwlr_layer_shell_v1(wl),
@@ -401,6 +547,9 @@ phosh_shell_get_property (GObject *object,
   case PHOSH_SHELL_PROP_PRIMARY_MONITOR:
     g_value_set_object (value, phosh_shell_get_primary_monitor (self));
     break;
+  case PHOSH_SHELL_PROP_WWAN:
+    g_value_set_object (value, priv->wwan);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     break;
@@ -421,7 +570,12 @@ phosh_shell_dispose (GObject *object)
       g_clear_object (&priv->sensor_proxy_manager);
   }
 
+  g_clear_handle_id (&priv->deferred_init_id, g_source_remove);
+  g_clear_handle_id (&priv->deferred_init_timeout_id, g_source_remove);
+  g_clear_object (&priv->startup_tracer);
+
   panels_dispose (self);
+  g_clear_object (&priv->wwan);
   g_clear_object (&priv->notify_manager);
   g_clear_object (&priv->screen_saver_manager);
   g_clear_object (&priv->lockscreen_manager);
@@ -489,10 +643,15 @@ static gboolean
 setup_idle_cb (PhoshShell *self)
 {
   PhoshShellPrivate *priv = phosh_shell_get_instance_private (self);
+  gint64 begin = g_get_monotonic_time ();
 
   panels_create (self);
+  phosh_startup_tracer_mark (priv->startup_tracer, "panels", begin);
+
   /* Create background after panel since it needs the panel's size */
+  begin = g_get_monotonic_time ();
   priv->background_manager = phosh_background_manager_new ();
+  phosh_startup_tracer_mark (priv->startup_tracer, "background-manager", begin);
 
   g_signal_connect_object (priv->toplevel_manager,
                            "notify::num-toplevels",
@@ -508,19 +667,28 @@ setup_idle_cb (PhoshShell *self)
                            G_CONNECT_SWAPPED);
 
   /* Screen saver manager needs lock screen manager */
+  begin = g_get_monotonic_time ();
   priv->screen_saver_manager = phosh_screen_saver_manager_get_default (
     priv->lockscreen_manager);
+  phosh_startup_tracer_mark (priv->startup_tracer, "screen-saver-manager", begin);
 
-  priv->notify_manager = phosh_notify_manager_get_default ();
-
+  begin = g_get_monotonic_time ();
   priv->sensor_proxy_manager = phosh_sensor_proxy_manager_get_default_failable ();
   if (priv->sensor_proxy_manager) {
     priv->proximity = phosh_proximity_new (priv->sensor_proxy_manager,
                                            priv->lockscreen_manager);
     /* TODO: accelerometer */
   }
+  phosh_startup_tracer_mark (priv->startup_tracer, "sensor-proxy-manager", begin);
 
+  begin = g_get_monotonic_time ();
   phosh_session_register (PHOSH_APP_ID);
+  phosh_startup_tracer_mark (priv->startup_tracer, "session", begin);
+
+  priv->deferred_init_timeout_id = g_timeout_add (DEFERRED_INIT_TIMEOUT_MS,
+                                                  (GSourceFunc) on_deferred_init_timeout,
+                                                  self);
+  g_source_set_name_by_id (priv->deferred_init_timeout_id, "[phosh] deferred_init_timeout");
   return FALSE;
 }
 
@@ -541,29 +709,49 @@ phosh_shell_constructed (GObject *object)
   PhoshShell *self = PHOSH_SHELL (object);
   PhoshShellPrivate *priv = phosh_shell_get_instance_private (self);
 
+  gint64 begin;
+
   G_OBJECT_CLASS (phosh_shell_parent_class)->constructed (object);
 
+  priv->startup_tracer = phosh_startup_tracer_new ();
+
+  begin = g_get_monotonic_time ();
   priv->monitor_manager = phosh_monitor_manager_new ();
   if (phosh_monitor_manager_get_num_monitors(priv->monitor_manager)) {
     priv->primary_monitor = phosh_monitor_manager_get_monitor (
       priv->monitor_manager, 0);
   }
+  phosh_startup_tracer_mark (priv->startup_tracer, "monitor-manager", begin);
+
+  begin = g_get_monotonic_time ();
   gtk_icon_theme_add_resource_path (gtk_icon_theme_get_default (),
                                     "/sm/puri/phosh/icons");
   env_setup ();
   css_setup (self);
   type_setup ();
+  phosh_startup_tracer_mark (priv->startup_tracer, "style", begin);
 
+  begin = g_get_monotonic_time ();
   priv->lockscreen_manager = phosh_lockscreen_manager_new ();
+  g_signal_connect_object (priv->lockscreen_manager,
+                           "notify::lock-latency",
+                           G_CALLBACK (on_lockscreen_first_frame),
+                           self,
+                           G_CONNECT_SWAPPED);
+  phosh_startup_tracer_mark (priv->startup_tracer, "lockscreen-manager", begin);
+
+  begin = g_get_monotonic_time ();
   priv->idle_manager = phosh_idle_manager_get_default();
+  phosh_startup_tracer_mark (priv->startup_tracer, "idle-manager", begin);
 
+  begin = g_get_monotonic_time ();
   priv->toplevel_manager = phosh_toplevel_manager_new ();
+  phosh_startup_tracer_mark (priv->startup_tracer, "toplevel-manager", begin);
   priv->faders = g_ptr_array_new_with_free_func ((GDestroyNotify) (gtk_widget_destroy));
 
-  phosh_system_prompter_register ();
-  priv->polkit_auth_agent = phosh_polkit_auth_agent_new ();
-
+  begin = g_get_monotonic_time ();
   priv->feedback_manager = phosh_feedback_manager_new ();
+  phosh_startup_tracer_mark (priv->startup_tracer, "feedback-manager", begin);
 
   g_idle_add ((GSourceFunc) setup_idle_cb, self);
 }
@@ -603,6 +791,19 @@ phosh_shell_class_init (PhoshShellClass *klass)
                          PHOSH_TYPE_MONITOR,
                          G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * PhoshShell:wwan:
+   *
+   * The shared #PhoshWWan. It's created once the shell displayed its
+   * first frame so it is %NULL early on.
+   */
+  props[PHOSH_SHELL_PROP_WWAN] =
+    g_param_spec_object ("wwan",
+                         "WWan",
+                         "The wwan interface",
+                         PHOSH_TYPE_WWAN,
+                         G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY);
+
   g_object_class_install_properties (object_class, PHOSH_SHELL_PROP_LAST_PROP, props);
 }
 
@@ -800,6 +1001,25 @@ phosh_shell_get_feedback_manager (PhoshShell *self)
   return priv->feedback_manager;
 }
 
+/**
+ * phosh_shell_get_wwan:
+ * @self: The #PhoshShell
+ *
+ * Returns: (transfer none) (nullable): The shared #PhoshWWan or %NULL
+ * if it wasn't created yet. Listen to #PhoshShell:wwan to get notified
+ * when it is.
+ */
+PhoshWWan *
+phosh_shell_get_wwan (PhoshShell *self)
+{
+  PhoshShellPrivate *priv;
+
+  g_return_val_if_fail (PHOSH_IS_SHELL (self), NULL);
+  priv = phosh_shell_get_instance_private (self);
+
+  return priv->wwan;
+}
+
 /**
  * Returns the usable area in pixels usable by a client on the phone
  * display
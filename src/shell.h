@@ -14,6 +14,7 @@
 #include "osk-manager.h"
 #include "toplevel-manager.h"
 #include "wifimanager.h"
+#include "wwan/phosh-wwan-iface.h"
 
 #include <gtk/gtk.h>
 
@@ -46,6 +47,7 @@ PhoshOskManager     *phosh_shell_get_osk_manager     (PhoshShell *self);
 PhoshToplevelManager *phosh_shell_get_toplevel_manager (PhoshShell *self);
 PhoshWifiManager    *phosh_shell_get_wifi_manager    (PhoshShell *self);
 PhoshFeedbackManager *phosh_shell_get_feedback_manager (PhoshShell *self);
+PhoshWWan           *phosh_shell_get_wwan            (PhoshShell *self);
 void                 phosh_shell_fade_out (PhoshShell *self, guint timeout);
 
 G_END_DECLS
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#define G_LOG_DOMAIN "phosh-startup-tracer"
+
+#include "config.h"
+#include "startup-tracer.h"
+
+#ifdef HAVE_SYSPROF
+# include <sysprof-capture.h>
+#endif
+
+/**
+ * SECTION:phosh-startup-tracer
+ * @short_description: Records how long the shell's startup phases take
+ * @Title: PhoshStartupTracer
+ *
+ * Records monotonic begin and end timestamps for each phase of the
+ * shell's startup (like the construction of a manager or the first
+ * frame of a surface). When built with sysprof support every phase
+ * is also sent as a mark to a running sysprof capture.
+ *
+ * Set the `PHOSH_STARTUP_TRACE` environment variable to get a summary
+ * of all phases printed once startup finished.
+ */
+
+#define STARTUP_TRACE_ENV "PHOSH_STARTUP_TRACE"
+
+typedef struct _Phase {
+  gchar  *name;
+  gint64  begin;
+  gint64  end;
+} Phase;
+
+struct _PhoshStartupTracer {
+  GObject  parent;
+
+  gint64   start;
+  GArray  *phases;
+  gboolean finished;
+};
+
+G_DEFINE_TYPE (PhoshStartupTracer, phosh_startup_tracer, G_TYPE_OBJECT);
+
+
+static void
+phase_clear (Phase *phase)
+{
+  g_free (phase->name);
+}
+
+
+static void
+phosh_startup_tracer_finalize (GObject *object)
+{
+  PhoshStartupTracer *self = PHOSH_STARTUP_TRACER (object);
+
+  g_array_unref (self->phases);
+
+  G_OBJECT_CLASS (phosh_startup_tracer_parent_class)->finalize (object);
+}
+
+
+static void
+phosh_startup_tracer_class_init (PhoshStartupTracerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = phosh_startup_tracer_finalize;
+}
+
+
+static void
+phosh_startup_tracer_init (PhoshStartupTracer *self)
+{
+  self->start = g_get_monotonic_time ();
+  self->phases = g_array_new (FALSE, FALSE, sizeof (Phase));
+  g_array_set_clear_func (self->phases, (GDestroyNotify) phase_clear);
+}
+
+
+/**
+ * phosh_startup_tracer_new:
+ *
+ * Creates a new tracer. Its creation time is used as the start of
+ * startup.
+ *
+ * Returns: A new #PhoshStartupTracer
+ */
+PhoshStartupTracer *
+phosh_startup_tracer_new (void)
+{
+  return g_object_new (PHOSH_TYPE_STARTUP_TRACER, NULL);
+}
+
+
+/**
+ * phosh_startup_tracer_mark:
+ * @self: The #PhoshStartupTracer
+ * @phase: The name of the phase
+ * @begin: The phase's begin in monotonic time (us)
+ *
+ * Records that @phase started at @begin and ended now.
+ */
+void
+phosh_startup_tracer_mark (PhoshStartupTracer *self, const char *phase, gint64 begin)
+{
+  Phase p;
+
+  g_return_if_fail (PHOSH_IS_STARTUP_TRACER (self));
+  g_return_if_fail (phase);
+
+  p.name = g_strdup (phase);
+  p.begin = begin;
+  p.end = g_get_monotonic_time ();
+  g_array_append_val (self->phases, p);
+
+  g_debug ("Phase %s took %" G_GINT64_FORMAT " us, done at %" G_GINT64_FORMAT " ms",
+           phase, p.end - p.begin, (p.end - self->start) / 1000);
+
+#ifdef HAVE_SYSPROF
+  /* sysprof uses CLOCK_MONOTONIC in ns */
+  sysprof_collector_mark (p.begin * 1000, (p.end - p.begin) * 1000,
+                          "phosh", phase, NULL);
+#endif
+}
+
+
+/**
+ * phosh_startup_tracer_get_start:
+ * @self: The #PhoshStartupTracer
+ *
+ * Returns: The start of startup in monotonic time (us)
+ */
+gint64
+phosh_startup_tracer_get_start (PhoshStartupTracer *self)
+{
+  g_return_val_if_fail (PHOSH_IS_STARTUP_TRACER (self), 0);
+
+  return self->start;
+}
+
+
+/**
+ * phosh_startup_tracer_finish:
+ * @self: The #PhoshStartupTracer
+ *
+ * Marks startup as done. Prints a summary of all phases when
+ * `PHOSH_STARTUP_TRACE` is set.
+ */
+void
+phosh_startup_tracer_finish (PhoshStartupTracer *self)
+{
+  g_autoptr (GString) summary = NULL;
+
+  g_return_if_fail (PHOSH_IS_STARTUP_TRACER (self));
+
+  if (self->finished)
+    return;
+
+  phosh_startup_tracer_mark (self, "startup", self->start);
+  self->finished = TRUE;
+
+  if (g_getenv (STARTUP_TRACE_ENV) == NULL)
+    return;
+
+  summary = g_string_new ("Startup phases (begin, duration in ms):\n");
+  for (guint i = 0; i < self->phases->len; i++) {
+    Phase *p = &g_array_index (self->phases, Phase, i);
+
+    g_string_append_printf (summary, "  %-24s %8.2f %8.2f\n", p->name,
+                            (p->begin - self->start) / 1000.0,
+                            (p->end - p->begin) / 1000.0);
+  }
+  g_message ("%s", summary->str);
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define PHOSH_TYPE_STARTUP_TRACER (phosh_startup_tracer_get_type())
+
+G_DECLARE_FINAL_TYPE (PhoshStartupTracer,
+                      phosh_startup_tracer,
+                      PHOSH,
+                      STARTUP_TRACER,
+                      GObject)
+
+PhoshStartupTracer *phosh_startup_tracer_new       (void);
+void                phosh_startup_tracer_mark      (PhoshStartupTracer *self,
+                                                    const char         *phase,
+                                                    gint64              begin);
+gint64              phosh_startup_tracer_get_start (PhoshStartupTracer *self);
+void                phosh_startup_tracer_finish    (PhoshStartupTracer *self);
+
+G_END_DECLS
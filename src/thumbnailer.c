@@ -0,0 +1,584 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#define G_LOG_DOMAIN "phosh-thumbnailer"
+
+#include "config.h"
+#include "thumbnailer.h"
+#include "phosh-wayland.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * SECTION:phosh-thumbnailer
+ * @short_description: Captures scaled down copies of toplevels
+ * @Title: PhoshThumbnailer
+ *
+ * The #PhoshThumbnailer asks the compositor to copy a toplevel into a
+ * shared memory buffer. The compositor scales the toplevel down to the
+ * requested size so only the thumbnail's pixels cross the wire.
+ *
+ * Buffers come from a small pool and are reused for later captures.
+ * Each frame is copied out of its buffer into the toplevel's thumbnail
+ * surface so thumbnails kept around by activities don't pin the pool.
+ * That surface is updated in place as long as the size doesn't change.
+ * To keep thumbnails cheap on phone GPUs captures are limited to a
+ * fixed budget of frames and bytes per second. The achieved rate is
+ * logged at debug level.
+ */
+
+/* Capture budget */
+#define THUMBNAIL_MAX_FPS           10
+#define THUMBNAIL_MAX_BYTES_PER_SEC (4 * 1024 * 1024)
+/* Upper bound of buffers in the pool, idle or in use by a capture */
+#define THUMBNAIL_MAX_BUFFERS       8
+
+enum {
+  THUMBNAIL_READY,
+  N_SIGNALS
+};
+static guint signals[N_SIGNALS] = { 0 };
+
+typedef struct _ShmBuffer {
+  struct wl_buffer *wl_buffer;
+  gpointer          data;
+  gsize             size;
+  guint32           format;
+  guint             width;
+  guint             height;
+  guint             stride;
+  gboolean          busy;
+} ShmBuffer;
+
+typedef struct _Capture {
+  PhoshThumbnailer                      *thumbnailer;
+  PhoshToplevel                         *toplevel;
+  struct phosh_private_screencopy_frame *frame;
+  ShmBuffer                             *buffer;
+} Capture;
+
+struct _PhoshThumbnailer {
+  GObject               parent;
+
+  struct phosh_private *phosh_private;
+  struct wl_shm        *wl_shm;
+
+  GPtrArray            *buffers;  /* ShmBuffer, idle and busy */
+  GHashTable           *captures; /* PhoshToplevel → Capture in flight */
+  GHashTable           *surfaces; /* PhoshToplevel → cairo_surface_t of its last capture */
+
+  /* Budget accounting over one second windows */
+  gint64                window_start;
+  guint                 window_frames;
+  gsize                 window_bytes;
+  gdouble               fps;
+  gsize                 bytes_per_capture;
+};
+
+G_DEFINE_TYPE (PhoshThumbnailer, phosh_thumbnailer, G_TYPE_OBJECT);
+
+
+static int
+create_shm_file (gsize size)
+{
+  g_autofree gchar *name = NULL;
+  int fd;
+
+  name = g_strdup_printf ("/phosh-thumbnail-%d-%u", getpid (), g_random_int ());
+  fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    g_warning ("Failed to create shm file: %s", g_strerror (errno));
+    return -1;
+  }
+  shm_unlink (name);
+
+  if (ftruncate (fd, size) < 0) {
+    g_warning ("Failed to size shm file: %s", g_strerror (errno));
+    close (fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+
+static void
+shm_buffer_free (ShmBuffer *buffer)
+{
+  g_clear_pointer (&buffer->wl_buffer, wl_buffer_destroy);
+  if (buffer->data)
+    munmap (buffer->data, buffer->size);
+  g_free (buffer);
+}
+
+
+static ShmBuffer *
+shm_buffer_new (PhoshThumbnailer *self,
+                guint32           format,
+                guint             width,
+                guint             height,
+                guint             stride)
+{
+  ShmBuffer *buffer;
+  struct wl_shm_pool *pool;
+  gsize size = (gsize) stride * height;
+  int fd;
+
+  fd = create_shm_file (size);
+  if (fd < 0)
+    return NULL;
+
+  buffer = g_new0 (ShmBuffer, 1);
+  buffer->data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (buffer->data == MAP_FAILED) {
+    g_warning ("Failed to map shm file: %s", g_strerror (errno));
+    close (fd);
+    g_free (buffer);
+    return NULL;
+  }
+
+  pool = wl_shm_create_pool (self->wl_shm, fd, size);
+  buffer->wl_buffer = wl_shm_pool_create_buffer (pool, 0, width, height, stride, format);
+  wl_shm_pool_destroy (pool);
+  close (fd);
+
+  buffer->size = size;
+  buffer->format = format;
+  buffer->width = width;
+  buffer->height = height;
+  buffer->stride = stride;
+
+  g_debug ("New %ux%u thumbnail buffer, %" G_GSIZE_FORMAT " bytes", width, height, size);
+  return buffer;
+}
+
+
+/* Hands the buffer back to the pool */
+static void
+shm_buffer_release (ShmBuffer *buffer)
+{
+  buffer->busy = FALSE;
+}
+
+
+static ShmBuffer *
+get_buffer (PhoshThumbnailer *self,
+            guint32           format,
+            guint             width,
+            guint             height,
+            guint             stride)
+{
+  ShmBuffer *buffer;
+
+  for (guint i = 0; i < self->buffers->len; i++) {
+    buffer = g_ptr_array_index (self->buffers, i);
+
+    if (buffer->busy)
+      continue;
+
+    if (buffer->format == format && buffer->width == width &&
+        buffer->height == height && buffer->stride == stride) {
+      buffer->busy = TRUE;
+      return buffer;
+    }
+  }
+
+  /* Make room by dropping an idle buffer of the wrong size */
+  for (guint i = 0; self->buffers->len >= THUMBNAIL_MAX_BUFFERS && i < self->buffers->len; i++) {
+    buffer = g_ptr_array_index (self->buffers, i);
+
+    if (!buffer->busy) {
+      g_ptr_array_remove_index_fast (self->buffers, i);
+      shm_buffer_free (buffer);
+      break;
+    }
+  }
+
+  if (self->buffers->len >= THUMBNAIL_MAX_BUFFERS)
+    return NULL;
+
+  buffer = shm_buffer_new (self, format, width, height, stride);
+  if (buffer == NULL)
+    return NULL;
+
+  buffer->busy = TRUE;
+  g_ptr_array_add (self->buffers, buffer);
+  return buffer;
+}
+
+
+static void
+capture_free (Capture *capture)
+{
+  g_clear_pointer (&capture->frame, phosh_private_screencopy_frame_destroy);
+  g_clear_pointer (&capture->buffer, shm_buffer_release);
+  g_object_unref (capture->toplevel);
+  g_free (capture);
+}
+
+
+/* Rolls the accounting window over once a second has passed */
+static void
+update_budget (PhoshThumbnailer *self)
+{
+  gint64 now = g_get_monotonic_time ();
+  gint64 elapsed = now - self->window_start;
+
+  if (elapsed < G_USEC_PER_SEC)
+    return;
+
+  self->fps = (gdouble) self->window_frames * G_USEC_PER_SEC / elapsed;
+  self->bytes_per_capture = self->window_frames ? self->window_bytes / self->window_frames : 0;
+  if (self->window_frames) {
+    g_debug ("Thumbnails: %.1f fps, %" G_GSIZE_FORMAT " bytes/capture",
+             self->fps, self->bytes_per_capture);
+  }
+
+  self->window_start = now;
+  self->window_frames = 0;
+  self->window_bytes = 0;
+}
+
+
+static void
+frame_handle_buffer (void                                  *data,
+                     struct phosh_private_screencopy_frame *frame,
+                     uint32_t                               format,
+                     uint32_t                               width,
+                     uint32_t                               height,
+                     uint32_t                               stride)
+{
+  Capture *capture = data;
+  PhoshThumbnailer *self = capture->thumbnailer;
+
+  if (format != WL_SHM_FORMAT_ARGB8888 && format != WL_SHM_FORMAT_XRGB8888) {
+    g_warning ("Unsupported thumbnail format 0x%x", format);
+    g_hash_table_remove (self->captures, capture->toplevel);
+    return;
+  }
+
+  if (width == 0 || height == 0 || stride < width * 4 || stride % 4) {
+    g_warning ("Invalid thumbnail buffer %ux%u, stride %u", width, height, stride);
+    g_hash_table_remove (self->captures, capture->toplevel);
+    return;
+  }
+
+  capture->buffer = get_buffer (self, format, width, height, stride);
+  if (capture->buffer == NULL) {
+    g_debug ("No buffer for %ux%u thumbnail", width, height);
+    g_hash_table_remove (self->captures, capture->toplevel);
+    return;
+  }
+
+  phosh_private_screencopy_frame_copy (frame, capture->buffer->wl_buffer);
+}
+
+
+static void
+on_toplevel_closed (PhoshThumbnailer *self,
+                    PhoshToplevel    *toplevel)
+{
+  g_hash_table_remove (self->surfaces, toplevel);
+}
+
+
+/* The toplevel's thumbnail surface, only reallocated when the size changes */
+static cairo_surface_t *
+get_surface (PhoshThumbnailer *self,
+             PhoshToplevel    *toplevel,
+             ShmBuffer        *buffer)
+{
+  cairo_surface_t *surface = g_hash_table_lookup (self->surfaces, toplevel);
+  cairo_format_t format;
+
+  format = buffer->format == WL_SHM_FORMAT_ARGB8888 ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24;
+  if (surface &&
+      cairo_image_surface_get_format (surface) == format &&
+      (guint) cairo_image_surface_get_width (surface) == buffer->width &&
+      (guint) cairo_image_surface_get_height (surface) == buffer->height)
+    return surface;
+
+  surface = cairo_image_surface_create (format, buffer->width, buffer->height);
+  if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS) {
+    g_warning ("Failed to create %ux%u thumbnail surface", buffer->width, buffer->height);
+    cairo_surface_destroy (surface);
+    return NULL;
+  }
+
+  if (!g_hash_table_contains (self->surfaces, toplevel)) {
+    g_signal_connect_object (toplevel, "closed",
+                             G_CALLBACK (on_toplevel_closed), self,
+                             G_CONNECT_SWAPPED);
+  }
+  g_hash_table_replace (self->surfaces, g_object_ref (toplevel), surface);
+
+  return surface;
+}
+
+
+static void
+frame_handle_ready (void                                  *data,
+                    struct phosh_private_screencopy_frame *frame)
+{
+  Capture *capture = data;
+  PhoshThumbnailer *self = capture->thumbnailer;
+  ShmBuffer *buffer = g_steal_pointer (&capture->buffer);
+  cairo_surface_t *surface;
+  guchar *dest;
+  int dest_stride;
+
+  g_return_if_fail (buffer);
+
+  surface = get_surface (self, capture->toplevel, buffer);
+  if (surface == NULL) {
+    shm_buffer_release (buffer);
+    g_hash_table_remove (self->captures, capture->toplevel);
+    return;
+  }
+
+  /* Copy the frame out so the buffer can go back to the pool right away */
+  cairo_surface_flush (surface);
+  dest = cairo_image_surface_get_data (surface);
+  dest_stride = cairo_image_surface_get_stride (surface);
+  for (guint y = 0; y < buffer->height; y++) {
+    memcpy (dest + (gsize) y * dest_stride,
+            (guchar *) buffer->data + (gsize) y * buffer->stride,
+            (gsize) buffer->width * 4);
+  }
+  cairo_surface_mark_dirty (surface);
+  shm_buffer_release (buffer);
+
+  update_budget (self);
+  self->window_frames++;
+  self->window_bytes += buffer->size;
+
+  g_signal_emit (self, signals[THUMBNAIL_READY], 0, capture->toplevel, surface);
+
+  g_hash_table_remove (self->captures, capture->toplevel);
+}
+
+
+static void
+frame_handle_failed (void                                  *data,
+                     struct phosh_private_screencopy_frame *frame)
+{
+  Capture *capture = data;
+
+  g_debug ("Capturing thumbnail of %p failed", capture->toplevel);
+  g_hash_table_remove (capture->thumbnailer->captures, capture->toplevel);
+}
+
+
+static const struct phosh_private_screencopy_frame_listener frame_listener = {
+  frame_handle_buffer,
+  frame_handle_ready,
+  frame_handle_failed,
+};
+
+
+static void
+phosh_thumbnailer_dispose (GObject *object)
+{
+  PhoshThumbnailer *self = PHOSH_THUMBNAILER (object);
+
+  g_clear_pointer (&self->captures, g_hash_table_destroy);
+  g_clear_pointer (&self->surfaces, g_hash_table_destroy);
+
+  if (self->buffers) {
+    for (guint i = 0; i < self->buffers->len; i++) {
+      /* Dropping the captures above released all buffers */
+      shm_buffer_free (g_ptr_array_index (self->buffers, i));
+    }
+    g_clear_pointer (&self->buffers, g_ptr_array_unref);
+  }
+
+  G_OBJECT_CLASS (phosh_thumbnailer_parent_class)->dispose (object);
+}
+
+
+static void
+phosh_thumbnailer_class_init (PhoshThumbnailerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = phosh_thumbnailer_dispose;
+
+  /**
+   * PhoshThumbnailer::thumbnail-ready:
+   * @self: The #PhoshThumbnailer emitting the signal
+   * @toplevel: The #PhoshToplevel that was captured
+   * @surface: The thumbnail as #cairo_surface_t
+   *
+   * Emitted when a new thumbnail of @toplevel is available. Use
+   * cairo_surface_reference() to keep @surface around. @surface
+   * doesn't share memory with the capture buffers but is updated in
+   * place by later captures of @toplevel of the same size.
+   */
+  signals[THUMBNAIL_READY] = g_signal_new ("thumbnail-ready",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+      NULL, G_TYPE_NONE, 2, PHOSH_TYPE_TOPLEVEL, G_TYPE_POINTER);
+}
+
+
+static void
+phosh_thumbnailer_init (PhoshThumbnailer *self)
+{
+  PhoshWayland *wl = phosh_wayland_get_default ();
+
+  if (wl) {
+    self->phosh_private = phosh_wayland_get_phosh_private (wl);
+    self->wl_shm = phosh_wayland_get_wl_shm (wl);
+  }
+
+  self->buffers = g_ptr_array_new ();
+  self->captures = g_hash_table_new_full (g_direct_hash,
+                                          g_direct_equal,
+                                          NULL,
+                                          (GDestroyNotify) capture_free);
+  self->surfaces = g_hash_table_new_full (g_direct_hash,
+                                          g_direct_equal,
+                                          g_object_unref,
+                                          (GDestroyNotify) cairo_surface_destroy);
+  self->window_start = g_get_monotonic_time ();
+}
+
+
+PhoshThumbnailer *
+phosh_thumbnailer_new (void)
+{
+  return g_object_new (PHOSH_TYPE_THUMBNAILER, NULL);
+}
+
+
+/**
+ * phosh_thumbnailer_is_supported:
+ * @self: The #PhoshThumbnailer
+ *
+ * Returns: %TRUE if the compositor can capture thumbnails
+ */
+gboolean
+phosh_thumbnailer_is_supported (PhoshThumbnailer *self)
+{
+  g_return_val_if_fail (PHOSH_IS_THUMBNAILER (self), FALSE);
+
+  return self->wl_shm && self->phosh_private &&
+    phosh_private_get_version (self->phosh_private) >= PHOSH_PRIVATE_GET_THUMBNAIL_SINCE_VERSION;
+}
+
+
+/**
+ * phosh_thumbnailer_capture:
+ * @self: The #PhoshThumbnailer
+ * @toplevel: The #PhoshToplevel to capture
+ * @max_width: The maximum width of the thumbnail in pixels
+ * @max_height: The maximum height of the thumbnail in pixels
+ *
+ * Requests a new thumbnail of @toplevel. The result is delivered via
+ * #PhoshThumbnailer::thumbnail-ready.
+ *
+ * Returns: %FALSE if no capture was started because thumbnails
+ * aren't supported, a capture of @toplevel is still in flight or the
+ * capture budget is exhausted.
+ */
+gboolean
+phosh_thumbnailer_capture (PhoshThumbnailer *self,
+                           PhoshToplevel    *toplevel,
+                           gint              max_width,
+                           gint              max_height)
+{
+  struct zwlr_foreign_toplevel_handle_v1 *handle;
+  Capture *capture;
+
+  g_return_val_if_fail (PHOSH_IS_THUMBNAILER (self), FALSE);
+  g_return_val_if_fail (PHOSH_IS_TOPLEVEL (toplevel), FALSE);
+  g_return_val_if_fail (max_width > 0 && max_height > 0, FALSE);
+
+  if (!phosh_thumbnailer_is_supported (self))
+    return FALSE;
+
+  if (g_hash_table_contains (self->captures, toplevel))
+    return FALSE;
+
+  update_budget (self);
+  if (self->window_frames + g_hash_table_size (self->captures) >= THUMBNAIL_MAX_FPS ||
+      self->window_bytes >= THUMBNAIL_MAX_BYTES_PER_SEC)
+    return FALSE;
+
+  handle = phosh_toplevel_get_handle (toplevel);
+  if (handle == NULL)
+    return FALSE;
+
+  capture = g_new0 (Capture, 1);
+  capture->thumbnailer = self;
+  capture->toplevel = g_object_ref (toplevel);
+  capture->frame = phosh_private_get_thumbnail (self->phosh_private,
+                                                handle,
+                                                max_width,
+                                                max_height);
+  phosh_private_screencopy_frame_add_listener (capture->frame, &frame_listener, capture);
+  g_hash_table_insert (self->captures, toplevel, capture);
+
+  return TRUE;
+}
+
+
+/**
+ * phosh_thumbnailer_stop:
+ * @self: The #PhoshThumbnailer
+ *
+ * Cancels all captures in flight and frees the buffer pool.
+ */
+void
+phosh_thumbnailer_stop (PhoshThumbnailer *self)
+{
+  g_return_if_fail (PHOSH_IS_THUMBNAILER (self));
+
+  g_hash_table_remove_all (self->captures);
+
+  for (guint i = self->buffers->len; i > 0; i--) {
+    ShmBuffer *buffer = g_ptr_array_index (self->buffers, i - 1);
+
+    if (!buffer->busy) {
+      g_ptr_array_remove_index_fast (self->buffers, i - 1);
+      shm_buffer_free (buffer);
+    }
+  }
+}
+
+
+/**
+ * phosh_thumbnailer_get_fps:
+ * @self: The #PhoshThumbnailer
+ *
+ * Returns: The captures per second during the last full second
+ */
+gdouble
+phosh_thumbnailer_get_fps (PhoshThumbnailer *self)
+{
+  g_return_val_if_fail (PHOSH_IS_THUMBNAILER (self), 0.0);
+
+  update_budget (self);
+  return self->fps;
+}
+
+
+/**
+ * phosh_thumbnailer_get_bytes_per_capture:
+ * @self: The #PhoshThumbnailer
+ *
+ * Returns: The average size of a capture during the last full second
+ */
+gsize
+phosh_thumbnailer_get_bytes_per_capture (PhoshThumbnailer *self)
+{
+  g_return_val_if_fail (PHOSH_IS_THUMBNAILER (self), 0);
+
+  update_budget (self);
+  return self->bytes_per_capture;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#pragma once
+
+#include "toplevel.h"
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define PHOSH_TYPE_THUMBNAILER (phosh_thumbnailer_get_type())
+
+G_DECLARE_FINAL_TYPE (PhoshThumbnailer,
+                      phosh_thumbnailer,
+                      PHOSH,
+                      THUMBNAILER,
+                      GObject)
+
+PhoshThumbnailer *phosh_thumbnailer_new                   (void);
+gboolean          phosh_thumbnailer_is_supported          (PhoshThumbnailer *self);
+gboolean          phosh_thumbnailer_capture               (PhoshThumbnailer *self,
+                                                           PhoshToplevel    *toplevel,
+                                                           gint              max_width,
+                                                           gint              max_height);
+void              phosh_thumbnailer_stop                  (PhoshThumbnailer *self);
+gdouble           phosh_thumbnailer_get_fps               (PhoshThumbnailer *self);
+gsize             phosh_thumbnailer_get_bytes_per_capture (PhoshThumbnailer *self);
+
+G_END_DECLS
@@ -8,6 +8,7 @@
 
 #include "toplevel-manager.h"
 #include "toplevel.h"
+#include "phosh-enums.h"
 #include "phosh-wayland.h"
 #include "shell.h"
 #include "util.h"
@@ -20,6 +21,9 @@
  * @short_description: Tracks and interacts with toplevel surfaces
  * for window management purposes.
  * @Title: PhoshToplevelManager
+ *
+ * The manager is a #GListModel of the configured #PhoshToplevel s in
+ * the order they appeared.
  */
 
 enum {
@@ -39,9 +43,14 @@ static guint signals[N_SIGNALS] = { 0 };
 struct _PhoshToplevelManager {
   GObject parent;
   GPtrArray *toplevels;
+  /* Set of the toplevels in @toplevels */
+  GHashTable *known;
 };
 
-G_DEFINE_TYPE (PhoshToplevelManager, phosh_toplevel_manager, G_TYPE_OBJECT);
+static void list_iface_init (GListModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (PhoshToplevelManager, phosh_toplevel_manager, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, list_iface_init));
 
 static void
 phosh_toplevel_set_property (GObject *object,
@@ -71,16 +80,67 @@ phosh_toplevel_get_property (GObject *object,
   }
 }
 
+static GType
+list_get_item_type (GListModel *list)
+{
+  return PHOSH_TYPE_TOPLEVEL;
+}
+
+
+static gpointer
+list_get_item (GListModel *list, guint position)
+{
+  PhoshToplevelManager *self = PHOSH_TOPLEVEL_MANAGER (list);
+
+  if (self->toplevels == NULL || position >= self->toplevels->len)
+    return NULL;
+
+  return g_object_ref (g_ptr_array_index (self->toplevels, position));
+}
+
+
+static guint
+list_get_n_items (GListModel *list)
+{
+  PhoshToplevelManager *self = PHOSH_TOPLEVEL_MANAGER (list);
+
+  return self->toplevels ? self->toplevels->len : 0;
+}
+
+
+static void
+list_iface_init (GListModelInterface *iface)
+{
+  iface->get_item_type = list_get_item_type;
+  iface->get_item = list_get_item;
+  iface->get_n_items = list_get_n_items;
+}
+
+
 static void
 on_toplevel_closed (PhoshToplevelManager *self, PhoshToplevel *toplevel)
 {
+  guint position;
+
   g_return_if_fail (PHOSH_IS_TOPLEVEL_MANAGER (self));
   g_return_if_fail (PHOSH_IS_TOPLEVEL (toplevel));
   g_return_if_fail (self->toplevels);
 
-  g_assert_true(g_ptr_array_remove (self->toplevels, toplevel));
+  /* Closed before it was ever configured, drop the ref from creation */
+  if (!g_hash_table_remove (self->known, toplevel)) {
+    g_object_unref (toplevel);
+    return;
+  }
+
+  /* Only happens on close so a linear search is fine */
+  g_return_if_fail (g_ptr_array_find (self->toplevels, toplevel, &position));
+  /* Keep it alive until listeners know it's gone */
+  g_ptr_array_steal_index (self->toplevels, position);
 
+  g_list_model_items_changed (G_LIST_MODEL (self), position, 1, 0);
   g_object_notify_by_pspec (G_OBJECT (self), props[PROP_NUM_TOPLEVELS]);
+
+  g_object_unref (toplevel);
 }
 
 
@@ -97,16 +157,31 @@ on_toplevel_configured (PhoshToplevelManager *self, GParamSpec *pspec, PhoshTopl
   if (!configured)
     return;
 
-  if (g_ptr_array_find (self->toplevels, toplevel, NULL)) {
-    g_signal_emit (self, signals[SIGNAL_TOPLEVEL_CHANGED], 0, toplevel);
-  } else {
+  if (!g_hash_table_contains (self->known, toplevel)) {
+    g_hash_table_add (self->known, toplevel);
     g_ptr_array_add (self->toplevels, toplevel);
+    g_list_model_items_changed (G_LIST_MODEL (self), self->toplevels->len - 1, 0, 1);
     g_signal_emit (self, signals[SIGNAL_TOPLEVEL_ADDED], 0, toplevel);
     g_object_notify_by_pspec (G_OBJECT (self), props[PROP_NUM_TOPLEVELS]);
   }
 }
 
 
+static void
+on_toplevel_changed (PhoshToplevelManager *self,
+                     PhoshToplevelChanges  changes,
+                     PhoshToplevel        *toplevel)
+{
+  g_return_if_fail (PHOSH_IS_TOPLEVEL_MANAGER (self));
+  g_return_if_fail (PHOSH_IS_TOPLEVEL (toplevel));
+
+  if (self->known == NULL || !g_hash_table_contains (self->known, toplevel))
+    return;
+
+  g_signal_emit (self, signals[SIGNAL_TOPLEVEL_CHANGED], 0, toplevel, changes);
+}
+
+
 static void
 handle_zwlr_foreign_toplevel_manager_toplevel(
   void *data,
@@ -120,6 +195,7 @@ handle_zwlr_foreign_toplevel_manager_toplevel(
 
   g_signal_connect_swapped (toplevel, "closed", G_CALLBACK (on_toplevel_closed), self);
   g_signal_connect_swapped (toplevel, "notify::configured", G_CALLBACK (on_toplevel_configured), self);
+  g_signal_connect_swapped (toplevel, "changed", G_CALLBACK (on_toplevel_changed), self);
 
   g_debug ("Got toplevel %p", toplevel);
 }
@@ -144,6 +220,8 @@ static void
 phosh_toplevel_manager_dispose (GObject *object)
 {
   PhoshToplevelManager *self = PHOSH_TOPLEVEL_MANAGER (object);
+
+  g_clear_pointer (&self->known, g_hash_table_destroy);
   if (self->toplevels) {
     g_ptr_array_free(self->toplevels, TRUE);
     self->toplevels = NULL;
@@ -188,13 +266,15 @@ phosh_toplevel_manager_class_init (PhoshToplevelManagerClass *klass)
    * PhoshToplevelManager::toplevel-changed:
    * @manager: The #PhoshToplevelManager emitting the signal.
    * @toplevel: The #PhoshToplevel that changed properties.
+   * @changes: The #PhoshToplevelChanges
    *
-   * Emitted whenever a toplevel has changed properties.
+   * Emitted whenever a toplevel has changed properties. Changes are
+   * batched per `done` event of the toplevel.
    */
   signals[SIGNAL_TOPLEVEL_CHANGED] = g_signal_new (
     "toplevel-changed",
     G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
-    NULL, G_TYPE_NONE, 1, PHOSH_TYPE_TOPLEVEL);
+    NULL, G_TYPE_NONE, 2, PHOSH_TYPE_TOPLEVEL, PHOSH_TYPE_TOPLEVEL_CHANGES);
 }
 
 
@@ -206,6 +286,7 @@ phosh_toplevel_manager_init (PhoshToplevelManager *self)
      phosh_wayland_get_default ());
 
   self->toplevels = g_ptr_array_new_with_free_func ((GDestroyNotify) (g_object_unref));
+  self->known = g_hash_table_new (g_direct_hash, g_direct_equal);
 
   if (!toplevel_manager) {
     g_warning ("Skipping app list due to missing wlr-foreign-toplevel-management protocol extension");
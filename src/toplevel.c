@@ -7,6 +7,7 @@
 #define G_LOG_DOMAIN "phosh-toplevel"
 
 #include "toplevel.h"
+#include "phosh-enums.h"
 #include "phosh-wayland.h"
 #include "shell.h"
 #include "util.h"
@@ -17,6 +18,10 @@
  * SECTION:phosh-toplevel
  * @short_description: Represents a single toplevel surface.
  * @Title: PhoshToplevel
+ *
+ * Property changes are batched until the compositor sends `done`. Then
+ * property notifications are emitted and #PhoshToplevel::changed tells
+ * which properties changed.
  */
 
 enum {
@@ -32,6 +37,7 @@ static GParamSpec *props[PHOSH_TOPLEVEL_PROP_LAST_PROP];
 
 enum {
   SIGNAL_CLOSED,
+  SIGNAL_CHANGED,
   N_SIGNALS
 };
 static guint signals[N_SIGNALS] = { 0 };
@@ -42,6 +48,9 @@ struct _PhoshToplevel {
   gboolean configured, activated;
   gchar *title;
   gchar *app_id;
+
+  /* Changes since the last done event */
+  PhoshToplevelChanges pending;
 };
 
 G_DEFINE_TYPE (PhoshToplevel, phosh_toplevel, G_TYPE_OBJECT);
@@ -55,10 +64,12 @@ handle_zwlr_foreign_toplevel_handle_title(
 {
   PhoshToplevel *self = data;
   g_return_if_fail (PHOSH_IS_TOPLEVEL (self));
+  g_debug ("%p: Got title %s", zwlr_foreign_toplevel_handle_v1, title);
+  if (g_strcmp0 (self->title, title) == 0)
+    return;
   g_free (self->title);
   self->title = g_strdup (title);
-  g_debug ("%p: Got title %s", zwlr_foreign_toplevel_handle_v1, title);
-  g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_TOPLEVEL_PROP_TITLE]);
+  self->pending |= PHOSH_TOPLEVEL_CHANGES_TITLE;
 }
 
 
@@ -70,10 +81,12 @@ handle_zwlr_foreign_toplevel_handle_app_id(
 {
   PhoshToplevel *self = data;
   g_return_if_fail (PHOSH_IS_TOPLEVEL (self));
+  g_debug ("%p: Got app_id %s", zwlr_foreign_toplevel_handle_v1, app_id);
+  if (g_strcmp0 (self->app_id, app_id) == 0)
+    return;
   g_free (self->app_id);
   self->app_id = g_strdup (app_id);
-  g_debug ("%p: Got app_id %s", zwlr_foreign_toplevel_handle_v1, app_id);
-  g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_TOPLEVEL_PROP_APP_ID]);
+  self->pending |= PHOSH_TOPLEVEL_CHANGES_APP_ID;
 }
 
 
@@ -116,7 +129,7 @@ handle_zwlr_foreign_toplevel_handle_state(
 
   if (self->activated != activated) {
     self->activated = activated;
-    g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_TOPLEVEL_PROP_ACTIVATED]);
+    self->pending |= PHOSH_TOPLEVEL_CHANGES_ACTIVATED;
   }
 }
 
@@ -127,9 +140,31 @@ handle_zwlr_foreign_toplevel_handle_done(
   struct zwlr_foreign_toplevel_handle_v1 *zwlr_foreign_toplevel_handle_v1)
 {
   PhoshToplevel *self = data;
+  PhoshToplevelChanges changes;
+  gboolean was_configured;
+
   g_return_if_fail (PHOSH_IS_TOPLEVEL (self));
-  self->configured = TRUE;
-  g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_TOPLEVEL_PROP_CONFIGURED]);
+
+  was_configured = self->configured;
+  changes = self->pending;
+  self->pending = PHOSH_TOPLEVEL_CHANGES_NONE;
+
+  g_object_freeze_notify (G_OBJECT (self));
+  if (changes & PHOSH_TOPLEVEL_CHANGES_TITLE)
+    g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_TOPLEVEL_PROP_TITLE]);
+  if (changes & PHOSH_TOPLEVEL_CHANGES_APP_ID)
+    g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_TOPLEVEL_PROP_APP_ID]);
+  if (changes & PHOSH_TOPLEVEL_CHANGES_ACTIVATED)
+    g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_TOPLEVEL_PROP_ACTIVATED]);
+  if (!self->configured) {
+    self->configured = TRUE;
+    g_object_notify_by_pspec (G_OBJECT (self), props[PHOSH_TOPLEVEL_PROP_CONFIGURED]);
+  }
+  g_object_thaw_notify (G_OBJECT (self));
+
+  /* The initial state is announced via configured */
+  if (was_configured && changes != PHOSH_TOPLEVEL_CHANGES_NONE)
+    g_signal_emit (self, signals[SIGNAL_CHANGED], 0, changes);
 }
 
 
@@ -301,6 +336,18 @@ phosh_toplevel_class_init (PhoshToplevelClass *klass)
     "closed",
     G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
     NULL, G_TYPE_NONE, 0);
+  /**
+   * PhoshToplevel::changed:
+   * @toplevel: The #PhoshToplevel emitting the signal.
+   * @changes: The #PhoshToplevelChanges since the last emission
+   *
+   * Emitted once per `done` event from the compositor if any
+   * properties of the configured toplevel changed.
+   */
+  signals[SIGNAL_CHANGED] = g_signal_new (
+    "changed",
+    G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+    NULL, G_TYPE_NONE, 1, PHOSH_TYPE_TOPLEVEL_CHANGES);
 }
 
 
@@ -329,6 +376,13 @@ phosh_toplevel_get_app_id (PhoshToplevel *self) {
 }
 
 
+struct zwlr_foreign_toplevel_handle_v1 *
+phosh_toplevel_get_handle (PhoshToplevel *self) {
+  g_return_val_if_fail (PHOSH_IS_TOPLEVEL (self), NULL);
+  return self->handle;
+}
+
+
 gboolean
 phosh_toplevel_is_configured (PhoshToplevel *self) {
   g_return_val_if_fail (PHOSH_IS_TOPLEVEL (self), FALSE);
@@ -9,6 +9,23 @@
 #include "wlr-foreign-toplevel-management-unstable-v1-client-protocol.h"
 #include <gtk/gtk.h>
 
+/**
+ * PhoshToplevelChanges:
+ * @PHOSH_TOPLEVEL_CHANGES_NONE: Nothing changed
+ * @PHOSH_TOPLEVEL_CHANGES_TITLE: The title changed
+ * @PHOSH_TOPLEVEL_CHANGES_APP_ID: The app id changed
+ * @PHOSH_TOPLEVEL_CHANGES_ACTIVATED: The activation state changed
+ *
+ * Which properties of a #PhoshToplevel changed
+ */
+typedef enum /*< flags,prefix=PHOSH >*/
+{
+  PHOSH_TOPLEVEL_CHANGES_NONE      = 0,      /*< nick=none >*/
+  PHOSH_TOPLEVEL_CHANGES_TITLE     = 1 << 0, /*< nick=title >*/
+  PHOSH_TOPLEVEL_CHANGES_APP_ID    = 1 << 1, /*< nick=app-id >*/
+  PHOSH_TOPLEVEL_CHANGES_ACTIVATED = 1 << 2, /*< nick=activated >*/
+} PhoshToplevelChanges;
+
 #define PHOSH_TYPE_TOPLEVEL (phosh_toplevel_get_type())
 
 G_DECLARE_FINAL_TYPE (PhoshToplevel,
@@ -20,6 +37,7 @@ G_DECLARE_FINAL_TYPE (PhoshToplevel,
 PhoshToplevel *phosh_toplevel_new_from_handle (struct zwlr_foreign_toplevel_handle_v1 *handle);
 const gchar *phosh_toplevel_get_title (PhoshToplevel *self);
 const gchar *phosh_toplevel_get_app_id (PhoshToplevel *self);
+struct zwlr_foreign_toplevel_handle_v1 *phosh_toplevel_get_handle (PhoshToplevel *self);
 gboolean phosh_toplevel_is_configured (PhoshToplevel *self);
 gboolean phosh_toplevel_is_activated (PhoshToplevel *self);
 void phosh_toplevel_activate (PhoshToplevel *self, struct wl_seat *seat);
@@ -8,8 +8,8 @@
 
 #include "config.h"
 
+#include "shell.h"
 #include "wwaninfo.h"
-#include "wwan/phosh-wwan-mm.h"
 
 #define WWAN_INFO_DEFAULT_ICON_SIZE 24
 
@@ -30,7 +30,7 @@ struct _PhoshWWanInfo
 {
   GtkBox parent;
 
-  PhoshWWanMM *wwan;
+  PhoshWWan *wwan;
   gboolean show_detail;
 };
 
@@ -91,7 +91,7 @@ signal_quality_descriptive(guint quality)
 
 
 static void
-update_icon_data(PhoshWWanInfo *self, GParamSpec *psepc, PhoshWWanMM *wwan)
+update_icon_data(PhoshWWanInfo *self, GParamSpec *psepc, PhoshWWan *wwan)
 {
   GtkWidget *access_tec_widget;
   guint quality;
@@ -100,6 +100,13 @@ update_icon_data(PhoshWWanInfo *self, GParamSpec *psepc, PhoshWWanMM *wwan)
   gboolean visible;
 
   g_return_if_fail (PHOSH_IS_WWAN_INFO (self));
+
+  /* The shell creates the wwan after startup */
+  if (self->wwan == NULL) {
+    gtk_widget_hide (GTK_WIDGET (self));
+    return;
+  }
+
   visible = phosh_wwan_is_present (PHOSH_WWAN (self->wwan));
   g_debug ("Updating wwan icon, shown: %d", visible);
   gtk_widget_set_visible (GTK_WIDGET (self), visible);
@@ -152,9 +159,8 @@ on_idle (PhoshWWanInfo *self)
 
 
 static void
-phosh_wwan_info_constructed (GObject *object)
+on_shell_wwan_changed (PhoshWWanInfo *self, GParamSpec *pspec, PhoshShell *shell)
 {
-  PhoshWWanInfo *self = PHOSH_WWAN_INFO (object);
   GStrv signals = (char *[]) {"notify::signal-quality",
                               "notify::access-tec",
                               "notify::unlocked",
@@ -162,16 +168,36 @@ phosh_wwan_info_constructed (GObject *object)
                               "notify::present",
                               NULL,
   };
+  PhoshWWan *wwan = phosh_shell_get_wwan (shell);
 
-  G_OBJECT_CLASS (phosh_wwan_info_parent_class)->constructed (object);
+  if (wwan == NULL || wwan == self->wwan)
+    return;
 
-  self->wwan = phosh_wwan_mm_new();
+  g_return_if_fail (self->wwan == NULL);
+  self->wwan = g_object_ref (wwan);
 
   for (int i = 0; i < g_strv_length(signals); i++) {
     g_signal_connect_swapped (self->wwan, signals[i],
                               G_CALLBACK (update_icon_data),
                               self);
   }
+  update_icon_data (self, NULL, NULL);
+}
+
+
+static void
+phosh_wwan_info_constructed (GObject *object)
+{
+  PhoshWWanInfo *self = PHOSH_WWAN_INFO (object);
+  PhoshShell *shell = phosh_shell_get_default ();
+
+  G_OBJECT_CLASS (phosh_wwan_info_parent_class)->constructed (object);
+
+  g_signal_connect_object (shell, "notify::wwan",
+                           G_CALLBACK (on_shell_wwan_changed),
+                           self,
+                           G_CONNECT_SWAPPED);
+  on_shell_wwan_changed (self, NULL, shell);
   g_idle_add ((GSourceFunc) on_idle, self);
 
   phosh_status_icon_set_info (PHOSH_STATUS_ICON (self), "Cellular");
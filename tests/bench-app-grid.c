@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ *
+ * Benchmark PhoshAppListModel and PhoshAppGrid against a corpus of
+ * synthetic desktop files and write the results as JSON.
+ */
+
+#include "app-list-model.c"
+#include "app-grid.h"
+#include "app-grid-button.h"
+
+#include <glib/gstdio.h>
+
+#include <stdlib.h>
+
+/* How long the app dirs need to be quiet before we rebuild */
+#define MONITOR_SETTLE_MS 600
+#define MONITOR_TIMEOUT_S 10
+
+typedef struct {
+  guint created;
+  guint destroyed;
+} ButtonStats;
+
+static gint   n_apps = 50;
+static gchar *output;
+
+static GOptionEntry entries[] = {
+  { "apps", 'a', 0, G_OPTION_ARG_INT, &n_apps, "Number of synthetic apps", "APPS" },
+  { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Write JSON results to FILE", "FILE" },
+  { NULL }
+};
+
+static const char * const words[] = {
+  "Calculator", "Editor", "Viewer", "Player", "Browser", "Terminal", "Monitor", "Chat",
+};
+
+static const char * const categories[] = {
+  "Utility", "Development", "Graphics", "AudioVideo", "Network", "System", "Office", "Game",
+};
+
+/* Typed char by char and deleted again */
+static const char * const queries[] = {
+  "synthetic", "app 12", "calc", "network", "xyzzy",
+};
+
+
+static gint
+cmp_gint64 (gconstpointer a, gconstpointer b)
+{
+  gint64 va = *(const gint64 *) a, vb = *(const gint64 *) b;
+
+  return (va > vb) - (va < vb);
+}
+
+
+static void
+write_desktop_file (const char *dir, int i, const char *name)
+{
+  g_autoptr (GError) err = NULL;
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *contents = NULL;
+  const char *word = words[i % G_N_ELEMENTS (words)];
+
+  path = g_strdup_printf ("%s/sm.puri.Phosh.Bench%d.desktop", dir, i);
+  contents = g_strdup_printf ("[Desktop Entry]\n"
+                              "Type=Application\n"
+                              "Name=%s\n"
+                              "GenericName=%s\n"
+                              "Comment=Synthetic app %d to benchmark the app grid\n"
+                              "Keywords=bench;synthetic;%s;\n"
+                              "Categories=%s;\n"
+                              "Exec=synthetic-app-%d %%U\n"
+                              "Icon=application-x-executable\n",
+                              name, word, i, word,
+                              categories[i % G_N_ELEMENTS (categories)], i);
+
+  if (!g_file_set_contents (path, contents, -1, &err))
+    g_error ("Failed to write %s: %s", path, err->message);
+}
+
+
+static void
+write_corpus (const char *dir, int n)
+{
+  for (int i = 0; i < n; i++) {
+    g_autofree gchar *name = g_strdup_printf ("Synthetic App %d", i);
+
+    write_desktop_file (dir, i, name);
+  }
+}
+
+
+/* Rename every tenth app, drop one and add one */
+static void
+change_corpus (const char *dir, int n)
+{
+  g_autofree gchar *removed = NULL;
+
+  for (int i = 0; i < n; i += 10) {
+    g_autofree gchar *name = g_strdup_printf ("Renamed App %d", i);
+
+    write_desktop_file (dir, i, name);
+  }
+
+  removed = g_strdup_printf ("%s/sm.puri.Phosh.Bench%d.desktop", dir, n - 1);
+  g_unlink (removed);
+  write_desktop_file (dir, n, "Synthetic App New");
+}
+
+
+static void
+rmdir_recursive (const char *path)
+{
+  g_autoptr (GDir) dir = g_dir_open (path, 0, NULL);
+  const char *name;
+
+  while (dir && (name = g_dir_read_name (dir))) {
+    g_autofree gchar *child = g_build_filename (path, name, NULL);
+
+    if (g_file_test (child, G_FILE_TEST_IS_DIR))
+      rmdir_recursive (child);
+    else
+      g_unlink (child);
+  }
+  g_rmdir (path);
+}
+
+
+static void
+on_button_finalized (gpointer data, GObject *where_the_object_was)
+{
+  ButtonStats *stats = data;
+
+  stats->destroyed++;
+}
+
+
+/* Every button gets put into the flow box once */
+static gboolean
+on_parent_set_hook (GSignalInvocationHint *ihint,
+                    guint                  n_param_values,
+                    const GValue          *param_values,
+                    gpointer               data)
+{
+  ButtonStats *stats = data;
+  GObject *widget = g_value_get_object (&param_values[0]);
+
+  if (!PHOSH_IS_APP_GRID_BUTTON (widget) || g_object_get_data (widget, "bench-counted"))
+    return TRUE;
+
+  g_object_set_data (widget, "bench-counted", GINT_TO_POINTER (TRUE));
+  g_object_weak_ref (widget, on_button_finalized, stats);
+  stats->created++;
+
+  return TRUE;
+}
+
+
+static void
+drain_events (void)
+{
+  while (gtk_events_pending ())
+    gtk_main_iteration_do (FALSE);
+}
+
+
+static void
+find_search_entry (GtkWidget *widget, gpointer data)
+{
+  GtkWidget **entry = data;
+
+  if (*entry)
+    return;
+
+  if (GTK_IS_SEARCH_ENTRY (widget))
+    *entry = widget;
+  else if (GTK_IS_CONTAINER (widget))
+    gtk_container_forall (GTK_CONTAINER (widget), find_search_entry, data);
+}
+
+
+static void
+on_monitor_changed (GAppInfoMonitor *monitor, gint64 *last_change)
+{
+  *last_change = g_get_monotonic_time ();
+}
+
+
+/* Wait until the desktop file changes were picked up */
+static gboolean
+wait_for_monitor (GAppInfoMonitor *monitor)
+{
+  gint64 last_change = 0;
+  gint64 start = g_get_monotonic_time ();
+  gulong id;
+
+  id = g_signal_connect (monitor, "changed", G_CALLBACK (on_monitor_changed), &last_change);
+  while (g_get_monotonic_time () - start < MONITOR_TIMEOUT_S * G_USEC_PER_SEC) {
+    gint64 now = g_get_monotonic_time ();
+
+    if (last_change && now - last_change > MONITOR_SETTLE_MS * 1000)
+      break;
+    g_main_context_iteration (NULL, FALSE);
+    g_usleep (1000);
+  }
+  g_signal_handler_disconnect (monitor, id);
+
+  return last_change != 0;
+}
+
+
+static gint64
+rebuild_model (PhoshAppListModel *model)
+{
+  PhoshAppListModelPrivate *priv = phosh_app_list_model_get_instance_private (model);
+  gint64 start;
+
+  if (priv->debounce) {
+    g_source_remove (priv->debounce);
+    priv->debounce = 0;
+  }
+
+  start = g_get_monotonic_time ();
+  items_changed (model);
+  drain_events ();
+
+  return g_get_monotonic_time () - start;
+}
+
+
+static void
+append_buttons (GString *json, const char *name, ButtonStats *now, ButtonStats *before)
+{
+  g_string_append_printf (json, "    \"%s\": { \"created\": %u, \"destroyed\": %u }",
+                          name,
+                          now->created - before->created,
+                          now->destroyed - before->destroyed);
+}
+
+
+static int
+run_bench (const char *apps_dir)
+{
+  g_autoptr (GError) err = NULL;
+  g_autoptr (GString) json = g_string_new (NULL);
+  g_autoptr (GArray) keystrokes = g_array_new (FALSE, FALSE, sizeof (gint64));
+  PhoshAppListModel *model;
+  PhoshAppListModelPrivate *priv;
+  GtkWidget *window, *grid, *search = NULL;
+  ButtonStats stats = { 0 }, after_load, after_rebuild, after_search;
+  gint64 start, load_us, grid_us, rebuild_us;
+  guint hook_id, n_loaded, n_rebuilt;
+  gint64 *lat;
+  int ret = 0;
+
+  hook_id = g_signal_add_emission_hook (g_signal_lookup ("parent-set", GTK_TYPE_WIDGET), 0,
+                                        on_parent_set_hook, &stats, NULL);
+
+  /* Initial load, without the debounce */
+  model = phosh_app_list_model_get_default ();
+  priv = phosh_app_list_model_get_instance_private (model);
+  g_signal_handlers_block_by_func (priv->monitor, on_monitor_changed_cb, model);
+  load_us = rebuild_model (model);
+  n_loaded = g_list_model_get_n_items (G_LIST_MODEL (model));
+
+  /* Populate the grid */
+  window = gtk_offscreen_window_new ();
+  gtk_window_set_default_size (GTK_WINDOW (window), 360, 720);
+  start = g_get_monotonic_time ();
+  grid = phosh_app_grid_new ();
+  gtk_container_add (GTK_CONTAINER (window), grid);
+  gtk_widget_show_all (window);
+  drain_events ();
+  grid_us = g_get_monotonic_time () - start;
+  after_load = stats;
+
+  /* Rebuild on app changes */
+  change_corpus (apps_dir, n_apps);
+  if (!wait_for_monitor (priv->monitor))
+    g_printerr ("App info monitor didn't notice changes\n");
+  rebuild_us = rebuild_model (model);
+  n_rebuilt = g_list_model_get_n_items (G_LIST_MODEL (model));
+  after_rebuild = stats;
+
+  /* Type into the search */
+  find_search_entry (grid, &search);
+  if (search == NULL) {
+    g_printerr ("Search entry not found\n");
+    ret = 1;
+    goto out;
+  }
+  for (guint i = 0; i < G_N_ELEMENTS (queries); i++) {
+    gsize len = strlen (queries[i]);
+
+    for (gsize j = 1; j <= 2 * len; j++) {
+      g_autofree gchar *text = g_strndup (queries[i], j <= len ? j : 2 * len - j);
+      gint64 elapsed;
+
+      start = g_get_monotonic_time ();
+      gtk_entry_set_text (GTK_ENTRY (search), text);
+      drain_events ();
+      elapsed = g_get_monotonic_time () - start;
+      g_array_append_val (keystrokes, elapsed);
+    }
+  }
+  after_search = stats;
+  lat = (gint64 *) keystrokes->data;
+  qsort (lat, keystrokes->len, sizeof (gint64), cmp_gint64);
+
+  g_string_append (json, "{\n");
+  g_string_append_printf (json, "  \"apps\": %d,\n", n_apps);
+  g_string_append_printf (json, "  \"load\": { \"us\": %" G_GINT64_FORMAT ", \"items\": %u },\n",
+                          load_us, n_loaded);
+  g_string_append_printf (json, "  \"grid\": { \"us\": %" G_GINT64_FORMAT " },\n", grid_us);
+  g_string_append_printf (json, "  \"rebuild\": { \"us\": %" G_GINT64_FORMAT ", \"items\": %u },\n",
+                          rebuild_us, n_rebuilt);
+  g_string_append_printf (json,
+                          "  \"keystroke\": { \"count\": %u, \"p50_us\": %" G_GINT64_FORMAT
+                          ", \"p90_us\": %" G_GINT64_FORMAT ", \"max_us\": %" G_GINT64_FORMAT " },\n",
+                          keystrokes->len,
+                          lat[(keystrokes->len - 1) * 50 / 100],
+                          lat[(keystrokes->len - 1) * 90 / 100],
+                          lat[keystrokes->len - 1]);
+  g_string_append (json, "  \"buttons\": {\n");
+  append_buttons (json, "load", &after_load, &(ButtonStats) { 0 });
+  g_string_append (json, ",\n");
+  append_buttons (json, "rebuild", &after_rebuild, &after_load);
+  g_string_append (json, ",\n");
+  append_buttons (json, "search", &after_search, &after_rebuild);
+  g_string_append (json, "\n  }\n}\n");
+
+  if (output && !g_file_set_contents (output, json->str, json->len, &err)) {
+    g_printerr ("Failed to write %s: %s\n", output, err->message);
+    ret = 1;
+    goto out;
+  }
+  g_print ("%s", json->str);
+
+ out:
+  g_signal_remove_emission_hook (g_signal_lookup ("parent-set", GTK_TYPE_WIDGET), hook_id);
+  gtk_widget_destroy (window);
+
+  return ret;
+}
+
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr (GOptionContext) opt_context = NULL;
+  g_autoptr (GError) err = NULL;
+  g_autofree gchar *sandbox = NULL;
+  g_autofree gchar *data_dir = NULL;
+  g_autofree gchar *apps_dir = NULL;
+  g_autofree gchar *data_dirs = NULL;
+  const char *old_data_dirs;
+  int ret;
+
+  opt_context = g_option_context_new ("- benchmark the app grid");
+  g_option_context_add_main_entries (opt_context, entries, NULL);
+  if (!g_option_context_parse (opt_context, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    return 1;
+  }
+  if (n_apps < 1) {
+    g_printerr ("Need at least one app\n");
+    return 1;
+  }
+
+  /* The corpus must be in place before GIO looks at the app dirs */
+  sandbox = g_dir_make_tmp ("phosh-bench-app-grid-XXXXXX", &err);
+  if (!sandbox) {
+    g_printerr ("Failed to create sandbox: %s\n", err->message);
+    return 1;
+  }
+  data_dir = g_build_filename (sandbox, "share", NULL);
+  apps_dir = g_build_filename (data_dir, "applications", NULL);
+  g_mkdir_with_parents (apps_dir, 0700);
+  write_corpus (apps_dir, n_apps);
+  g_setenv ("XDG_DATA_HOME", data_dir, TRUE);
+  /* Keep the system dirs so icon themes are found, icon lookup is
+     part of populating the grid */
+  old_data_dirs = g_getenv ("XDG_DATA_DIRS");
+  if (old_data_dirs == NULL || *old_data_dirs == '\0')
+    old_data_dirs = "/usr/local/share:/usr/share";
+  data_dirs = g_strjoin (G_SEARCHPATH_SEPARATOR_S, data_dir, old_data_dirs, NULL);
+  g_setenv ("XDG_DATA_DIRS", data_dirs, TRUE);
+
+  if (gtk_init_check (&argc, &argv)) {
+    ret = run_bench (apps_dir);
+  } else {
+    g_printerr ("No display, skipping\n");
+    ret = 77;
+  }
+
+  rmdir_recursive (sandbox);
+
+  return ret;
+}
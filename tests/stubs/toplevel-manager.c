@@ -6,6 +6,7 @@
 
 #include "toplevel-manager.h"
 #include "toplevel.h"
+#include "phosh-enums.h"
 
 
 enum {
@@ -19,7 +20,40 @@ struct _PhoshToplevelManager {
   GObject parent;
 };
 
-G_DEFINE_TYPE (PhoshToplevelManager, phosh_toplevel_manager, G_TYPE_OBJECT);
+static void list_iface_init (GListModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (PhoshToplevelManager, phosh_toplevel_manager, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, list_iface_init));
+
+
+static GType
+list_get_item_type (GListModel *list)
+{
+  return PHOSH_TYPE_TOPLEVEL;
+}
+
+
+static gpointer
+list_get_item (GListModel *list, guint position)
+{
+  return NULL;
+}
+
+
+static guint
+list_get_n_items (GListModel *list)
+{
+  return 0;
+}
+
+
+static void
+list_iface_init (GListModelInterface *iface)
+{
+  iface->get_item_type = list_get_item_type;
+  iface->get_item = list_get_item;
+  iface->get_n_items = list_get_n_items;
+}
 
 
 static void
@@ -29,10 +63,10 @@ phosh_toplevel_manager_class_init (PhoshToplevelManagerClass *klass)
     "toplevel-added",
     G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
     NULL, G_TYPE_NONE, 1, PHOSH_TYPE_TOPLEVEL);
-  signals[SIGNAL_TOPLEVEL_ADDED] = g_signal_new (
+  signals[SIGNAL_TOPLEVEL_CHANGED] = g_signal_new (
     "toplevel-changed",
     G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
-    NULL, G_TYPE_NONE, 1, PHOSH_TYPE_TOPLEVEL);
+    NULL, G_TYPE_NONE, 2, PHOSH_TYPE_TOPLEVEL, PHOSH_TYPE_TOPLEVEL_CHANGES);
 }
 
 
@@ -17,6 +17,31 @@ test_phosh_activity_new(void)
 }
 
 
+static void
+test_phosh_activity_thumbnail (void)
+{
+  PhoshActivity *activity = PHOSH_ACTIVITY (phosh_activity_new ("com.example.foo", "bar"));
+  cairo_surface_t *surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 32, 64);
+
+  phosh_activity_set_thumbnail (activity, surface);
+  /* The activity holds a reference */
+  g_assert_cmpint (cairo_surface_get_reference_count (surface), ==, 2);
+
+  /* Surfaces updated in place are set again */
+  phosh_activity_set_thumbnail (activity, surface);
+  g_assert_cmpint (cairo_surface_get_reference_count (surface), ==, 2);
+
+  phosh_activity_set_thumbnail (activity, NULL);
+  g_assert_cmpint (cairo_surface_get_reference_count (surface), ==, 1);
+
+  phosh_activity_set_thumbnail (activity, surface);
+  gtk_widget_destroy (GTK_WIDGET (activity));
+  g_assert_cmpint (cairo_surface_get_reference_count (surface), ==, 1);
+
+  cairo_surface_destroy (surface);
+}
+
+
 gint
 main (gint argc,
       gchar *argv[])
@@ -24,5 +49,6 @@ main (gint argc,
   gtk_test_init (&argc, &argv, NULL);
 
   g_test_add_func("/phosh/activity/new", test_phosh_activity_new);
+  g_test_add_func("/phosh/activity/thumbnail", test_phosh_activity_thumbnail);
   return g_test_run();
 }
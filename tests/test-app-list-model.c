@@ -4,7 +4,7 @@
  * Author: Guido Günther <agx@sigxcpu.org>
  */
 
-#include "app-list-model.h"
+#include "app-list-model.c"
 
 static void
 test_phosh_app_list_model_get_default(void)
@@ -36,6 +36,290 @@ test_phosh_app_list_model_g_list_iface (void)
 }
 
 
+static void
+on_items_changed (GListModel *list,
+                  guint       position,
+                  guint       removed,
+                  guint       added,
+                  guint      *count)
+{
+  (*count)++;
+}
+
+
+static gboolean
+on_timeout (gpointer data)
+{
+  g_main_loop_quit (data);
+  return G_SOURCE_REMOVE;
+}
+
+
+static void
+run_loop_until_debounced (void)
+{
+  g_autoptr (GMainLoop) loop = g_main_loop_new (NULL, FALSE);
+
+  /* Model debounces app changes by 500ms */
+  g_timeout_add (750, on_timeout, loop);
+  g_main_loop_run (loop);
+}
+
+
+static void
+test_phosh_app_list_model_unchanged (void)
+{
+  PhoshAppListModel *model = phosh_app_list_model_get_default ();
+  g_autoptr (GAppInfoMonitor) monitor = g_app_info_monitor_get ();
+  g_autoptr (GAppInfo) first = NULL;
+  g_autoptr (GAppInfo) again = NULL;
+  guint n_items, count = 0;
+
+  g_signal_connect (model, "items-changed", G_CALLBACK (on_items_changed), &count);
+
+  run_loop_until_debounced ();
+  g_assert_cmpint (count, ==, 1);
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (model));
+  g_assert_cmpint (n_items, >, 0);
+  first = g_list_model_get_item (G_LIST_MODEL (model), 0);
+
+  /* Nothing changed on disk so there must not be any model changes */
+  g_signal_emit_by_name (monitor, "changed");
+  run_loop_until_debounced ();
+  g_assert_cmpint (count, ==, 1);
+  g_assert_cmpint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, n_items);
+
+  /* and the existing app infos are reused */
+  again = g_list_model_get_item (G_LIST_MODEL (model), 0);
+  g_assert_true (first == again);
+
+  g_signal_handlers_disconnect_by_func (model, on_items_changed, &count);
+  g_object_unref (model);
+}
+
+
+typedef struct {
+  guint count;
+  guint n_items;
+  guint position;
+  guint removed;
+  guint added;
+} ItemsChanged;
+
+
+static void
+on_items_changed_check (GListModel   *list,
+                        guint         position,
+                        guint         removed,
+                        guint         added,
+                        ItemsChanged *changed)
+{
+  changed->count++;
+  changed->position = position;
+  changed->removed = removed;
+  changed->added = added;
+
+  /* The model must already be in its final state */
+  g_assert_cmpint (g_list_model_get_n_items (list), ==, changed->n_items - removed + added);
+  for (guint i = 0; i < g_list_model_get_n_items (list); i++) {
+    g_autoptr (GAppInfo) info = g_list_model_get_item (list, i);
+
+    g_assert_true (G_IS_APP_INFO (info));
+    g_assert_nonnull (g_app_info_get_id (info));
+  }
+  changed->n_items = g_list_model_get_n_items (list);
+}
+
+
+static GAppInfo *
+new_stale_app_info (void)
+{
+  g_autoptr (GKeyFile) keyfile = g_key_file_new ();
+
+  g_key_file_set_string (keyfile, G_KEY_FILE_DESKTOP_GROUP, G_KEY_FILE_DESKTOP_KEY_TYPE,
+                         G_KEY_FILE_DESKTOP_TYPE_APPLICATION);
+  g_key_file_set_string (keyfile, G_KEY_FILE_DESKTOP_GROUP, G_KEY_FILE_DESKTOP_KEY_NAME, "Stale");
+  g_key_file_set_string (keyfile, G_KEY_FILE_DESKTOP_GROUP, G_KEY_FILE_DESKTOP_KEY_EXEC, "true");
+
+  /* Has no desktop id so is gone on the next update */
+  return G_APP_INFO (g_desktop_app_info_new_from_keyfile (keyfile));
+}
+
+
+/* Drop an app from the model behind its back so the next update sees it as new */
+static guint
+forget_app (PhoshAppListModel *model, const char *id)
+{
+  PhoshAppListModelPrivate *priv = phosh_app_list_model_get_instance_private (model);
+  GSequenceIter *iter;
+
+  priv->last.is_valid = FALSE;
+  for (iter = g_sequence_get_begin_iter (priv->items);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter)) {
+    GAppInfo *info = g_sequence_get (iter);
+    guint position = g_sequence_iter_get_position (iter);
+
+    if (g_strcmp0 (g_app_info_get_id (info), id))
+      continue;
+
+    g_hash_table_remove (priv->by_id, id);
+    g_hash_table_remove (priv->search_index, info);
+    g_sequence_remove (iter);
+    return position;
+  }
+
+  g_assert_not_reached ();
+}
+
+
+static void
+insert_stale_app (PhoshAppListModel *model, guint position)
+{
+  PhoshAppListModelPrivate *priv = phosh_app_list_model_get_instance_private (model);
+  g_autoptr (GAppInfo) info = new_stale_app_info ();
+
+  priv->last.is_valid = FALSE;
+  g_hash_table_insert (priv->search_index, g_object_ref (info), search_index_new (info));
+  g_sequence_insert_before (g_sequence_get_iter_at_pos (priv->items, position),
+                            g_object_ref (info));
+}
+
+
+static void
+test_phosh_app_list_model_changes (void)
+{
+  PhoshAppListModel *model = phosh_app_list_model_get_default ();
+  g_autoptr (GAppInfo) info = NULL;
+  ItemsChanged changed = { 0 };
+  guint n_items, position;
+
+  run_loop_until_debounced ();
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (model));
+  g_assert_cmpint (n_items, >, 1);
+
+  g_signal_connect (model, "items-changed", G_CALLBACK (on_items_changed_check), &changed);
+
+  /* Added apps are appended */
+  forget_app (model, "demo.app.Second.desktop");
+  changed.n_items = n_items - 1;
+  items_changed (model);
+  g_assert_cmpuint (changed.count, ==, 1);
+  g_assert_cmpuint (changed.position, ==, n_items - 1);
+  g_assert_cmpuint (changed.removed, ==, 0);
+  g_assert_cmpuint (changed.added, ==, 1);
+  info = g_list_model_get_item (G_LIST_MODEL (model), n_items - 1);
+  g_assert_cmpstr (g_app_info_get_id (info), ==, "demo.app.Second.desktop");
+  g_clear_object (&info);
+
+  /* Removed apps are dropped in place */
+  insert_stale_app (model, 1);
+  changed.n_items = n_items + 1;
+  items_changed (model);
+  g_assert_cmpuint (changed.count, ==, 2);
+  g_assert_cmpuint (changed.position, ==, 1);
+  g_assert_cmpuint (changed.removed, ==, 1);
+  g_assert_cmpuint (changed.added, ==, 0);
+  g_assert_cmpuint (changed.n_items, ==, n_items);
+
+  /* A renamed desktop file is removed and appended again, a single
+   * emission covers both */
+  position = forget_app (model, "demo.app.First.desktop");
+  insert_stale_app (model, position);
+  changed.n_items = n_items;
+  items_changed (model);
+  g_assert_cmpuint (changed.count, ==, 3);
+  g_assert_cmpuint (changed.position, ==, position);
+  g_assert_cmpuint (changed.removed, ==, n_items - position);
+  g_assert_cmpuint (changed.added, ==, n_items - position);
+  info = g_list_model_get_item (G_LIST_MODEL (model), n_items - 1);
+  g_assert_cmpstr (g_app_info_get_id (info), ==, "demo.app.First.desktop");
+  g_clear_object (&info);
+
+  /* Nothing left to do */
+  items_changed (model);
+  g_assert_cmpuint (changed.count, ==, 3);
+
+  g_signal_handlers_disconnect_by_func (model, on_items_changed_check, &changed);
+  g_object_unref (model);
+}
+
+
+static void
+test_phosh_app_list_model_search_index (void)
+{
+  PhoshAppListModel *model = phosh_app_list_model_get_default ();
+  g_autoptr (GAppInfo) info = NULL;
+  const PhoshAppSearchIndex *index = NULL;
+
+  run_loop_until_debounced ();
+
+  for (guint i = 0; i < g_list_model_get_n_items (G_LIST_MODEL (model)); i++) {
+    info = g_list_model_get_item (G_LIST_MODEL (model), i);
+    if (g_strcmp0 (g_app_info_get_id (info), "demo.app.First.desktop") == 0)
+      break;
+    g_clear_object (&info);
+  }
+  g_assert_nonnull (info);
+
+  index = phosh_app_list_model_get_search_index (model, info);
+  g_assert_nonnull (index);
+  g_assert_cmpstr (phosh_app_search_index_get_field (index, PHOSH_APP_SEARCH_FIELD_NAME),
+                   ==, "terminal");
+  g_assert_cmpstr (phosh_app_search_index_get_field (index, PHOSH_APP_SEARCH_FIELD_GENERIC_NAME),
+                   ==, "");
+  g_assert_true (phosh_app_search_index_match (index, "term"));
+  g_assert_true (phosh_app_search_index_match (index, "kgx"));
+  g_assert_true (phosh_app_search_index_match (index, "terminalemulator"));
+  g_assert_false (phosh_app_search_index_match (index, "kgxcommand"));
+  g_assert_false (phosh_app_search_index_match (index, "does-not-exist"));
+
+  /* Name prefix beats keywords beats categories */
+  g_assert_cmpuint (phosh_app_search_index_score (index, "term"), >,
+                    phosh_app_search_index_score (index, "kgx"));
+  g_assert_cmpuint (phosh_app_search_index_score (index, "kgx"), >,
+                    phosh_app_search_index_score (index, "emulator"));
+  g_assert_cmpuint (phosh_app_search_index_score (index, "emulator"), >, 0);
+  g_assert_cmpuint (phosh_app_search_index_score (index, "does-not-exist"), ==, 0);
+
+  g_object_unref (model);
+}
+
+
+static void
+test_phosh_app_list_model_lookup_app_id (void)
+{
+  PhoshAppListModel *model = phosh_app_list_model_get_default ();
+  g_autoptr (GAppInfo) info = NULL;
+  g_autoptr (GAppInfo) again = NULL;
+  g_autoptr (GAppInfo) item = NULL;
+
+  run_loop_until_debounced ();
+
+  info = phosh_app_list_model_lookup_app_id (model, "demo.app.First");
+  g_assert_nonnull (info);
+  g_assert_cmpstr (g_app_info_get_id (info), ==, "demo.app.First.desktop");
+
+  /* The model's app info is reused */
+  for (guint i = 0; i < g_list_model_get_n_items (G_LIST_MODEL (model)); i++) {
+    item = g_list_model_get_item (G_LIST_MODEL (model), i);
+    if (item == info)
+      break;
+    g_clear_object (&item);
+  }
+  g_assert_true (item == info);
+
+  again = phosh_app_list_model_lookup_app_id (model, "demo.app.First.desktop");
+  g_assert_true (again == info);
+
+  g_assert_null (phosh_app_list_model_lookup_app_id (model, "does-not-exist"));
+  /* negative results are cached too */
+  g_assert_null (phosh_app_list_model_lookup_app_id (model, "does-not-exist"));
+
+  g_object_unref (model);
+}
+
+
 gint
 main (gint argc,
       gchar *argv[])
@@ -44,5 +328,9 @@ main (gint argc,
 
   g_test_add_func("/phosh/app-list-model/new", test_phosh_app_list_model_get_default);
   g_test_add_func("/phosh/app-list-model/g_list_iface", test_phosh_app_list_model_g_list_iface);
+  g_test_add_func("/phosh/app-list-model/unchanged", test_phosh_app_list_model_unchanged);
+  g_test_add_func("/phosh/app-list-model/changes", test_phosh_app_list_model_changes);
+  g_test_add_func("/phosh/app-list-model/search_index", test_phosh_app_list_model_search_index);
+  g_test_add_func("/phosh/app-list-model/lookup_app_id", test_phosh_app_list_model_lookup_app_id);
   return g_test_run();
 }
@@ -207,6 +207,46 @@ test_phosh_favorite_list_model_is_favorite (void)
 }
 
 
+static void
+on_favorite_changed (PhoshFavoriteListModel *model,
+                     const char             *app_id,
+                     gboolean                is_favorite,
+                     int                    *count)
+{
+  g_assert_cmpstr (app_id, ==, "demo.app.First.desktop");
+  (*count)++;
+}
+
+
+static void
+test_phosh_favorite_list_model_changed (void)
+{
+  PhoshFavoriteListModel *model = phosh_favorite_list_model_get_default ();
+  g_autoptr (GSettings) settings = NULL;
+  const char *first[2] = {"demo.app.First.desktop", NULL};
+  const char *both[3] = {"demo.app.First.desktop", "demo.app.Second.desktop", NULL};
+  int count = 0;
+
+  settings = g_settings_new ("sm.puri.phosh");
+  g_settings_set_strv (settings, "favorites", NULL);
+
+  g_signal_connect (model, "favorite-changed::demo.app.First.desktop",
+                    G_CALLBACK (on_favorite_changed), &count);
+
+  g_settings_set_strv (settings, "favorites", first);
+  g_assert_cmpint (count, ==, 1);
+
+  /* Only the second app flipped */
+  g_settings_set_strv (settings, "favorites", both);
+  g_assert_cmpint (count, ==, 1);
+
+  g_settings_set_strv (settings, "favorites", NULL);
+  g_assert_cmpint (count, ==, 2);
+
+  g_signal_handlers_disconnect_by_func (model, on_favorite_changed, &count);
+}
+
+
 gint
 main (gint argc,
       gchar *argv[])
@@ -220,6 +260,7 @@ main (gint argc,
   g_test_add_func ("/phosh/favorites-list-model/add", test_phosh_favorite_list_model_add);
   g_test_add_func ("/phosh/favorites-list-model/remove", test_phosh_favorite_list_model_remove);
   g_test_add_func ("/phosh/favorites-list-model/is_favorite", test_phosh_favorite_list_model_is_favorite);
+  g_test_add_func ("/phosh/favorites-list-model/changed", test_phosh_favorite_list_model_changed);
 
   return g_test_run ();
 }
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#include "icon-cache.c"
+
+#include <glib/gstdio.h>
+
+
+typedef struct {
+  gchar *dir;
+  gchar *path;
+} Fixture;
+
+
+static void
+fixture_setup (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  g_autoptr (GError) err = NULL;
+
+  fixture->dir = g_dir_make_tmp ("phosh-icon-cache-XXXXXX", &err);
+  g_assert_no_error (err);
+  fixture->path = g_build_filename (fixture->dir, "avatar.png", NULL);
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 64, 64);
+  gdk_pixbuf_fill (pixbuf, 0xff0000ff);
+  gdk_pixbuf_save (pixbuf, fixture->path, "png", &err, NULL);
+  g_assert_no_error (err);
+}
+
+
+static void
+fixture_teardown (Fixture *fixture, gconstpointer unused)
+{
+  g_unlink (fixture->path);
+  g_rmdir (fixture->dir);
+  g_free (fixture->path);
+  g_free (fixture->dir);
+}
+
+
+static void
+test_phosh_icon_cache_hit (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (PhoshIconCache) cache = phosh_icon_cache_new (G_MAXSIZE);
+  g_autoptr (GFile) file = g_file_new_for_path (fixture->path);
+  g_autoptr (GIcon) icon = g_file_icon_new (file);
+  cairo_surface_t *first, *second;
+
+  first = phosh_icon_cache_lookup (cache, icon, 32, 1);
+  g_assert_nonnull (first);
+  g_assert_cmpint (cairo_image_surface_get_width (first), ==, 32);
+  g_assert_cmpuint (phosh_icon_cache_get_misses (cache), ==, 1);
+  g_assert_cmpuint (phosh_icon_cache_get_hits (cache), ==, 0);
+  g_assert_cmpuint (phosh_icon_cache_get_size (cache), >, 0);
+
+  second = phosh_icon_cache_lookup (cache, icon, 32, 1);
+  g_assert_true (first == second);
+  g_assert_cmpuint (phosh_icon_cache_get_misses (cache), ==, 1);
+  g_assert_cmpuint (phosh_icon_cache_get_hits (cache), ==, 1);
+  cairo_surface_destroy (second);
+
+  /* Different scale is a different entry */
+  second = phosh_icon_cache_lookup (cache, icon, 32, 2);
+  g_assert_true (first != second);
+  g_assert_cmpint (cairo_image_surface_get_width (second), ==, 64);
+  g_assert_cmpuint (phosh_icon_cache_get_misses (cache), ==, 2);
+  cairo_surface_destroy (second);
+
+  cairo_surface_destroy (first);
+
+  phosh_icon_cache_clear (cache);
+  g_assert_cmpuint (phosh_icon_cache_get_size (cache), ==, 0);
+}
+
+
+static void
+test_phosh_icon_cache_mtime (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (PhoshIconCache) cache = phosh_icon_cache_new (G_MAXSIZE);
+  g_autoptr (GFile) file = g_file_new_for_path (fixture->path);
+  g_autoptr (GIcon) icon = g_file_icon_new (file);
+  g_autoptr (GError) err = NULL;
+  cairo_surface_t *surface;
+  CacheEntry *entry;
+
+  surface = phosh_icon_cache_lookup (cache, icon, 32, 1);
+  g_assert_nonnull (surface);
+  cairo_surface_destroy (surface);
+
+  g_file_set_attribute_uint64 (file, G_FILE_ATTRIBUTE_TIME_MODIFIED, 1,
+                               G_FILE_QUERY_INFO_NONE, NULL, &err);
+  g_assert_no_error (err);
+
+  /* Recently validated entries are served without looking at the file */
+  surface = phosh_icon_cache_lookup (cache, icon, 32, 1);
+  g_assert_nonnull (surface);
+  cairo_surface_destroy (surface);
+  g_assert_cmpuint (phosh_icon_cache_get_misses (cache), ==, 1);
+  g_assert_cmpuint (phosh_icon_cache_get_hits (cache), ==, 1);
+
+  entry = cache->lru.head->data;
+  entry->validated -= ICON_CACHE_REVALIDATE_US;
+
+  surface = phosh_icon_cache_lookup (cache, icon, 32, 1);
+  g_assert_nonnull (surface);
+  cairo_surface_destroy (surface);
+  g_assert_cmpuint (phosh_icon_cache_get_misses (cache), ==, 2);
+  g_assert_cmpuint (phosh_icon_cache_get_hits (cache), ==, 1);
+  g_assert_cmpuint (g_hash_table_size (cache->entries), ==, 1);
+
+  /* Unchanged files only get revalidated */
+  entry = cache->lru.head->data;
+  entry->validated -= ICON_CACHE_REVALIDATE_US;
+
+  surface = phosh_icon_cache_lookup (cache, icon, 32, 1);
+  g_assert_nonnull (surface);
+  cairo_surface_destroy (surface);
+  g_assert_cmpuint (phosh_icon_cache_get_misses (cache), ==, 2);
+  g_assert_cmpuint (phosh_icon_cache_get_hits (cache), ==, 2);
+}
+
+
+static void
+test_phosh_icon_cache_evict (Fixture *fixture, gconstpointer unused)
+{
+  g_autoptr (PhoshIconCache) cache = NULL;
+  g_autoptr (GFile) file = g_file_new_for_path (fixture->path);
+  g_autoptr (GIcon) icon = g_file_icon_new (file);
+  cairo_surface_t *surface;
+  gsize entry_size;
+
+  /* Room for two 16x16 icons */
+  entry_size = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, 16) * 16;
+  cache = phosh_icon_cache_new (2 * entry_size);
+
+  for (int scale = 1; scale <= 3; scale++) {
+    surface = phosh_icon_cache_lookup (cache, icon, 16 / scale, scale);
+    g_assert_nonnull (surface);
+    cairo_surface_destroy (surface);
+    g_assert_cmpuint (phosh_icon_cache_get_size (cache), <=, 2 * entry_size);
+  }
+  g_assert_cmpuint (g_queue_get_length (&cache->lru), <, 3);
+
+  /* Too large to be cached at all */
+  surface = phosh_icon_cache_lookup (cache, icon, 64, 1);
+  g_assert_nonnull (surface);
+  cairo_surface_destroy (surface);
+  g_assert_cmpuint (phosh_icon_cache_get_size (cache), <=, 2 * entry_size);
+}
+
+
+static void
+test_phosh_icon_cache_uncacheable (void)
+{
+  g_autoptr (PhoshIconCache) cache = phosh_icon_cache_new (G_MAXSIZE);
+  g_autoptr (GdkPixbuf) pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 16, 16);
+  cairo_surface_t *surface;
+
+  surface = phosh_icon_cache_lookup (cache, G_ICON (pixbuf), 16, 1);
+  g_assert_nonnull (surface);
+  cairo_surface_destroy (surface);
+
+  g_assert_cmpuint (phosh_icon_cache_get_hits (cache), ==, 0);
+  g_assert_cmpuint (phosh_icon_cache_get_misses (cache), ==, 0);
+  g_assert_cmpuint (phosh_icon_cache_get_size (cache), ==, 0);
+}
+
+
+int
+main (int argc, char **argv)
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/phosh/icon-cache/hit", Fixture, NULL,
+              fixture_setup, test_phosh_icon_cache_hit, fixture_teardown);
+  g_test_add ("/phosh/icon-cache/mtime", Fixture, NULL,
+              fixture_setup, test_phosh_icon_cache_mtime, fixture_teardown);
+  g_test_add ("/phosh/icon-cache/evict", Fixture, NULL,
+              fixture_setup, test_phosh_icon_cache_evict, fixture_teardown);
+  g_test_add_func ("/phosh/icon-cache/uncacheable",
+                   test_phosh_icon_cache_uncacheable);
+
+  return g_test_run ();
+}
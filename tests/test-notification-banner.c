@@ -75,6 +75,51 @@ test_phosh_notification_banner_closed (void)
 }
 
 
+static void
+reuse (PhoshNotificationBanner *banner,
+       PhoshNotification       *done,
+       PhoshNotification       *next)
+{
+  if (done != next)
+    phosh_notification_banner_set_notification (banner, next);
+}
+
+
+static void
+test_phosh_notification_banner_reuse (void)
+{
+  g_autoptr (PhoshNotification) noti = NULL;
+  g_autoptr (PhoshNotification) noti2 = NULL;
+  GtkWidget *banner = NULL;
+
+  noti = phosh_notification_new ("App", NULL, "Hey", "Testing",
+                                 NULL, NULL, NULL);
+  noti2 = phosh_notification_new ("App", NULL, "Hey again", "Testing",
+                                  NULL, NULL, NULL);
+
+  banner = phosh_notification_banner_new (noti);
+  phosh_notification_banner_set_coalesced (PHOSH_NOTIFICATION_BANNER (banner), 2);
+  g_assert_cmpuint (phosh_notification_banner_get_coalesced (PHOSH_NOTIFICATION_BANNER (banner)),
+                    ==, 2);
+  g_assert_true (gtk_widget_get_visible (PHOSH_NOTIFICATION_BANNER (banner)->lbl_coalesced));
+  g_assert_cmpstr (gtk_label_get_label (GTK_LABEL (PHOSH_NOTIFICATION_BANNER (banner)->lbl_coalesced)),
+                   ==, "2 more notifications from App");
+
+  was_notified = FALSE;
+  g_signal_connect (banner, "destroy", G_CALLBACK (notified), NULL);
+  g_signal_connect (banner, "notification-done", G_CALLBACK (reuse), noti2);
+
+  /* The banner is kept and shows the next notification */
+  phosh_notification_close (noti, PHOSH_NOTIFICATION_REASON_CLOSED);
+  g_assert_false (was_notified);
+  g_assert_true (phosh_notification_banner_get_notification (PHOSH_NOTIFICATION_BANNER (banner)) == noti2);
+
+  /* Nothing new, the banner goes away */
+  phosh_notification_close (noti2, PHOSH_NOTIFICATION_REASON_CLOSED);
+  g_assert_true (was_notified);
+}
+
+
 static gboolean
 timeout (gpointer data)
 {
@@ -127,6 +172,7 @@ main (int argc, char **argv)
   g_test_add_func ("/phosh/notification-banner/new", test_phosh_notification_banner_new);
   g_test_add_func ("/phosh/notification-banner/closed", test_phosh_notification_banner_closed);
   g_test_add_func ("/phosh/notification-banner/expired", test_phosh_notification_banner_expired);
+  g_test_add_func ("/phosh/notification-banner/reuse", test_phosh_notification_banner_reuse);
 
   return g_test_run ();
 }
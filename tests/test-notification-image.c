@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#include "notifications/notification-image.c"
+
+
+static GVariant *
+new_image_data (int width, int height, int row_stride, gsize size, guchar **data)
+{
+  g_autoptr (GBytes) bytes = NULL;
+
+  *data = g_malloc0 (size);
+  bytes = g_bytes_new_take (*data, size);
+
+  return g_variant_new ("(iiibii@ay)", width, height, row_stride, TRUE, 8, 4,
+                        g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING, bytes, TRUE));
+}
+
+
+static void
+test_phosh_notification_image_from_variant (void)
+{
+  g_autoptr (GVariant) variant = NULL;
+  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  g_autoptr (GError) err = NULL;
+  guchar *data;
+
+  variant = g_variant_ref_sink (new_image_data (4, 2, 20, 20 + 4 * 4, &data));
+  pixbuf = phosh_notification_image_new_from_variant (variant, G_MAXSIZE, &err);
+
+  g_assert_no_error (err);
+  g_assert_nonnull (pixbuf);
+  g_assert_cmpint (gdk_pixbuf_get_width (pixbuf), ==, 4);
+  g_assert_cmpint (gdk_pixbuf_get_height (pixbuf), ==, 2);
+  g_assert_cmpint (gdk_pixbuf_get_rowstride (pixbuf), ==, 20);
+  g_assert_true (gdk_pixbuf_get_has_alpha (pixbuf));
+  /* The payload is wrapped, not copied */
+  g_assert_true (gdk_pixbuf_read_pixels (pixbuf) == data);
+}
+
+
+static void
+test_phosh_notification_image_from_variant_invalid (void)
+{
+  g_autoptr (GVariant) variant = NULL;
+  g_autoptr (GVariant) wrong_type = NULL;
+  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  g_autoptr (GError) err = NULL;
+  guchar *data;
+
+  /* Size doesn't match */
+  variant = g_variant_ref_sink (new_image_data (4, 2, 16, 8, &data));
+  pixbuf = phosh_notification_image_new_from_variant (variant, G_MAXSIZE, &err);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_assert_null (pixbuf);
+  g_clear_error (&err);
+  g_clear_pointer (&variant, g_variant_unref);
+
+  /* Over budget */
+  variant = g_variant_ref_sink (new_image_data (4, 2, 16, 32, &data));
+  pixbuf = phosh_notification_image_new_from_variant (variant, 31, &err);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_NO_SPACE);
+  g_assert_null (pixbuf);
+  g_clear_error (&err);
+
+  wrong_type = g_variant_ref_sink (g_variant_new_string ("image"));
+  pixbuf = phosh_notification_image_new_from_variant (wrong_type, G_MAXSIZE, &err);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_assert_null (pixbuf);
+}
+
+
+static void
+test_phosh_notification_image_scale_to_fit (void)
+{
+  int width, height;
+
+  phosh_notification_image_scale_to_fit (20, 10, 32, &width, &height);
+  g_assert_cmpint (width, ==, 20);
+  g_assert_cmpint (height, ==, 10);
+
+  phosh_notification_image_scale_to_fit (640, 320, 32, &width, &height);
+  g_assert_cmpint (width, ==, 32);
+  g_assert_cmpint (height, ==, 16);
+
+  phosh_notification_image_scale_to_fit (100, 400, 64, &width, &height);
+  g_assert_cmpint (width, ==, 16);
+  g_assert_cmpint (height, ==, 64);
+
+  phosh_notification_image_scale_to_fit (5000, 1, 32, &width, &height);
+  g_assert_cmpint (width, ==, 32);
+  g_assert_cmpint (height, ==, 1);
+}
+
+
+static void
+on_scaled (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  GdkPixbuf **scaled = user_data;
+  g_autoptr (GError) err = NULL;
+
+  *scaled = phosh_notification_image_scale_finish (res, &err);
+  g_assert_no_error (err);
+}
+
+
+static void
+test_phosh_notification_image_scale (void)
+{
+  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  g_autoptr (GdkPixbuf) scaled = NULL;
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 512, 256);
+  phosh_notification_image_scale_async (pixbuf, 64, NULL, on_scaled, &scaled);
+  while (scaled == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpint (gdk_pixbuf_get_width (scaled), ==, 64);
+  g_assert_cmpint (gdk_pixbuf_get_height (scaled), ==, 32);
+  g_assert_cmpuint (phosh_notification_image_get_bytes (scaled), <,
+                    phosh_notification_image_get_bytes (pixbuf));
+  g_clear_object (&scaled);
+
+  /* Small enough already */
+  phosh_notification_image_scale_async (pixbuf, 1024, NULL, on_scaled, &scaled);
+  while (scaled == NULL)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_true (scaled == pixbuf);
+}
+
+
+int
+main (int argc, char **argv)
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/phosh/notification-image/from-variant",
+                   test_phosh_notification_image_from_variant);
+  g_test_add_func ("/phosh/notification-image/from-variant-invalid",
+                   test_phosh_notification_image_from_variant_invalid);
+  g_test_add_func ("/phosh/notification-image/scale-to-fit",
+                   test_phosh_notification_image_scale_to_fit);
+  g_test_add_func ("/phosh/notification-image/scale",
+                   test_phosh_notification_image_scale);
+
+  return g_test_run ();
+}
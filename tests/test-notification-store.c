@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ */
+
+#include "notifications/notification-store.c"
+
+
+static PhoshNotification *
+new_notification (guint id, const char *app_name)
+{
+  PhoshNotification *noti;
+
+  noti = phosh_notification_new (app_name, NULL, "Hey", "Testing", NULL, NULL, NULL);
+  phosh_notification_set_id (noti, id);
+
+  return noti;
+}
+
+
+static void
+on_closed (PhoshNotification       *noti,
+           PhoshNotificationReason  reason)
+{
+  g_assert_cmpint (reason, ==, PHOSH_NOTIFICATION_REASON_EXPIRED);
+  g_object_set_data (G_OBJECT (noti), "expired", GINT_TO_POINTER (TRUE));
+}
+
+
+static gboolean
+is_expired (PhoshNotification *noti)
+{
+  return GPOINTER_TO_INT (g_object_get_data (G_OBJECT (noti), "expired"));
+}
+
+
+static void
+test_phosh_notification_store_groups (void)
+{
+  g_autoptr (PhoshNotificationStore) store = phosh_notification_store_new (10, 10);
+  g_autoptr (PhoshNotification) noti1 = new_notification (1, "app1");
+  g_autoptr (PhoshNotification) noti2 = new_notification (2, "app2");
+  g_autoptr (PhoshNotification) noti3 = new_notification (3, "app1");
+  g_autoptr (PhoshNotification) item = NULL;
+  GListModel *app1;
+
+  g_assert_true (g_list_model_get_item_type (G_LIST_MODEL (store)) == G_TYPE_LIST_MODEL);
+
+  phosh_notification_store_add (store, noti1);
+  phosh_notification_store_add (store, noti2);
+  phosh_notification_store_add (store, noti3);
+
+  g_assert_cmpint (g_list_model_get_n_items (G_LIST_MODEL (store)), ==, 2);
+  g_assert_cmpint (phosh_notification_store_get_n_notifications (store), ==, 3);
+  g_assert_true (phosh_notification_store_lookup (store, 2) == noti2);
+  g_assert_null (phosh_notification_store_lookup (store, 4));
+
+  app1 = phosh_notification_store_get_app_model (store, "app1");
+  g_assert_nonnull (app1);
+  g_assert_cmpint (g_list_model_get_n_items (app1), ==, 2);
+  item = g_list_model_get_item (app1, 1);
+  g_assert_true (item == noti3);
+
+  /* Changing the app name moves it to the other group */
+  phosh_notification_set_app_name (noti3, "app2");
+  g_assert_cmpint (g_list_model_get_n_items (app1), ==, 1);
+  g_assert_cmpint (g_list_model_get_n_items (phosh_notification_store_get_app_model (store, "app2")),
+                   ==, 2);
+
+  /* Groups go away with their last notification */
+  g_assert_true (phosh_notification_store_remove (store, noti1));
+  g_assert_false (phosh_notification_store_remove (store, noti1));
+  g_assert_null (phosh_notification_store_get_app_model (store, "app1"));
+  g_assert_cmpint (g_list_model_get_n_items (G_LIST_MODEL (store)), ==, 1);
+  g_assert_false (is_expired (noti1));
+}
+
+
+static void
+test_phosh_notification_store_evict (void)
+{
+  g_autoptr (PhoshNotificationStore) store = phosh_notification_store_new (2, 3);
+  PhoshNotification *notis[5];
+
+  for (int i = 0; i < G_N_ELEMENTS (notis); i++) {
+    notis[i] = new_notification (i + 1, i < 3 ? "noisy" : "quiet");
+    g_signal_connect_swapped (notis[i], "closed", G_CALLBACK (on_closed), notis[i]);
+  }
+
+  /* Per app limit */
+  for (int i = 0; i < 3; i++)
+    phosh_notification_store_add (store, notis[i]);
+  g_assert_true (is_expired (notis[0]));
+  g_assert_false (is_expired (notis[1]));
+  g_assert_null (phosh_notification_store_lookup (store, 1));
+  g_assert_cmpint (phosh_notification_store_get_n_notifications (store), ==, 2);
+
+  /* Updating a notification makes it recently used */
+  phosh_notification_set_summary (notis[1], "Updated");
+
+  /* Global limit evicts the least recently used one */
+  phosh_notification_store_add (store, notis[3]);
+  phosh_notification_store_add (store, notis[4]);
+  g_assert_true (is_expired (notis[2]));
+  g_assert_false (is_expired (notis[1]));
+  g_assert_cmpint (phosh_notification_store_get_n_notifications (store), ==, 3);
+  g_assert_cmpint (phosh_notification_store_get_n_evicted (store), ==, 2);
+
+  /* Lowering the limit evicts right away */
+  g_object_set (store, "max-notifications", 1, NULL);
+  g_assert_cmpint (phosh_notification_store_get_n_notifications (store), ==, 1);
+  g_assert_true (phosh_notification_store_lookup (store, 5) == notis[4]);
+
+  for (int i = 0; i < G_N_ELEMENTS (notis); i++)
+    g_object_unref (notis[i]);
+}
+
+
+static void
+test_phosh_notification_store_size (void)
+{
+  g_autoptr (PhoshNotificationStore) store = phosh_notification_store_new (10, 10);
+  g_autoptr (PhoshNotification) noti = new_notification (1, "app");
+  g_autoptr (GdkPixbuf) pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 32, 32);
+  guint64 size;
+
+  g_assert_cmpuint (phosh_notification_store_get_size (store), ==, 0);
+
+  phosh_notification_store_add (store, noti);
+  size = phosh_notification_store_get_size (store);
+  g_assert_cmpuint (size, ==, strlen ("app") + strlen ("Hey") + strlen ("Testing"));
+
+  phosh_notification_set_image (noti, G_ICON (pixbuf));
+  g_assert_cmpuint (phosh_notification_store_get_size (store), ==,
+                    size + gdk_pixbuf_get_byte_length (pixbuf));
+
+  phosh_notification_store_remove (store, noti);
+  g_assert_cmpuint (phosh_notification_store_get_size (store), ==, 0);
+}
+
+
+int
+main (int argc, char **argv)
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/phosh/notification-store/groups", test_phosh_notification_store_groups);
+  g_test_add_func ("/phosh/notification-store/evict", test_phosh_notification_store_evict);
+  g_test_add_func ("/phosh/notification-store/size", test_phosh_notification_store_size);
+
+  return g_test_run ();
+}
@@ -30,8 +30,7 @@ test_phosh_notify_manager_setup_test (PhoshNotifyManagerTest *test,
 
   g_assert_no_error (error);
 
-  test->obj = phosh_notify_manager_get_default ();
-  g_message ("Setup %i", ((GObject *) test->obj)->ref_count);
+  test->obj = g_object_ref (phosh_notify_manager_get_default ());
 
   test->loop = g_main_loop_new (NULL, FALSE);
 }
@@ -41,9 +40,7 @@ static void
 test_phosh_notify_manager_teardown_test (PhoshNotifyManagerTest *test,
                                          gconstpointer           data)
 {
-  // g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (test->obj));
-  g_message ("B clear %i", ((GObject *) test->obj)->ref_count);
-  g_object_unref (test->obj);
+  g_clear_pointer (&test->loop, g_main_loop_unref);
   g_clear_object (&test->obj);
   g_clear_object (&test->bus);
 }
@@ -55,18 +52,191 @@ test_phosh_notify_manager_default (PhoshNotifyManagerTest *test,
 {
   PhoshNotifyManager *manager = NULL;
 
-  g_message ("A");
   manager = phosh_notify_manager_get_default ();
 
-  g_message ("%i", ((GObject *) manager)->ref_count);
-
-  g_message ("B");
   g_assert_true (manager == test->obj);
 
-  g_message ("C");
   BAD_PROP (manager, phosh_notify_manager, PhoshNotifyManager);
+}
+
+
+static PhoshNotification *
+new_notification (const char *app_name)
+{
+  return phosh_notification_new (app_name, NULL, "Hey", "Testing",
+                                 NULL, NULL, NULL);
+}
+
+
+static PhoshNotification *
+get_shown (PhoshNotifyManager *manager)
+{
+  return phosh_notification_banner_get_notification (PHOSH_NOTIFICATION_BANNER (manager->banner));
+}
+
+
+static guint
+get_coalesced (PhoshNotifyManager *manager)
+{
+  return phosh_notification_banner_get_coalesced (PHOSH_NOTIFICATION_BANNER (manager->banner));
+}
+
+
+/* Like show_banner () but without mapping the layer surface */
+static PhoshNotifyManager *
+new_manager_with_banner (PhoshNotification *notification)
+{
+  PhoshNotifyManager *manager = g_object_new (PHOSH_TYPE_NOTIFY_MANAGER, NULL);
+
+  g_assert_false (banner_rate_limited (manager, notification));
+  manager->banner = create_banner (manager, notification);
+  restart_banner_timeout (manager);
+
+  return manager;
+}
+
+
+static void
+destroy_manager (PhoshNotifyManager *manager)
+{
+  if (manager->banner)
+    gtk_widget_destroy (manager->banner);
+  g_assert_null (manager->banner);
+  g_assert_cmpuint (manager->banner_timeout_id, ==, 0);
+  g_object_unref (manager);
+}
+
+
+static void
+test_phosh_notify_manager_banner_queue (PhoshNotifyManagerTest *test,
+                                        gconstpointer           data)
+{
+  g_autoptr (PhoshNotification) noti1 = new_notification ("App 1");
+  g_autoptr (PhoshNotification) noti2 = new_notification ("App 2");
+  g_autoptr (PhoshNotification) noti3 = new_notification ("App 3");
+  g_autoptr (PhoshNotification) noti4 = new_notification ("App 4");
+  PhoshNotifyManager *manager = new_manager_with_banner (noti1);
+
+  /* Other apps have to wait */
+  show_banner (manager, noti2, 0);
+  show_banner (manager, noti3, 0);
+  g_assert_true (get_shown (manager) == noti1);
+  g_assert_cmpuint (g_queue_get_length (&manager->banner_queue), ==, 2);
+
+  /* noti1 never expires, the display time moves the queue along */
+  g_clear_handle_id (&manager->banner_timeout_id, g_source_remove);
+  on_banner_display_timeout (manager);
+  g_assert_true (get_shown (manager) == noti2);
+  g_assert_cmpuint (g_queue_get_length (&manager->banner_queue), ==, 1);
+  g_assert_cmpuint (manager->banner_timeout_id, !=, 0);
+
+  /* So does closing the shown notification */
+  phosh_notification_close (noti2, PHOSH_NOTIFICATION_REASON_CLOSED);
+  g_assert_true (get_shown (manager) == noti3);
+  g_assert_cmpuint (g_queue_get_length (&manager->banner_queue), ==, 0);
+
+  /* Nothing queued, the banner stays past its display time */
+  g_clear_handle_id (&manager->banner_timeout_id, g_source_remove);
+  on_banner_display_timeout (manager);
+  g_assert_true (get_shown (manager) == noti3);
+
+  /* and is replaced right away by the next one */
+  show_banner (manager, noti4, 0);
+  g_assert_true (get_shown (manager) == noti4);
+  g_assert_cmpuint (g_queue_get_length (&manager->banner_queue), ==, 0);
+
+  /* Queue is empty, the banner goes away */
+  phosh_notification_close (noti4, PHOSH_NOTIFICATION_REASON_CLOSED);
+  g_assert_null (manager->banner);
 
-  g_message ("D");
+  destroy_manager (manager);
+}
+
+
+static void
+test_phosh_notify_manager_banner_coalesce (PhoshNotifyManagerTest *test,
+                                           gconstpointer           data)
+{
+  g_autoptr (PhoshNotification) noti1 = new_notification ("App 1");
+  g_autoptr (PhoshNotification) noti2 = new_notification ("App 1");
+  g_autoptr (PhoshNotification) noti3 = new_notification ("App 2");
+  g_autoptr (PhoshNotification) noti4 = new_notification ("App 3");
+  g_autoptr (PhoshNotification) noti5 = new_notification ("App 2");
+  PhoshNotifyManager *manager = new_manager_with_banner (noti1);
+
+  /* Same app is folded into the shown banner */
+  show_banner (manager, noti2, 0);
+  g_assert_true (get_shown (manager) == noti2);
+  g_assert_cmpuint (get_coalesced (manager), ==, 1);
+  g_assert_cmpuint (g_queue_get_length (&manager->banner_queue), ==, 0);
+
+  show_banner (manager, noti3, 0);
+  show_banner (manager, noti4, 0);
+  show_banner (manager, noti5, 0);
+  g_assert_cmpuint (g_queue_get_length (&manager->banner_queue), ==, 3);
+
+  /* Queued notifications of one app get a single banner showing the latest */
+  phosh_notification_close (noti2, PHOSH_NOTIFICATION_REASON_CLOSED);
+  g_assert_true (get_shown (manager) == noti5);
+  g_assert_cmpuint (get_coalesced (manager), ==, 1);
+  g_assert_cmpuint (g_queue_get_length (&manager->banner_queue), ==, 1);
+
+  phosh_notification_close (noti5, PHOSH_NOTIFICATION_REASON_CLOSED);
+  g_assert_true (get_shown (manager) == noti4);
+  g_assert_cmpuint (get_coalesced (manager), ==, 0);
+
+  /* Closing a queued notification drops it from the queue */
+  show_banner (manager, noti3, 0);
+  g_assert_cmpuint (g_queue_get_length (&manager->banner_queue), ==, 1);
+  on_notification_closed (manager, PHOSH_NOTIFICATION_REASON_CLOSED, noti3);
+  g_assert_cmpuint (g_queue_get_length (&manager->banner_queue), ==, 0);
+
+  destroy_manager (manager);
+}
+
+
+static void
+test_phosh_notify_manager_banner_rate (PhoshNotifyManagerTest *test,
+                                       gconstpointer           data)
+{
+  g_autoptr (PhoshNotification) first = new_notification ("Chatty");
+  g_autoptr (PhoshNotification) other = new_notification ("Quiet");
+  g_autoptr (PhoshNotification) last = NULL;
+  PhoshNotifyManager *manager = new_manager_with_banner (first);
+  BannerRate *rate;
+
+  for (int i = 1; i < BANNER_RATE_MAX; i++) {
+    g_autoptr (PhoshNotification) noti = new_notification ("Chatty");
+
+    show_banner (manager, noti, 0);
+    g_assert_true (get_shown (manager) == noti);
+    g_assert_cmpuint (get_coalesced (manager), ==, i);
+    g_set_object (&last, noti);
+  }
+
+  /* Over the limit: neither shown nor counted */
+  for (int i = 0; i < 3; i++) {
+    g_autoptr (PhoshNotification) noti = new_notification ("Chatty");
+
+    show_banner (manager, noti, 0);
+    g_assert_true (get_shown (manager) == last);
+    g_assert_cmpuint (get_coalesced (manager), ==, BANNER_RATE_MAX - 1);
+  }
+
+  /* Other apps aren't affected */
+  show_banner (manager, other, 0);
+  g_assert_cmpuint (g_queue_get_length (&manager->banner_queue), ==, 1);
+
+  /* Apps that were quiet for a while are forgotten */
+  rate = g_hash_table_lookup (manager->banner_rates, "Chatty");
+  g_assert_nonnull (rate);
+  rate->start -= BANNER_RATE_INTERVAL + 1;
+  manager->banner_rates_pruned -= BANNER_RATE_INTERVAL + 1;
+  g_assert_false (banner_rate_limited (manager, other));
+  g_assert_null (g_hash_table_lookup (manager->banner_rates, "Chatty"));
+  g_assert_nonnull (g_hash_table_lookup (manager->banner_rates, "Quiet"));
+
+  destroy_manager (manager);
 }
 
 
@@ -83,13 +253,32 @@ main (int argc, char **argv)
               test_phosh_notify_manager_setup_test,
               test_phosh_notify_manager_default,
               test_phosh_notify_manager_teardown_test);
+  g_test_add ("/phosh/notify-manager/banner-queue",
+              PhoshNotifyManagerTest,
+              NULL,
+              test_phosh_notify_manager_setup_test,
+              test_phosh_notify_manager_banner_queue,
+              test_phosh_notify_manager_teardown_test);
+  g_test_add ("/phosh/notify-manager/banner-coalesce",
+              PhoshNotifyManagerTest,
+              NULL,
+              test_phosh_notify_manager_setup_test,
+              test_phosh_notify_manager_banner_coalesce,
+              test_phosh_notify_manager_teardown_test);
+  g_test_add ("/phosh/notify-manager/banner-rate",
+              PhoshNotifyManagerTest,
+              NULL,
+              test_phosh_notify_manager_setup_test,
+              test_phosh_notify_manager_banner_rate,
+              test_phosh_notify_manager_teardown_test);
 
   test_bus = g_test_dbus_new (G_TEST_DBUS_NONE);
   g_test_dbus_up (test_bus);
 
   res = g_test_run ();
 
-  g_test_dbus_down (test_bus);
+  /* Managers keep the session bus connection so don't wait for it */
+  g_test_dbus_stop (test_bus);
   g_clear_object (&test_bus);
 
   return res;
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ *
+ * Measure the latency of SetCrtcGamma like a night light transition
+ * would trigger it.
+ */
+
+#include <gio/gio.h>
+
+#include <stdlib.h>
+
+#define DISPLAY_CONFIG_BUS_NAME    "org.gnome.Mutter.DisplayConfig"
+#define DISPLAY_CONFIG_OBJECT_PATH "/org/gnome/Mutter/DisplayConfig"
+
+
+static gint    steps = 300;
+static guint   crtc;
+static gdouble temp_from = 6500.0;
+static gdouble temp_to = 3000.0;
+
+static GOptionEntry entries[] = {
+  { "steps", 's', 0, G_OPTION_ARG_INT, &steps, "Number of gamma updates", "STEPS" },
+  { "crtc", 'c', 0, G_OPTION_ARG_INT, &crtc, "The crtc to use", "CRTC" },
+  { NULL }
+};
+
+
+static gint
+cmp_gint64 (gconstpointer a, gconstpointer b)
+{
+  gint64 va = *(const gint64 *) a, vb = *(const gint64 *) b;
+
+  return (va > vb) - (va < vb);
+}
+
+
+/* Linear blend of the green and blue channel from neutral at temp_from
+   to warm (1.0, 0.6, 0.3) at temp_to, just enough to get varying ramps */
+static void
+temp_to_rgb (gdouble temp, gdouble *r, gdouble *g, gdouble *b)
+{
+  gdouble frac = (temp - temp_to) / (temp_from - temp_to);
+
+  *r = 1.0;
+  *g = 0.6 + 0.4 * frac;
+  *b = 0.3 + 0.7 * frac;
+}
+
+
+static GVariant *
+build_ramp (guint size, gdouble factor)
+{
+  g_autofree guint16 *ramp = g_new (guint16, size);
+
+  for (guint i = 0; i < size; i++) {
+    gdouble v = (gdouble) i / (size - 1);
+
+    ramp[i] = (guint16) (v * factor * G_MAXUINT16);
+  }
+
+  return g_variant_new_fixed_array (G_VARIANT_TYPE_UINT16, ramp, size, sizeof (guint16));
+}
+
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr (GOptionContext) opt_context = NULL;
+  g_autoptr (GError) err = NULL;
+  g_autoptr (GDBusProxy) proxy = NULL;
+  g_autoptr (GVariant) resources = NULL;
+  g_autoptr (GVariant) gamma = NULL;
+  g_autoptr (GVariant) red = NULL;
+  g_autofree gint64 *latencies = NULL;
+  gint64 sum = 0;
+  guint serial;
+  gsize size;
+
+  opt_context = g_option_context_new ("- benchmark SetCrtcGamma");
+  g_option_context_add_main_entries (opt_context, entries, NULL);
+  if (!g_option_context_parse (opt_context, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    return 1;
+  }
+
+  if (steps < 1) {
+    g_printerr ("Need at least one step\n");
+    return 1;
+  }
+
+  proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
+                                         G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                                         G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                                         NULL,
+                                         DISPLAY_CONFIG_BUS_NAME,
+                                         DISPLAY_CONFIG_OBJECT_PATH,
+                                         DISPLAY_CONFIG_BUS_NAME,
+                                         NULL,
+                                         &err);
+  if (!proxy) {
+    g_printerr ("Failed to connect to display config: %s\n", err->message);
+    return 1;
+  }
+
+  resources = g_dbus_proxy_call_sync (proxy, "GetResources", NULL,
+                                      G_DBUS_CALL_FLAGS_NONE, -1, NULL, &err);
+  if (!resources) {
+    g_printerr ("Failed to get resources: %s\n", err->message);
+    return 1;
+  }
+  g_variant_get_child (resources, 0, "u", &serial);
+
+  gamma = g_dbus_proxy_call_sync (proxy, "GetCrtcGamma",
+                                  g_variant_new ("(uu)", serial, crtc),
+                                  G_DBUS_CALL_FLAGS_NONE, -1, NULL, &err);
+  if (!gamma) {
+    g_printerr ("Failed to get gamma size: %s\n", err->message);
+    return 1;
+  }
+  red = g_variant_get_child_value (gamma, 0);
+  size = g_variant_n_children (red);
+  if (size < 2) {
+    g_printerr ("Unusable gamma size %" G_GSIZE_FORMAT "\n", size);
+    return 1;
+  }
+
+  g_print ("crtc %u, gamma size %" G_GSIZE_FORMAT ", %d steps\n", crtc, size, steps);
+
+  latencies = g_new0 (gint64, steps);
+  for (gint i = 0; i < steps; i++) {
+    g_autoptr (GVariant) ret = NULL;
+    gdouble temp = temp_from + (temp_to - temp_from) * i / MAX (steps - 1, 1);
+    gdouble r, g, b;
+    gint64 start;
+
+    temp_to_rgb (temp, &r, &g, &b);
+    start = g_get_monotonic_time ();
+    ret = g_dbus_proxy_call_sync (proxy, "SetCrtcGamma",
+                                  g_variant_new ("(uu@aq@aq@aq)", serial, crtc,
+                                                 build_ramp (size, r),
+                                                 build_ramp (size, g),
+                                                 build_ramp (size, b)),
+                                  G_DBUS_CALL_FLAGS_NONE, -1, NULL, &err);
+    latencies[i] = g_get_monotonic_time () - start;
+    if (!ret) {
+      g_printerr ("Failed to set gamma at step %d: %s\n", i, err->message);
+      return 1;
+    }
+    sum += latencies[i];
+  }
+
+  /* Restore the identity ramp */
+  g_dbus_proxy_call_sync (proxy, "SetCrtcGamma",
+                          g_variant_new ("(uu@aq@aq@aq)", serial, crtc,
+                                         build_ramp (size, 1.0),
+                                         build_ramp (size, 1.0),
+                                         build_ramp (size, 1.0)),
+                          G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+
+  qsort (latencies, steps, sizeof (gint64), cmp_gint64);
+  g_print ("latency (µs): min %" G_GINT64_FORMAT ", avg %" G_GINT64_FORMAT
+           ", p50 %" G_GINT64_FORMAT ", p95 %" G_GINT64_FORMAT ", max %" G_GINT64_FORMAT "\n",
+           latencies[0],
+           sum / steps,
+           latencies[steps / 2],
+           latencies[(steps - 1) * 95 / 100],
+           latencies[steps - 1]);
+
+  return 0;
+}
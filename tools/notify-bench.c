@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2020 Purism SPC
+ *
+ * SPDX-License-Identifier: GPL-3.0+
+ *
+ * Run PhoshNotifyManager against a private session bus and measure
+ * how it copes with streams of notifications. Banners need a running
+ * compositor so they're turned off, this measures the D-Bus handling,
+ * image processing and the notification store.
+ */
+
+#include "notifications/notify-manager.h"
+
+#include <gtk/gtk.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define NOTIFY_DBUS_NAME "org.freedesktop.Notifications"
+#define NOTIFY_DBUS_PATH "/org/freedesktop/Notifications"
+
+/* The main loop ticks that often, longer gaps are stalls */
+#define STALL_TICK_MS 1
+#define STALL_THRESHOLD_US (16 * 1000) /* one frame at 60Hz */
+
+typedef enum {
+  STREAM_TEXT,
+  STREAM_REPLACE,
+  STREAM_IMAGE,
+  STREAM_APPS,
+} StreamType;
+
+static const char * const stream_names[] = {
+  [STREAM_TEXT] = "text",
+  [STREAM_REPLACE] = "replace",
+  [STREAM_IMAGE] = "image",
+  [STREAM_APPS] = "apps",
+};
+
+typedef struct {
+  StreamType       type;
+  GDBusConnection *connection;
+  GVariant        *image_data;
+  GMainLoop       *loop;
+  gint64          *latencies;
+  guint            failed;
+} Stream;
+
+typedef struct {
+  gint64 last_tick;
+  gint64 total;
+  gint64 max;
+  guint  count;
+} Stalls;
+
+static gint     count = 1000;
+static gint     n_apps = 50;
+static gint     image_size = 1024;
+static gint     expire_timeout;
+static gchar  **streams;
+
+static GOptionEntry entries[] = {
+  { "count", 'c', 0, G_OPTION_ARG_INT, &count, "Notifications per stream", "COUNT" },
+  { "stream", 's', 0, G_OPTION_ARG_STRING_ARRAY, &streams,
+    "Stream to run: text, replace, image or apps (default: all)", "STREAM" },
+  { "apps", 'a', 0, G_OPTION_ARG_INT, &n_apps, "Number of apps in the apps stream", "APPS" },
+  { "image-size", 'i', 0, G_OPTION_ARG_INT, &image_size, "Width and height of image-data", "PIXELS" },
+  { "expire-timeout", 'e', 0, G_OPTION_ARG_INT, &expire_timeout,
+    "Expire timeout in ms, 0 keeps notifications around (default)", "MS" },
+  { NULL }
+};
+
+
+static gint
+cmp_gint64 (gconstpointer a, gconstpointer b)
+{
+  gint64 va = *(const gint64 *) a, vb = *(const gint64 *) b;
+
+  return (va > vb) - (va < vb);
+}
+
+
+static gsize
+get_rss (void)
+{
+  g_autofree gchar *contents = NULL;
+  gulong size, resident;
+
+  if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+    return 0;
+
+  if (sscanf (contents, "%lu %lu", &size, &resident) != 2)
+    return 0;
+
+  return (gsize) resident * sysconf (_SC_PAGESIZE);
+}
+
+
+static GVariant *
+build_image_data (int size)
+{
+  int row_stride = size * 4;
+  gsize len = (gsize) row_stride * size;
+  g_autofree guchar *data = g_malloc (len);
+
+  for (gsize i = 0; i < len; i++)
+    data[i] = i % 251;
+
+  return g_variant_ref_sink (
+    g_variant_new ("(iiibii@ay)", size, size, row_stride, TRUE, 8, 4,
+                   g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, data, len, 1)));
+}
+
+
+static gboolean
+on_stall_tick (gpointer user_data)
+{
+  Stalls *stalls = user_data;
+  gint64 now = g_get_monotonic_time ();
+  gint64 gap = now - stalls->last_tick;
+
+  if (stalls->last_tick && gap > STALL_THRESHOLD_US) {
+    stalls->total += gap;
+    stalls->max = MAX (stalls->max, gap);
+    stalls->count++;
+  }
+  stalls->last_tick = now;
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+static void
+on_name_appeared (GDBusConnection *connection,
+                  const gchar     *name,
+                  const gchar     *name_owner,
+                  gpointer         user_data)
+{
+  g_main_loop_quit (user_data);
+}
+
+
+static gboolean
+quit_loop (gpointer user_data)
+{
+  g_main_loop_quit (user_data);
+  return G_SOURCE_REMOVE;
+}
+
+
+/* Runs in its own thread so the round trips include the time the
+   manager's main loop needs to get to the request */
+static gpointer
+run_stream (gpointer user_data)
+{
+  Stream *stream = user_data;
+  guint replaces_id = 0;
+
+  for (gint i = 0; i < count; i++) {
+    g_autoptr (GVariant) ret = NULL;
+    g_autoptr (GError) err = NULL;
+    g_autofree gchar *app_name = NULL;
+    g_autofree gchar *summary = NULL;
+    GVariantBuilder hints;
+    gint64 start;
+
+    g_variant_builder_init (&hints, G_VARIANT_TYPE_VARDICT);
+    if (stream->type == STREAM_IMAGE)
+      g_variant_builder_add (&hints, "{sv}", "image-data", stream->image_data);
+
+    if (stream->type == STREAM_APPS)
+      app_name = g_strdup_printf ("bench-%d", i % n_apps);
+    else
+      app_name = g_strdup ("bench");
+    summary = g_strdup_printf ("Notification %d", i);
+
+    start = g_get_monotonic_time ();
+    ret = g_dbus_connection_call_sync (stream->connection,
+                                       NOTIFY_DBUS_NAME,
+                                       NOTIFY_DBUS_PATH,
+                                       NOTIFY_DBUS_NAME,
+                                       "Notify",
+                                       g_variant_new ("(susssasa{sv}i)",
+                                                      app_name,
+                                                      replaces_id,
+                                                      "",
+                                                      summary,
+                                                      "Some body text to show in the notification",
+                                                      NULL,
+                                                      &hints,
+                                                      expire_timeout),
+                                       G_VARIANT_TYPE ("(u)"),
+                                       G_DBUS_CALL_FLAGS_NONE,
+                                       -1,
+                                       NULL,
+                                       &err);
+    stream->latencies[i] = g_get_monotonic_time () - start;
+    if (!ret) {
+      g_printerr ("Notify %d failed: %s\n", i, err->message);
+      stream->failed++;
+      continue;
+    }
+
+    if (stream->type == STREAM_REPLACE)
+      g_variant_get (ret, "(u)", &replaces_id);
+  }
+
+  g_idle_add (quit_loop, stream->loop);
+  return NULL;
+}
+
+
+static void
+print_results (Stream *stream, Stalls *stalls, gsize rss_before, gsize rss_after)
+{
+  gint64 *lat = stream->latencies;
+
+  qsort (lat, count, sizeof (gint64), cmp_gint64);
+  g_print ("%-8s latency (µs): p50 %" G_GINT64_FORMAT ", p90 %" G_GINT64_FORMAT
+           ", p99 %" G_GINT64_FORMAT ", max %" G_GINT64_FORMAT "\n",
+           stream_names[stream->type],
+           lat[(count - 1) * 50 / 100],
+           lat[(count - 1) * 90 / 100],
+           lat[(count - 1) * 99 / 100],
+           lat[count - 1]);
+  g_print ("%-8s stalls: %u, total %" G_GINT64_FORMAT " ms, max %" G_GINT64_FORMAT " ms\n",
+           "", stalls->count, stalls->total / 1000, stalls->max / 1000);
+  g_print ("%-8s RSS: %" G_GSIZE_FORMAT " KiB → %" G_GSIZE_FORMAT " KiB (%+" G_GINT64_FORMAT " KiB)",
+           "", rss_before / 1024, rss_after / 1024,
+           ((gint64) rss_after - (gint64) rss_before) / 1024);
+  if (stream->failed)
+    g_print (", %u failed", stream->failed);
+  g_print ("\n");
+}
+
+
+static void
+bench_stream (GDBusConnection *connection, StreamType type, GVariant *image_data)
+{
+  g_autoptr (GMainLoop) loop = g_main_loop_new (NULL, FALSE);
+  GThread *thread;
+  g_autofree gint64 *latencies = g_new0 (gint64, count);
+  Stream stream = { type, connection, image_data, loop, latencies, 0 };
+  Stalls stalls = { 0 };
+  gsize rss_before;
+  guint tick_id;
+
+  rss_before = get_rss ();
+  tick_id = g_timeout_add (STALL_TICK_MS, on_stall_tick, &stalls);
+
+  /* The manager needs the main loop while the client thread sends */
+  thread = g_thread_new (stream_names[type], run_stream, &stream);
+  g_main_loop_run (loop);
+  g_thread_join (thread);
+
+  g_source_remove (tick_id);
+  /* Let outstanding work like image scaling finish */
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+
+  print_results (&stream, &stalls, rss_before, get_rss ());
+}
+
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr (GOptionContext) opt_context = NULL;
+  g_autoptr (GError) err = NULL;
+  g_autoptr (GTestDBus) bus = NULL;
+  g_autoptr (GDBusConnection) connection = NULL;
+  g_autoptr (GMainLoop) loop = NULL;
+  g_autoptr (GSettings) settings = NULL;
+  g_autoptr (GVariant) image_data = NULL;
+  PhoshNotifyManager *manager;
+  PhoshNotificationStore *store;
+  guint watch_id;
+
+  opt_context = g_option_context_new ("- benchmark the notification daemon");
+  g_option_context_add_main_entries (opt_context, entries, NULL);
+  g_option_context_add_group (opt_context, gtk_get_option_group (FALSE));
+  if (!g_option_context_parse (opt_context, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    return 1;
+  }
+
+  if (count < 1 || n_apps < 1 || image_size < 1) {
+    g_printerr ("Count, apps and image size must be positive\n");
+    return 1;
+  }
+
+  /* Don't touch the user's settings, banners need a compositor */
+  g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+  settings = g_settings_new ("org.gnome.desktop.notifications");
+  g_settings_set_boolean (settings, "show-banners", FALSE);
+
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+
+  /* Only needed to pick the image size for HiDPI monitors */
+  gtk_init_check (&argc, &argv);
+
+  loop = g_main_loop_new (NULL, FALSE);
+  manager = phosh_notify_manager_get_default ();
+  watch_id = g_bus_watch_name (G_BUS_TYPE_SESSION, NOTIFY_DBUS_NAME,
+                               G_BUS_NAME_WATCHER_FLAGS_NONE,
+                               on_name_appeared, NULL, loop, NULL);
+  g_main_loop_run (loop);
+  g_bus_unwatch_name (watch_id);
+
+  connection = g_dbus_connection_new_for_address_sync (g_test_dbus_get_bus_address (bus),
+                                                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                       G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                       NULL, NULL, &err);
+  if (!connection) {
+    g_printerr ("Failed to connect to private bus: %s\n", err->message);
+    return 1;
+  }
+
+  image_data = build_image_data (image_size);
+  g_print ("%d notifications per stream, %d apps, %dx%d images\n",
+           count, n_apps, image_size, image_size);
+
+  for (int type = STREAM_TEXT; type <= STREAM_APPS; type++) {
+    if (streams && !g_strv_contains ((const gchar * const *) streams, stream_names[type]))
+      continue;
+    bench_stream (connection, type, image_data);
+  }
+
+  store = phosh_notify_manager_get_store (manager);
+  g_print ("store: %u notifications, %" G_GUINT64_FORMAT " KiB, %u evicted\n",
+           phosh_notification_store_get_n_notifications (store),
+           phosh_notification_store_get_size (store) / 1024,
+           phosh_notification_store_get_n_evicted (store));
+
+  g_dbus_connection_close_sync (connection, NULL, NULL);
+  /* The manager keeps the session bus connection so don't wait for it */
+  g_test_dbus_stop (bus);
+
+  return 0;
+}